@@ -0,0 +1,311 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include "report.hpp"
+#include <stepper.hpp>
+#include <chain.hpp>
+#include <clock.hpp>
+#include <histogram.hpp>
+#include <breakdown.hpp>
+#include <probe.hpp>
+#include <multiaxis.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+using namespace libstepper;
+
+/**
+ Measures the per-step overhead of StepperDriver, as a JSON report. Usage:
+
+   libstepper-bench [--steps N] [--rate-steps N] [--output FILE] [--baseline FILE] [--tolerance FRACTION]
+
+ --steps is the length of the moves timed on a VirtualClock, which measure the driver's own cost per step
+ (1,000,000 by default). --rate-steps is the length of the moves timed in real time, at 1 us per step, which
+ measure the fastest step rate each way of driving the motor can actually reach (20,000 by default). The
+ mean time of each StepPhase is measured on a real time move too, and its full breakdown goes to stderr. The
+ report goes to stdout, or to --output. With --baseline, the metrics that are worse than the baseline's by
+ more than --tolerance (0.1 by default) are listed on stderr, and the exit code is 2.
+*/
+
+class NullSignalConsumer : public DigitalSignalConsumer {
+public:
+    void write(bool) {
+    }
+};
+
+// A driver whose terminals go nowhere, so that only the driver itself is measured
+struct NullDriver {
+    NullDriver(Clock &clock, const uint64_t rpm, WaveformChainConsumer *chain = nullptr, LatencyHistogram *jitter = nullptr, StepBreakdown *breakdown = nullptr) {
+        StepperDriverBuilder builder;
+        builder.setEnableTerminal(en)
+            .setRotationStepCount(STEPS_IN_ROTATION)
+            .setInitialRPM(rpm)
+            .setClock(clock);
+        if (jitter != nullptr) {
+            builder.setJitterHistogram(*jitter);
+        }
+        if (breakdown != nullptr) {
+            builder.setStepBreakdown(*breakdown);
+        }
+        if (chain == nullptr) {
+            builder.setCoil1Terminal1(a1).setCoil1Terminal2(a2).setCoil2Terminal1(b1).setCoil2Terminal2(b2);
+        } else {
+            builder.setWaveformChain(*chain);
+        }
+        driver = builder.build();
+    }
+
+    ~NullDriver() {
+        delete driver;
+    }
+
+    NullDriver(const NullDriver &rhs) = delete;
+
+    static const uint64_t STEPS_IN_ROTATION = 200;
+
+    NullSignalConsumer a1;
+    NullSignalConsumer a2;
+    NullSignalConsumer b1;
+    NullSignalConsumer b2;
+    NullSignalConsumer en;
+    StepperDriver *driver;
+};
+
+// 60 RPM, i.e. 5 ms per step, which a VirtualClock skips
+static const uint64_t VIRTUAL_RPM = 60;
+// 1 us per step, faster than any timing mode can keep up with
+static const uint64_t MAX_RPM = 60000000 / NullDriver::STEPS_IN_ROTATION;
+// 1 ms per step, so an interrupt can land anywhere in a step's wait
+static const uint64_t INTERRUPT_RPM = 300;
+static const size_t INTERRUPT_TRIALS = 20;
+// Half a second of real time steps at 1 ms per step
+static const uint64_t JITTER_STEPS = 500;
+
+static double getNanosPerStep(const steady_clock::time_point start, const uint64_t steps) {
+    return duration<double, nano>(steady_clock::now() - start).count() / (double) steps;
+}
+
+static double getStepsPerSecond(const steady_clock::time_point start, const uint64_t steps) {
+    return (double) steps / duration<double>(steady_clock::now() - start).count();
+}
+
+static void measureStepCost(BenchReport &report, const uint64_t steps) {
+    VirtualClock clock;
+    NullDriver waveform(clock, VIRTUAL_RPM);
+    steady_clock::time_point start = steady_clock::now();
+    waveform.driver->step(steps, COUNTER_CLOCKWISE);
+    report.add("drive_waveform.step_cost", getNanosPerStep(start, steps), "ns", true);
+
+    NullDriver timeline(clock, VIRTUAL_RPM);
+    const StepTimeline planned = timeline.driver->plan(steps, COUNTER_CLOCKWISE);
+    start = steady_clock::now();
+    timeline.driver->play(planned);
+    report.add("play_timeline.step_cost", getNanosPerStep(start, steps), "ns", true);
+
+    // Rendering alone, without playing
+    NullDriver renderer(clock, VIRTUAL_RPM);
+    start = steady_clock::now();
+    const StepTimeline rendered = renderer.driver->plan(steps, CLOCKWISE);
+    report.add("render.step_cost", getNanosPerStep(start, rendered.size()), "ns", true);
+
+    NullDriver queue(clock, VIRTUAL_RPM);
+    const StepQueue compiled = queue.driver->compile(steps, COUNTER_CLOCKWISE);
+    start = steady_clock::now();
+    queue.driver->play(compiled);
+    report.add("play_queue.step_cost", getNanosPerStep(start, steps), "ns", true);
+}
+
+static void measureInterruptLatency(BenchReport &report) {
+    NullDriver motor(SteadyClock::getInstance(), INTERRUPT_RPM);
+    double totalMicros = 0;
+    double maxMicros = 0;
+
+    for (size_t i = 0; i < INTERRUPT_TRIALS; ++i) {
+        StepperDriver *driver = motor.driver;
+        thread driving([driver] {
+            driver->drive(COUNTER_CLOCKWISE);
+        });
+        // Spread over a step's wait, so that the interrupts don't all land at the same point in it
+        this_thread::sleep_for(microseconds(5000 + i * 137));
+
+        const steady_clock::time_point start = steady_clock::now();
+        driver->interrupt();
+        driving.join();
+        const double micros = duration<double, micro>(steady_clock::now() - start).count();
+        totalMicros += micros;
+        maxMicros = micros > maxMicros ? micros : maxMicros;
+    }
+
+    report.add("interrupt.latency_mean", totalMicros / INTERRUPT_TRIALS, "us", true);
+    report.add("interrupt.latency_max", maxMicros, "us", true);
+}
+
+static void measureJitter(BenchReport &report) {
+    LatencyHistogram histogram;
+    NullDriver motor(SteadyClock::getInstance(), INTERRUPT_RPM, nullptr, &histogram);
+    motor.driver->step(JITTER_STEPS, COUNTER_CLOCKWISE);
+
+    report.add("jitter.lateness_p50", (double) histogram.getPercentile(0.5), "us", true);
+    report.add("jitter.lateness_p99", (double) histogram.getPercentile(0.99), "us", true);
+    report.add("jitter.lateness_p999", (double) histogram.getPercentile(0.999), "us", true);
+    report.add("jitter.lateness_max", (double) histogram.getMax(), "us", true);
+
+    // The same move again, waking up early by the measured sleep overshoot
+    histogram.reset();
+    const TimingCalibration calibration = motor.driver->calibrate();
+    motor.driver->step(JITTER_STEPS, COUNTER_CLOCKWISE);
+    report.add("calibration.oversleep", (double) calibration.oversleepMicros, "us", true);
+    report.add("jitter.calibrated_lateness_p50", (double) histogram.getPercentile(0.5), "us", true);
+    report.add("jitter.calibrated_lateness_p99", (double) histogram.getPercentile(0.99), "us", true);
+}
+
+static void measureWakeupLatency(BenchReport &report) {
+    LatencyProbe probe;
+    probe.run(JITTER_STEPS);
+    report.add("probe.wakeup_p99", (double) probe.getHistogram().getPercentile(0.99), "us", true);
+    report.add("probe.wakeup_p999", (double) probe.getHistogram().getPercentile(0.999), "us", true);
+    report.add("probe.safe_step_rate", (double) probe.getSafeStepsPerSecond(0.1), "steps/s", false);
+}
+
+static void measureBreakdown(BenchReport &report) {
+    StepBreakdown breakdown;
+    NullDriver motor(SteadyClock::getInstance(), INTERRUPT_RPM, nullptr, nullptr, &breakdown);
+    motor.driver->step(JITTER_STEPS, COUNTER_CLOCKWISE);
+
+    for (size_t i = 0; i < STEP_PHASE_COUNT; ++i) {
+        const StepPhase phase = (StepPhase) i;
+        report.add(string("breakdown.") + StepBreakdown::getPhaseName(phase) + "_mean", breakdown.get(phase).getMeanNanos(), "ns", true);
+    }
+    breakdown.write(cerr);
+}
+
+static void measureSetRPMContention(BenchReport &report, const uint64_t steps) {
+    VirtualClock clock;
+    NullDriver motor(clock, VIRTUAL_RPM);
+    StepperDriver *driver = motor.driver;
+    atomic<bool> done(false);
+    atomic<uint64_t> calls(0);
+
+    thread setter([driver, &done, &calls] {
+        uint64_t count = 0;
+        while (!done.load()) {
+            driver->setRPM(VIRTUAL_RPM + count % 2);
+            ++count;
+        }
+        calls = count;
+    });
+
+    const steady_clock::time_point start = steady_clock::now();
+    driver->step(steps, COUNTER_CLOCKWISE);
+    const double nanosPerStep = getNanosPerStep(start, steps);
+    const double seconds = duration<double>(steady_clock::now() - start).count();
+    done = true;
+    setter.join();
+
+    report.add("set_rpm.contended_step_cost", nanosPerStep, "ns", true);
+    report.add("set_rpm.calls_per_second", (double) calls.load() / seconds, "calls/s", false);
+}
+
+static void measureMaxStepRate(BenchReport &report, const uint64_t steps) {
+    NullDriver waveform(SteadyClock::getInstance(), MAX_RPM);
+    steady_clock::time_point start = steady_clock::now();
+    waveform.driver->step(steps, COUNTER_CLOCKWISE);
+    report.add("max_rate.drive_waveform", getStepsPerSecond(start, steps), "steps/s", false);
+
+    NullDriver queue(SteadyClock::getInstance(), MAX_RPM);
+    const StepQueue compiled = queue.driver->compile(steps, COUNTER_CLOCKWISE);
+    start = steady_clock::now();
+    queue.driver->play(compiled);
+    report.add("max_rate.play_queue", getStepsPerSecond(start, steps), "steps/s", false);
+
+    NullSignalConsumer a1, a2, b1, b2;
+    LocalWaveformChain chain(a1, b1, a2, b2);
+    NullDriver chained(SteadyClock::getInstance(), MAX_RPM, &chain);
+    start = steady_clock::now();
+    chained.driver->step(steps, COUNTER_CLOCKWISE);
+    report.add("max_rate.waveform_chain", getStepsPerSecond(start, steps), "steps/s", false);
+
+    NullDriver axis(SteadyClock::getInstance(), MAX_RPM);
+    MultiAxisController controller({ axis.driver });
+    start = steady_clock::now();
+    controller.move({ (int64_t) steps }, 1000000);
+    report.add("max_rate.multiaxis", getStepsPerSecond(start, steps), "steps/s", false);
+}
+
+int main(int argc, char **argv) {
+    uint64_t steps = 1000000;
+    uint64_t rateSteps = 20000;
+    string outputPath;
+    string baselinePath;
+    double tolerance = 0.1;
+
+    for (int i = 1; i < argc; ++i) {
+        const bool hasValue = i + 1 < argc;
+        if (hasValue && strcmp(argv[i], "--steps") == 0) {
+            steps = strtoull(argv[++i], nullptr, 10);
+        } else if (hasValue && strcmp(argv[i], "--rate-steps") == 0) {
+            rateSteps = strtoull(argv[++i], nullptr, 10);
+        } else if (hasValue && strcmp(argv[i], "--output") == 0) {
+            outputPath = argv[++i];
+        } else if (hasValue && strcmp(argv[i], "--baseline") == 0) {
+            baselinePath = argv[++i];
+        } else if (hasValue && strcmp(argv[i], "--tolerance") == 0) {
+            tolerance = strtod(argv[++i], nullptr);
+        } else {
+            cerr << "Usage: " << argv[0] << " [--steps N] [--rate-steps N] [--output FILE] [--baseline FILE] [--tolerance FRACTION]" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (steps == 0 || rateSteps == 0) {
+        cerr << "The step counts must be > 0" << endl;
+        return EXIT_FAILURE;
+    }
+
+    BenchReport report;
+    measureStepCost(report, steps);
+    measureInterruptLatency(report);
+    measureJitter(report);
+    measureBreakdown(report);
+    measureWakeupLatency(report);
+    measureSetRPMContention(report, steps);
+    measureMaxStepRate(report, rateSteps);
+
+    if (outputPath.empty()) {
+        report.writeJson(cout);
+    } else {
+        ofstream output(outputPath.c_str());
+        report.writeJson(output);
+        if (!output) {
+            cerr << "Couldn't write " << outputPath << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!baselinePath.empty()) {
+        ifstream input(baselinePath.c_str());
+        if (!input) {
+            cerr << "Couldn't read " << baselinePath << endl;
+            return EXIT_FAILURE;
+        }
+
+        const vector<string> regressions = report.compare(BenchReport::readJson(input), tolerance);
+        for (size_t i = 0; i < regressions.size(); ++i) {
+            cerr << "regression: " << regressions[i] << endl;
+        }
+        if (!regressions.empty()) {
+            return 2;
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include "report.hpp"
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+void BenchReport::add(const string &name, const double value, const string &unit, const bool lowerIsBetter) {
+    metrics.push_back({ name, value, unit, lowerIsBetter });
+}
+
+const vector<BenchMetric> &BenchReport::getMetrics() const {
+    return metrics;
+}
+
+void BenchReport::writeJson(ostream &output) const {
+    const streamsize precision = output.precision(numeric_limits<double>::digits10);
+    output << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < metrics.size(); ++i) {
+        output << "    { \"name\": \"" << metrics[i].name
+               << "\", \"value\": " << metrics[i].value
+               << ", \"unit\": \"" << metrics[i].unit
+               << "\", \"lower_is_better\": " << (metrics[i].lowerIsBetter ? "true" : "false")
+               << " }" << (i + 1 < metrics.size() ? "," : "") << "\n";
+    }
+    output << "  ]\n}\n";
+    output.precision(precision);
+}
+
+// Finds the string value of the next "key": "..." pair at or after position, and moves position past it
+static bool readString(const string &json, const string &key, size_t &position, string &value) {
+    const string pattern = "\"" + key + "\": \"";
+    const size_t start = json.find(pattern, position);
+    if (start == string::npos) {
+        return false;
+    }
+    const size_t end = json.find('"', start + pattern.size());
+    if (end == string::npos) {
+        throw runtime_error("Unterminated \"" + key + "\" in the baseline");
+    }
+    value = json.substr(start + pattern.size(), end - start - pattern.size());
+    position = end + 1;
+    return true;
+}
+
+map<string, double> BenchReport::readJson(istream &input) {
+    const string json((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
+    if (json.find("\"benchmarks\"") == string::npos) {
+        throw runtime_error("The baseline isn't a libstepper-bench report");
+    }
+
+    map<string, double> values;
+    size_t position = 0;
+    string name;
+    while (readString(json, "name", position, name)) {
+        const string pattern = "\"value\": ";
+        const size_t start = json.find(pattern, position);
+        if (start == string::npos) {
+            throw runtime_error("No value for " + name + " in the baseline");
+        }
+
+        const char *number = json.c_str() + start + pattern.size();
+        char *end = nullptr;
+        values[name] = strtod(number, &end);
+        if (end == number) {
+            throw runtime_error("The value of " + name + " in the baseline isn't a number");
+        }
+        position = (size_t) (end - json.c_str());
+    }
+    return values;
+}
+
+vector<string> BenchReport::compare(const map<string, double> &baseline, const double tolerance) const {
+    vector<string> regressions;
+    for (size_t i = 0; i < metrics.size(); ++i) {
+        const map<string, double>::const_iterator expected = baseline.find(metrics[i].name);
+        if (expected == baseline.end() || expected->second <= 0) {
+            continue;
+        }
+
+        const double change = (metrics[i].value - expected->second) / expected->second;
+        if ((metrics[i].lowerIsBetter && change > tolerance) || (!metrics[i].lowerIsBetter && -change > tolerance)) {
+            ostringstream description;
+            description << metrics[i].name << ": " << metrics[i].value << " " << metrics[i].unit
+                        << " (baseline " << expected->second << ", " << (change > 0 ? "+" : "") << change * 100 << "%)";
+            regressions.push_back(description.str());
+        }
+    }
+    return regressions;
+}
@@ -0,0 +1,41 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ The results of a libstepper-bench run, written out as JSON:
+
+   { "benchmarks": [ { "name": "...", "value": 1.5, "unit": "ns", "lower_is_better": true }, ... ] }
+
+ A previous run's JSON can be read back as a baseline, to flag the metrics that got worse.
+*/
+struct BenchMetric {
+    std::string name;
+    double value;
+    std::string unit;
+    bool lowerIsBetter;
+};
+
+class BenchReport {
+public:
+    void add(const std::string &name, const double value, const std::string &unit, const bool lowerIsBetter);
+    const std::vector<BenchMetric> &getMetrics() const;
+
+    void writeJson(std::ostream &output) const;
+    // Reads the names and values of a report written by writeJson(). Throws std::runtime_error if it isn't one.
+    static std::map<std::string, double> readJson(std::istream &input);
+
+    // Describes every metric that's worse than its baseline by more than the tolerance (e.g. 0.1 for 10%).
+    // Metrics without a baseline are skipped.
+    std::vector<std::string> compare(const std::map<std::string, double> &baseline, const double tolerance) const;
+
+private:
+    std::vector<BenchMetric> metrics;
+};
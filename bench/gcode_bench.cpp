@@ -0,0 +1,111 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <interpreter.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+using namespace std::chrono;
+using namespace libstepper;
+
+/**
+ Measures how fast GcodeInterpreter parses and plans a job, without any motion: the blocks go to an
+ executor that only counts them. Usage:
+
+   libstepper-gcode-bench [job.gcode]
+
+ Without a job, a synthetic one of 1,000,000 lines of short G1 moves and G2/G3 arcs is written to
+ libstepper-gcode-bench.gcode in the working directory first.
+*/
+
+static const char *GENERATED_JOB = "libstepper-gcode-bench.gcode";
+static const uint64_t GENERATED_LINE_COUNT = 1000000;
+
+class CountingExecutor : public BlockExecutor {
+public:
+    CountingExecutor() : count(0) {
+    }
+
+    size_t getAxisCount() const {
+        return 3;
+    }
+
+    double getMaxStepRate(const size_t) const {
+        return 0;
+    }
+
+    void begin() {
+        start = steady_clock::now();
+    }
+
+    void end() {
+    }
+
+    bool execute(const PlannerBlock &) {
+        if (count++ == 0) {
+            first = steady_clock::now();
+        }
+        return true;
+    }
+
+    uint64_t count;
+    steady_clock::time_point start;
+    steady_clock::time_point first;
+};
+
+static void generateJob(const char *path, const uint64_t lineCount) {
+    ofstream job(path);
+    job << "G21 G90 F3000\n";
+    for (uint64_t i = 1; i < lineCount; ++i) {
+        // A polyline around a 50 mm circle, with a small full circle every 100 lines
+        const double angle = (double) i * 0.01;
+        const double x = 100 + 50 * cos(angle);
+        const double y = 100 + 50 * sin(angle);
+        char line[64];
+        if (i % 100 == 0) {
+            snprintf(line, sizeof(line), "G%d I%.3f J0\n", i % 200 == 0 ? 2 : 3, i % 200 == 0 ? 2.5 : -2.5);
+        } else {
+            snprintf(line, sizeof(line), "G1 X%.3f Y%.3f Z%.3f\n", x, y, (double) (i % 10) * 0.1);
+        }
+        job << line;
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : GENERATED_JOB;
+    if (argc <= 1) {
+        generateJob(path, GENERATED_LINE_COUNT);
+    }
+
+    ifstream job(path);
+    if (!job) {
+        cerr << "Failed to open " << path << endl;
+        return EXIT_FAILURE;
+    }
+
+    CountingExecutor executor;
+    vector<GcodeAxis> axes;
+    axes.push_back({ 'X', 0, 80, 0 });
+    axes.push_back({ 'Y', 1, 80, 0 });
+    axes.push_back({ 'Z', 2, 400, 0 });
+    GcodeInterpreter interpreter(executor, axes);
+
+    const steady_clock::time_point start = steady_clock::now();
+    interpreter.run(job);
+    const double seconds = duration<double>(steady_clock::now() - start).count();
+    const double firstBlockMillis = duration<double, milli>(executor.first - executor.start).count();
+
+    cout << "lines: " << interpreter.getLineCount() << endl;
+    cout << "segments: " << executor.count << endl;
+    cout << "seconds: " << seconds << endl;
+    cout << "lines/sec: " << (double) interpreter.getLineCount() / seconds << endl;
+    cout << "segments/sec: " << (double) executor.count / seconds << endl;
+    cout << "first segment after (ms): " << firstBlockMillis << endl;
+    return EXIT_SUCCESS;
+}
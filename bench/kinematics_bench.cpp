@@ -0,0 +1,47 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <kinematics.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using namespace std::chrono;
+using namespace libstepper;
+
+/**
+ Measures the cost of converting a toolhead position to motor steps, which is paid once per segment of a
+ ToolheadController move. Usage:
+
+   libstepper-kinematics-bench [segments]
+*/
+
+static void measure(const string &name, const Kinematics &kinematics, const uint64_t segmentCount) {
+    int64_t steps[3];
+    int64_t checksum = 0;
+
+    const steady_clock::time_point start = steady_clock::now();
+    for (uint64_t i = 0; i < segmentCount; ++i) {
+        // Sweeps back and forth across a 100 mm wide, 50 mm tall region near the center
+        const double fraction = (double) (i % 10000) / 10000;
+        const double position[] = { -50 + 100 * fraction, 25 - 50 * fraction, 50 * fraction };
+        kinematics.toMotorSteps(position, steps);
+        checksum += steps[0] + steps[1] + steps[2];
+    }
+    const double seconds = duration<double>(steady_clock::now() - start).count();
+
+    cout << name << ": " << seconds * 1e9 / (double) segmentCount << " ns/segment, "
+         << (double) segmentCount / seconds << " segments/sec (checksum " << checksum << ")" << endl;
+}
+
+int main(int argc, char **argv) {
+    const uint64_t segmentCount = argc > 1 ? strtoull(argv[1], nullptr, 10) : 10000000;
+
+    measure("cartesian", CartesianKinematics(80, 80, 400), segmentCount);
+    measure("corexy", CoreXYKinematics(80, 400), segmentCount);
+    measure("linear delta", LinearDeltaKinematics(100, 250, 80), segmentCount);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,87 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <interpreter.hpp>
+#include <offline.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+using namespace libstepper;
+
+/**
+ Measures how OfflinePlanner::plan() scales with threads, on a synthetic job of short G1 moves and small
+ arcs. Usage:
+
+   libstepper-offline-bench [lines] [max threads]
+
+ The job has 250,000 lines by default, and it's planned with 1, 2, 4, ... threads, up to the number of
+ cores by default.
+*/
+
+static string generateJob(const uint64_t lineCount) {
+    ostringstream job;
+    job << "G21 G90 F6000\n";
+    for (uint64_t i = 1; i < lineCount; ++i) {
+        const double angle = (double) i * 0.01;
+        char line[64];
+        if (i % 100 == 0) {
+            snprintf(line, sizeof(line), "G%d I%.3f J0\n", i % 200 == 0 ? 2 : 3, i % 200 == 0 ? 1.0 : -1.0);
+        } else {
+            snprintf(line, sizeof(line), "G1 X%.3f Y%.3f\n", 100 + 50 * cos(angle), 100 + 50 * sin(angle));
+        }
+        job << line;
+    }
+    return job.str();
+}
+
+int main(int argc, char **argv) {
+    const uint64_t lineCount = argc > 1 ? strtoull(argv[1], nullptr, 10) : 250000;
+    const size_t maxThreads = argc > 2 ? strtoul(argv[2], nullptr, 10) : max(1u, thread::hardware_concurrency());
+
+    vector<OfflineAxis> offlineAxes;
+    offlineAxes.push_back({ 200, 0 });
+    offlineAxes.push_back({ 200, 0 });
+    OfflinePlanner planner(offlineAxes);
+
+    vector<GcodeAxis> axes;
+    axes.push_back({ 'X', 0, 80, 0 });
+    axes.push_back({ 'Y', 1, 80, 0 });
+    GcodeInterpreter interpreter(planner, axes);
+
+    istringstream job(generateJob(lineCount));
+    steady_clock::time_point start = steady_clock::now();
+    interpreter.run(job);
+    cout << "blocks: " << planner.getBlocks().size() << endl;
+    cout << "parse seconds: " << duration<double>(steady_clock::now() - start).count() << endl;
+
+    double baseline = 0;
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        start = steady_clock::now();
+        planner.plan(threads);
+        const double seconds = duration<double>(steady_clock::now() - start).count();
+        baseline = threads == 1 ? seconds : baseline;
+
+        uint64_t steps = 0;
+        for (size_t axis = 0; axis < planner.getAxisCount(); ++axis) {
+            for (size_t i = 0; i < planner.getQueues(axis).size(); ++i) {
+                steps += planner.getQueues(axis)[i].getStepCount();
+            }
+        }
+
+        cout << "threads: " << threads
+             << ", plan seconds: " << seconds
+             << ", speedup: " << baseline / seconds
+             << ", blocks/sec: " << (double) planner.getBlocks().size() / seconds
+             << ", steps: " << steps
+             << ", job duration (s): " << (double) planner.getDurationMicros() / 1000000 << endl;
+    }
+    return EXIT_SUCCESS;
+}
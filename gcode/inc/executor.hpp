@@ -0,0 +1,36 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <multiaxis.hpp>
+#include <planner.hpp>
+
+namespace libstepper {
+
+/**
+ Executes planned blocks on a MultiAxisController, with trapezoidal speed ramps between their entry and
+ exit speeds. The axes stay enabled from begin() to end(), and the blocks are scheduled back to back on the
+ controller's clock. Each axis's step rate is limited to its driver's max safe RPM.
+*/
+class MultiAxisExecutor : public BlockExecutor {
+public:
+    // Throws std::invalid_argument if the controller has more than PLANNER_MAX_AXES axes.
+    explicit MultiAxisExecutor(MultiAxisController &controller);
+
+    size_t getAxisCount() const;
+    double getMaxStepRate(const size_t axis) const;
+    void begin();
+    void end();
+    bool execute(const PlannerBlock &block);
+
+private:
+    MultiAxisController &controller;
+    std::vector<int64_t> steps;
+};
+
+}
@@ -0,0 +1,75 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <istream>
+
+namespace libstepper {
+
+// Longer lines are rejected, so that the parser's memory use doesn't depend on the input.
+static const size_t GCODE_MAX_LINE_LENGTH = 256;
+// The most G-words (e.g. "G21 G90 G1") a single line can have.
+static const size_t GCODE_MAX_G_WORDS = 8;
+
+/**
+ The words of one line of G-code. Every letter other than G can appear once, and G can appear up to
+ GCODE_MAX_G_WORDS times. Letters are stored upper case.
+*/
+class GcodeLine {
+public:
+    GcodeLine();
+
+    void clear();
+    bool empty() const;
+    bool has(const char letter) const;
+    // Throws std::out_of_range if the letter isn't on the line.
+    double get(const char letter) const;
+    double get(const char letter, const double fallback) const;
+    // Throws FormatError if the letter is already on the line, unless it's a G.
+    void set(const char letter, const double value);
+
+    size_t getGCodeCount() const;
+    double getGCode(const size_t index) const;
+
+    // The line number in the input, starting from 1.
+    uint64_t getLineNumber() const;
+    void setLineNumber(const uint64_t lineNumber);
+
+private:
+    double values[26];
+    uint32_t present;
+    double gCodes[GCODE_MAX_G_WORDS];
+    size_t gCodeCount;
+    uint64_t lineNumber;
+};
+
+/**
+ Reads G-code from a stream one line at a time, with a fixed size buffer, so that jobs can be processed
+ while they're still being read. Comments (";" to the end of the line, and parentheses), checksums ("*"),
+ and "%" program delimiters are skipped, and lines without any words are skipped too.
+*/
+class GcodeParser {
+public:
+    explicit GcodeParser(std::istream &input);
+    GcodeParser(const GcodeParser &rhs) = delete;
+
+    // Reads the next line with any words into line. Returns false at the end of the input. Throws
+    // FormatError for malformed or overlong lines, and IOError if the stream fails.
+    bool next(GcodeLine &line);
+    // The number of lines read so far.
+    uint64_t getLineNumber() const;
+
+    // Parses a single line of text. Throws FormatError if it's malformed.
+    static void parse(const char *text, const uint64_t lineNumber, GcodeLine &line);
+
+private:
+    std::istream &input;
+    char buffer[GCODE_MAX_LINE_LENGTH + 1];
+    uint64_t lineNumber;
+};
+
+}
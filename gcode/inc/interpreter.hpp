@@ -0,0 +1,107 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <istream>
+#include <gcode.hpp>
+#include <planner.hpp>
+
+namespace libstepper {
+
+/**
+ Maps a G-code axis letter (X, Y, Z, A, B, or C) to an axis of a BlockExecutor.
+*/
+struct GcodeAxis {
+    char letter;
+    size_t axis;
+    double stepsPerMillimeter;
+    // In mm/s. 0 is unlimited, apart from the executor's own limit (see BlockExecutor::getMaxStepRate()).
+    double maxSpeed;
+};
+
+struct GcodeConfig {
+    GcodeConfig();
+
+    // In mm/s^2
+    double acceleration;
+    // How far the path may deviate from a corner (in mm) when taking it without stopping. Higher values
+    // take corners faster.
+    double junctionDeviation;
+    // The feed rate for G0, and the feed rate for G1/G2/G3 until the job sets one, in mm/min.
+    double rapidFeedRate;
+    double defaultFeedRate;
+    // How many blocks the planner looks ahead.
+    size_t lookahead;
+};
+
+/**
+ Streams a G-code job to a BlockExecutor (e.g. a MultiAxisExecutor) through a LookaheadPlanner. The job is
+ parsed, planned, and executed as it's read, one line at a time, so memory use doesn't depend on its
+ length, and motion starts as soon as the planner's queue fills up.
+
+ The supported subset is:
+ - G0/G1: rapid and linear moves.
+ - G2/G3: clockwise and counter clockwise arcs in the XY plane (G17), with the center given by I/J
+   offsets, or by the radius R. The X and Y axes must have the same steps per millimeter.
+ - G4: dwell for P milliseconds, or S seconds.
+ - G28: move to the origin, through an intermediate point if any axes are given.
+ - G20/G21: inches and millimeters.
+ - G90/G91: absolute and relative coordinates.
+ - F: the feed rate, in units per minute.
+
+ Any other G-code, or an axis letter that isn't mapped, throws FormatError, with the line number. Other
+ words (M, S, T, N, etc.) are ignored.
+*/
+class GcodeInterpreter {
+public:
+    // Throws std::invalid_argument if the axes or the config are invalid.
+    GcodeInterpreter(BlockExecutor &executor, const std::vector<GcodeAxis> &axes, const GcodeConfig &config = GcodeConfig());
+    GcodeInterpreter(const GcodeInterpreter &rhs) = delete;
+
+    // Runs a whole job, between BlockExecutor::begin() and end(). Returns false if the executor stopped
+    // the job (e.g. if it was interrupted).
+    bool run(std::istream &input);
+
+    // The number of lines read, and the number of blocks planned so far.
+    uint64_t getLineCount() const;
+    uint64_t getBlockCount() const;
+    // The position of an axis, in mm. Throws std::invalid_argument if the letter isn't mapped.
+    double getPosition(const char letter) const;
+
+private:
+    bool execute(const GcodeLine &line);
+    void setTargets(const GcodeLine &line);
+    bool moveLinear(const bool rapid);
+    bool moveArc(const GcodeLine &line, const RotationDirection direction);
+    bool dwell(const GcodeLine &line);
+    bool home(const GcodeLine &line);
+    bool push();
+    size_t findAxis(const char letter) const;
+
+    BlockExecutor &executor;
+    std::vector<GcodeAxis> axes;
+    std::vector<double> maxSpeeds;
+    const GcodeConfig config;
+    LookaheadPlanner planner;
+
+    // The modal state
+    bool absolute;
+    double unitScale;
+    double feedRate;
+    int motionMode;
+
+    std::vector<double> positions;
+    std::vector<int64_t> stepPositions;
+    std::vector<double> targets;
+    PlannerBlock block;
+
+    uint64_t lineCount;
+    uint64_t blockCount;
+};
+
+}
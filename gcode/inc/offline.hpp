@@ -0,0 +1,81 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <planner.hpp>
+#include <stepqueue.hpp>
+
+namespace libstepper {
+
+// The default number of blocks planned by one thread at a time.
+static const size_t OFFLINE_PLANNER_CHUNK_SIZE = 4096;
+
+struct OfflineAxis {
+    uint64_t stepsInRotation;
+    // The most steps per second the axis can take, or 0 if it's unlimited.
+    double maxStepRate;
+};
+
+/**
+ Plans a whole job ahead of time, and renders every axis's steps as StepQueues, for playback with
+ StepperDriver::play(). Blocks are collected as a BlockExecutor (e.g. from a GcodeInterpreter), and
+ plan() then works on chunks of them in parallel:
+
+ 1. The backward (deceleration) pass runs on every chunk at once, assuming that the chunk can end at
+    the highest entry speed of the next chunk. A fix-up pass then walks the chunk boundaries from the
+    end of the job, correcting each chunk from its end only as far as its speeds actually change.
+ 2. The forward (acceleration) pass does the same from the start of the job.
+ 3. The blocks' durations are computed, and every chunk's steps are rendered at once, with each axis's
+    first step in a chunk timed against its last step in the previous chunks when the chunks are joined.
+
+ The result doesn't depend on the thread count or the chunk size.
+*/
+class OfflinePlanner : public BlockExecutor {
+public:
+    // Throws std::invalid_argument if there are no axes, more than PLANNER_MAX_AXES, or the chunk size is 0.
+    OfflinePlanner(const std::vector<OfflineAxis> &axes, const size_t chunkSize = OFFLINE_PLANNER_CHUNK_SIZE, const uint32_t maxErrorMicros = 0);
+    OfflinePlanner(const OfflinePlanner &rhs) = delete;
+
+    size_t getAxisCount() const;
+    double getMaxStepRate(const size_t axis) const;
+    // Starts a new job
+    void begin();
+    void end();
+    // Collects a block. Its max entry speed is kept, and its entry and exit speeds are planned by plan().
+    bool execute(const PlannerBlock &block);
+
+    // Plans the collected blocks on threadCount threads, or one per core if 0.
+    void plan(const size_t threadCount = 0);
+    // Writes every axis's steps to a trajectory file, for StepperDriver::play(const TrajectoryFile &).
+    // Throws std::invalid_argument if there isn't a path for every axis.
+    void write(const std::vector<std::string> &paths) const;
+
+    const std::vector<PlannerBlock> &getBlocks() const;
+    // The steps of an axis, as one StepQueue per run in the same direction
+    const std::vector<StepQueue> &getQueues(const size_t axis) const;
+    uint64_t getDurationMicros() const;
+
+private:
+    struct Chunk;
+
+    void planBackward(const size_t threadCount);
+    void planForward(const size_t threadCount);
+    void render(const size_t threadCount);
+    void renderChunk(Chunk &chunk) const;
+
+    std::vector<OfflineAxis> axes;
+    const size_t chunkSize;
+    const uint32_t maxErrorMicros;
+    std::vector<PlannerBlock> blocks;
+    // When every block starts, in microseconds, with one extra entry for the end of the job
+    std::vector<double> startMicros;
+    std::vector<std::vector<StepQueue> > queues;
+};
+
+}
@@ -0,0 +1,123 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <direction.hpp>
+
+namespace libstepper {
+
+// The most axes a planned block can move.
+static const size_t PLANNER_MAX_AXES = 8;
+
+/**
+ One move of a job, as planned by LookaheadPlanner. Distances are in mm, and speeds in mm/s. Steps are
+ relative to the end of the previous block, with positive steps being COUNTER_CLOCKWISE.
+*/
+struct PlannerBlock {
+    enum Type {
+        LINEAR,
+        ARC,
+        DWELL
+    };
+
+    Type type;
+    size_t axisCount;
+    int64_t steps[PLANNER_MAX_AXES];
+
+    // For ARC blocks: the axes of the plane, the center relative to the start in steps, and the direction.
+    size_t xAxis;
+    size_t yAxis;
+    int64_t centerX;
+    int64_t centerY;
+    RotationDirection direction;
+
+    // For DWELL blocks
+    uint64_t dwellMicros;
+
+    double length;
+    // The distance moved by a tick of weight TICK_WEIGHT_UNIT. See MultiAxisController::run().
+    double distancePerTick;
+    double nominalSpeed;
+    double acceleration;
+    // The directions of motion at the start and the end, as unit vectors in mm.
+    double entryDirection[PLANNER_MAX_AXES];
+    double exitDirection[PLANNER_MAX_AXES];
+
+    // Filled in by the planner
+    double maxEntrySpeed;
+    double entrySpeed;
+    double exitSpeed;
+};
+
+/**
+ Runs planned blocks, e.g. on a MultiAxisController (see MultiAxisExecutor).
+*/
+class BlockExecutor {
+public:
+    virtual ~BlockExecutor() {
+    }
+
+    virtual size_t getAxisCount() const = 0;
+    // The most steps per second an axis can take, or 0 if it's unlimited.
+    virtual double getMaxStepRate(const size_t axis) const = 0;
+
+    // Called before the first block of a job, and after the last one.
+    virtual void begin() = 0;
+    virtual void end() = 0;
+    // Runs a block from its entry speed to its exit speed. Returns false if the job should stop.
+    virtual bool execute(const PlannerBlock &block) = 0;
+};
+
+/**
+ Plans the speeds of a queue of blocks ahead of execution, so that the machine doesn't stop at every
+ junction. The speed through a junction is limited by the angle between the blocks (with the junction
+ deviation model), and by the acceleration: every block can slow down to a stop by the end of the newest
+ queued block, so the queue can always be executed as is. Once the queue is full, the oldest block is
+ executed to make room for the next one.
+
+ The queue has a fixed capacity, and is allocated once.
+*/
+class LookaheadPlanner {
+public:
+    // Throws std::invalid_argument if the capacity is less than 2, or the junction deviation is negative.
+    LookaheadPlanner(BlockExecutor &executor, const size_t capacity, const double junctionDeviation);
+    LookaheadPlanner(const LookaheadPlanner &rhs) = delete;
+
+    // Queues a block, executing the oldest one first if the queue is full. Returns false if the executor
+    // stopped the job.
+    bool push(const PlannerBlock &block);
+    // Executes every queued block, ending at rest. Returns false if the executor stopped the job.
+    bool flush();
+    // Drops the queued blocks without executing them.
+    void clear();
+
+    size_t size() const;
+    size_t getCapacity() const;
+    // The number of blocks executed so far.
+    uint64_t getExecutedCount() const;
+
+    // The highest speed through the junction between two blocks.
+    static double getJunctionSpeed(const PlannerBlock &previous, const PlannerBlock &next, const double junctionDeviation);
+
+private:
+    PlannerBlock &at(const size_t index);
+    bool executeOldest();
+    void recalculate();
+
+    BlockExecutor &executor;
+    std::vector<PlannerBlock> blocks;
+    size_t head;
+    size_t count;
+    const double junctionDeviation;
+    // The last block pushed, for the junction with the next one
+    PlannerBlock previous;
+    bool hasPrevious;
+    uint64_t executedCount;
+};
+
+}
@@ -0,0 +1,71 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <executor.hpp>
+#include <interpolator.hpp>
+#include <stdexcept>
+
+using namespace std;
+
+namespace libstepper {
+
+MultiAxisExecutor::MultiAxisExecutor(MultiAxisController &controller) : controller(controller), steps(controller.getAxisCount(), 0) {
+    if (controller.getAxisCount() > PLANNER_MAX_AXES) {
+        throw invalid_argument("Too many axes for the planner");
+    }
+}
+
+size_t MultiAxisExecutor::getAxisCount() const {
+    return controller.getAxisCount();
+}
+
+double MultiAxisExecutor::getMaxStepRate(const size_t axis) const {
+    const StepperDriver &driver = controller.getAxis(axis);
+    if (driver.getMaxSafeRPM() == UINT64_MAX) {
+        return 0;
+    }
+    return (double) driver.getMaxSafeRPM() * (double) driver.getStepsInRotation() / 60.0;
+}
+
+void MultiAxisExecutor::begin() {
+    controller.begin();
+}
+
+void MultiAxisExecutor::end() {
+    controller.end();
+}
+
+bool MultiAxisExecutor::execute(const PlannerBlock &block) {
+    if (block.type == PlannerBlock::DWELL) {
+        return controller.dwell(block.dwellMicros);
+    }
+
+    PathProfile profile;
+    profile.length = block.length;
+    profile.distancePerTick = block.distancePerTick;
+    profile.entrySpeed = block.entrySpeed;
+    profile.cruiseSpeed = block.nominalSpeed;
+    profile.exitSpeed = block.exitSpeed;
+    profile.acceleration = block.acceleration;
+
+    if (block.type == PlannerBlock::ARC) {
+        ArcInterpolator interpolator(steps.size(),
+                                     block.xAxis,
+                                     block.yAxis,
+                                     block.steps[block.xAxis],
+                                     block.steps[block.yAxis],
+                                     block.centerX,
+                                     block.centerY,
+                                     block.direction);
+        return controller.run(interpolator, profile);
+    }
+
+    for (size_t i = 0; i < steps.size(); ++i) {
+        steps[i] = block.steps[i];
+    }
+    LinearInterpolator interpolator(steps);
+    return controller.run(interpolator, profile);
+}
+
+}
@@ -0,0 +1,211 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <gcode.hpp>
+#include <exception.hpp>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace libstepper {
+
+static string describeLine(const uint64_t lineNumber) {
+    return "line " + to_string(lineNumber);
+}
+
+static bool isLetter(const char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+static bool isDigit(const char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool isSpace(const char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static char toUpper(const char c) {
+    return c >= 'a' && c <= 'z' ? (char) (c - 'a' + 'A') : c;
+}
+
+// Parses [+-]digits[.digits] at text, and advances it past the number.
+static double parseNumber(const char *&text, const uint64_t lineNumber) {
+    bool negative = false;
+    if (*text == '+' || *text == '-') {
+        negative = *text == '-';
+        ++text;
+    }
+
+    // Accumulating the digits as an integer, and scaling once, keeps values like 0.1 as exact as strtod.
+    uint64_t mantissa = 0;
+    double scale = 1;
+    size_t digits = 0;
+    bool fraction = false;
+    for (;; ++text) {
+        if (isDigit(*text)) {
+            if (mantissa < 100000000000000000ULL) {
+                mantissa = mantissa * 10 + (uint64_t) (*text - '0');
+                if (fraction) {
+                    scale *= 10;
+                }
+            } else if (!fraction) {
+                throw FormatError("Number too long on " + describeLine(lineNumber));
+            }
+            ++digits;
+        } else if (*text == '.' && !fraction) {
+            fraction = true;
+        } else {
+            break;
+        }
+    }
+
+    if (digits == 0) {
+        throw FormatError("Expected a number on " + describeLine(lineNumber));
+    }
+
+    const double value = (double) mantissa / scale;
+    return negative ? -value : value;
+}
+
+GcodeLine::GcodeLine() {
+    clear();
+}
+
+void GcodeLine::clear() {
+    present = 0;
+    gCodeCount = 0;
+    lineNumber = 0;
+}
+
+bool GcodeLine::empty() const {
+    return present == 0 && gCodeCount == 0;
+}
+
+bool GcodeLine::has(const char letter) const {
+    const char upper = toUpper(letter);
+    return upper >= 'A' && upper <= 'Z' && (present & (1u << (upper - 'A'))) != 0;
+}
+
+double GcodeLine::get(const char letter) const {
+    if (!has(letter)) {
+        throw out_of_range(string("No ") + letter + " word on " + describeLine(lineNumber));
+    }
+    return values[toUpper(letter) - 'A'];
+}
+
+double GcodeLine::get(const char letter, const double fallback) const {
+    return has(letter) ? values[toUpper(letter) - 'A'] : fallback;
+}
+
+void GcodeLine::set(const char letter, const double value) {
+    const char upper = toUpper(letter);
+    if (upper < 'A' || upper > 'Z') {
+        throw FormatError(string("Invalid word ") + letter + " on " + describeLine(lineNumber));
+    }
+
+    if (upper == 'G') {
+        if (gCodeCount == GCODE_MAX_G_WORDS) {
+            throw FormatError("Too many G words on " + describeLine(lineNumber));
+        }
+        gCodes[gCodeCount++] = value;
+        return;
+    }
+
+    if (has(upper)) {
+        throw FormatError(string("Repeated ") + upper + " word on " + describeLine(lineNumber));
+    }
+    values[upper - 'A'] = value;
+    present |= 1u << (upper - 'A');
+}
+
+size_t GcodeLine::getGCodeCount() const {
+    return gCodeCount;
+}
+
+double GcodeLine::getGCode(const size_t index) const {
+    if (index >= gCodeCount) {
+        throw out_of_range("G word index out of range");
+    }
+    return gCodes[index];
+}
+
+uint64_t GcodeLine::getLineNumber() const {
+    return lineNumber;
+}
+
+void GcodeLine::setLineNumber(const uint64_t lineNumber) {
+    this->lineNumber = lineNumber;
+}
+
+GcodeParser::GcodeParser(istream &input) : input(input), lineNumber(0) {
+}
+
+uint64_t GcodeParser::getLineNumber() const {
+    return lineNumber;
+}
+
+bool GcodeParser::next(GcodeLine &line) {
+    while (true) {
+        input.getline(buffer, sizeof(buffer));
+
+        if (input.bad()) {
+            throw IOError("Failed to read " + describeLine(lineNumber + 1));
+        }
+
+        if (input.fail()) {
+            if (input.eof() && input.gcount() == 0) {
+                return false;
+            }
+            // getline() fills the buffer without finding the end of the line
+            throw FormatError(describeLine(lineNumber + 1) + " is longer than " + to_string(GCODE_MAX_LINE_LENGTH) + " characters");
+        }
+
+        ++lineNumber;
+        parse(buffer, lineNumber, line);
+        if (!line.empty()) {
+            return true;
+        }
+
+        if (input.eof()) {
+            return false;
+        }
+    }
+}
+
+void GcodeParser::parse(const char *text, const uint64_t lineNumber, GcodeLine &line) {
+    line.clear();
+    line.setLineNumber(lineNumber);
+
+    while (*text != '\0') {
+        const char c = *text;
+        if (isSpace(c) || c == '%') {
+            ++text;
+        } else if (c == ';') {
+            return;
+        } else if (c == '*') {
+            // Checksums are for the transport, and are checked by the sender if at all
+            return;
+        } else if (c == '(') {
+            while (*text != '\0' && *text != ')') {
+                ++text;
+            }
+            if (*text == '\0') {
+                throw FormatError("Unterminated comment on " + describeLine(lineNumber));
+            }
+            ++text;
+        } else if (isLetter(c)) {
+            ++text;
+            while (isSpace(*text)) {
+                ++text;
+            }
+            line.set(c, parseNumber(text, lineNumber));
+        } else {
+            throw FormatError(string("Unexpected character '") + c + "' on " + describeLine(lineNumber));
+        }
+    }
+}
+
+}
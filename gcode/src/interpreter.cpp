@@ -0,0 +1,468 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <interpreter.hpp>
+#include <exception.hpp>
+#include <interpolator.hpp>
+#include <stdexcept>
+#include <string>
+#include <sstream>
+#include <cmath>
+
+using namespace std;
+
+namespace libstepper {
+
+static const size_t NO_AXIS = SIZE_MAX;
+static const char AXIS_LETTERS[] = { 'X', 'Y', 'Z', 'A', 'B', 'C' };
+static const double MILLIMETERS_PER_INCH = 25.4;
+static const double PI = 3.14159265358979323846;
+
+// The arc's ticks, weighed the way the ArcInterpolator's are timed, in closed form rather than by tracing the
+// arc. Between the 45 degree points, the interpolator steps the faster moving axis on every tick, and the
+// other one too on some of them, which makes those ticks diagonal.
+static double getArcTicks(const double radius, const double startAngle, const double sweep, const double orientation) {
+    const double octant = PI / 4;
+    double weight = 0;
+    double from = 0;
+    while (from < sweep) {
+        // The next 45 degree point along the arc, from the start
+        const double angle = startAngle + orientation * from;
+        const double boundary = orientation > 0 ? (floor(angle / octant) + 1) * octant : (ceil(angle / octant) - 1) * octant;
+        const double to = min(sweep, max(from + orientation * (boundary - angle), from + 1e-12));
+        const double endAngle = startAngle + orientation * to;
+
+        const double dx = abs(radius * (cos(endAngle) - cos(angle)));
+        const double dy = abs(radius * (sin(endAngle) - sin(angle)));
+        weight += max(dx, dy) * TICK_WEIGHT_UNIT + min(dx, dy) * (DIAGONAL_TICK_WEIGHT - TICK_WEIGHT_UNIT);
+        from = to;
+    }
+    return weight / TICK_WEIGHT_UNIT;
+}
+
+static string describeLine(const GcodeLine &line) {
+    return "line " + to_string(line.getLineNumber());
+}
+
+static string describeCode(const double code) {
+    ostringstream stream;
+    stream << "G" << code;
+    return stream.str();
+}
+
+static bool isAxisLetter(const char letter) {
+    for (size_t i = 0; i < sizeof(AXIS_LETTERS); ++i) {
+        if (AXIS_LETTERS[i] == letter) {
+            return true;
+        }
+    }
+    return false;
+}
+
+GcodeConfig::GcodeConfig()
+    : acceleration(500), junctionDeviation(0.01), rapidFeedRate(3000), defaultFeedRate(600), lookahead(16) {
+}
+
+GcodeInterpreter::GcodeInterpreter(BlockExecutor &executor, const vector<GcodeAxis> &axes, const GcodeConfig &config)
+    : executor(executor),
+      axes(axes),
+      config(config),
+      planner(executor, config.lookahead, config.junctionDeviation),
+      absolute(true),
+      unitScale(1),
+      feedRate(config.defaultFeedRate / 60),
+      motionMode(0),
+      positions(axes.size(), 0),
+      stepPositions(axes.size(), 0),
+      targets(axes.size(), 0),
+      lineCount(0),
+      blockCount(0) {
+
+    if (axes.empty()) {
+        throw invalid_argument("The interpreter needs at least 1 axis");
+    }
+    if (executor.getAxisCount() > PLANNER_MAX_AXES) {
+        throw invalid_argument("Too many axes for the planner");
+    }
+    if (!(config.acceleration > 0) || !(config.rapidFeedRate > 0) || !(config.defaultFeedRate > 0)) {
+        throw invalid_argument("The acceleration and the feed rates must be positive");
+    }
+
+    for (size_t i = 0; i < axes.size(); ++i) {
+        const GcodeAxis &axis = axes[i];
+        if (!isAxisLetter(axis.letter)) {
+            throw invalid_argument(string("Unsupported axis letter ") + axis.letter);
+        }
+        if (axis.axis >= executor.getAxisCount()) {
+            throw invalid_argument(string("Axis ") + axis.letter + " is out of the executor's range");
+        }
+        if (!(axis.stepsPerMillimeter > 0) || axis.maxSpeed < 0) {
+            throw invalid_argument(string("Invalid steps per millimeter or max speed for axis ") + axis.letter);
+        }
+        for (size_t j = 0; j < i; ++j) {
+            if (axes[j].letter == axis.letter || axes[j].axis == axis.axis) {
+                throw invalid_argument(string("Axis ") + axis.letter + " is mapped more than once");
+            }
+        }
+
+        double maxSpeed = axis.maxSpeed > 0 ? axis.maxSpeed : HUGE_VAL;
+        const double maxStepRate = executor.getMaxStepRate(axis.axis);
+        if (maxStepRate > 0) {
+            maxSpeed = min(maxSpeed, maxStepRate / axis.stepsPerMillimeter);
+        }
+        maxSpeeds.push_back(maxSpeed);
+    }
+}
+
+uint64_t GcodeInterpreter::getLineCount() const {
+    return lineCount;
+}
+
+uint64_t GcodeInterpreter::getBlockCount() const {
+    return blockCount;
+}
+
+double GcodeInterpreter::getPosition(const char letter) const {
+    const size_t index = findAxis(letter);
+    if (index == NO_AXIS) {
+        throw invalid_argument(string("No axis ") + letter);
+    }
+    return positions[index];
+}
+
+size_t GcodeInterpreter::findAxis(const char letter) const {
+    for (size_t i = 0; i < axes.size(); ++i) {
+        if (axes[i].letter == letter) {
+            return i;
+        }
+    }
+    return NO_AXIS;
+}
+
+bool GcodeInterpreter::run(istream &input) {
+    GcodeParser parser(input);
+    GcodeLine line;
+    bool completed = true;
+
+    executor.begin();
+    try {
+        while (completed && parser.next(line)) {
+            lineCount = parser.getLineNumber();
+            completed = execute(line);
+        }
+        lineCount = parser.getLineNumber();
+        completed = completed && planner.flush();
+    } catch (...) {
+        planner.clear();
+        executor.end();
+        throw;
+    }
+
+    planner.clear();
+    executor.end();
+    return completed;
+}
+
+bool GcodeInterpreter::execute(const GcodeLine &line) {
+    bool isDwell = false;
+    bool isHome = false;
+
+    for (size_t i = 0; i < line.getGCodeCount(); ++i) {
+        const double code = line.getGCode(i);
+        if (code != floor(code)) {
+            throw FormatError("Unsupported G-code " + describeCode(code) + " on " + describeLine(line));
+        }
+
+        switch ((int) code) {
+        case 0:
+        case 1:
+        case 2:
+        case 3:
+            motionMode = (int) code;
+            break;
+        case 4:
+            isDwell = true;
+            break;
+        case 17:
+            break;
+        case 20:
+            unitScale = MILLIMETERS_PER_INCH;
+            break;
+        case 21:
+            unitScale = 1;
+            break;
+        case 28:
+            isHome = true;
+            break;
+        case 90:
+            absolute = true;
+            break;
+        case 91:
+            absolute = false;
+            break;
+        default:
+            throw FormatError("Unsupported G-code " + describeCode(code) + " on " + describeLine(line));
+        }
+    }
+
+    if (line.has('F')) {
+        const double feed = line.get('F');
+        if (!(feed > 0)) {
+            throw FormatError("The feed rate must be positive on " + describeLine(line));
+        }
+        feedRate = feed * unitScale / 60;
+    }
+
+    bool hasAxisWords = false;
+    for (size_t i = 0; i < sizeof(AXIS_LETTERS); ++i) {
+        if (line.has(AXIS_LETTERS[i])) {
+            if (findAxis(AXIS_LETTERS[i]) == NO_AXIS) {
+                throw FormatError(string("Axis ") + AXIS_LETTERS[i] + " isn't mapped, on " + describeLine(line));
+            }
+            hasAxisWords = true;
+        }
+    }
+
+    if (isDwell) {
+        return dwell(line);
+    }
+    if (isHome) {
+        return home(line);
+    }
+
+    switch (motionMode) {
+    case 2:
+    case 3:
+        if (!hasAxisWords && !line.has('I') && !line.has('J') && !line.has('R')) {
+            return true;
+        }
+        return moveArc(line, motionMode == 2 ? CLOCKWISE : COUNTER_CLOCKWISE);
+    default:
+        if (!hasAxisWords) {
+            return true;
+        }
+        setTargets(line);
+        return moveLinear(motionMode == 0);
+    }
+}
+
+void GcodeInterpreter::setTargets(const GcodeLine &line) {
+    for (size_t i = 0; i < axes.size(); ++i) {
+        if (!line.has(axes[i].letter)) {
+            targets[i] = positions[i];
+        } else {
+            const double value = line.get(axes[i].letter) * unitScale;
+            targets[i] = absolute ? value : positions[i] + value;
+        }
+    }
+}
+
+bool GcodeInterpreter::push() {
+    ++blockCount;
+    return planner.push(block);
+}
+
+bool GcodeInterpreter::moveLinear(const bool rapid) {
+    block.type = PlannerBlock::LINEAR;
+    block.axisCount = executor.getAxisCount();
+    for (size_t i = 0; i < block.axisCount; ++i) {
+        block.steps[i] = 0;
+        block.entryDirection[i] = 0;
+    }
+
+    // The steps are rounded from the absolute targets, rather than the relative distances, so that
+    // rounding errors don't accumulate over a job.
+    double lengthSquared = 0;
+    uint64_t tickCount = 0;
+    for (size_t i = 0; i < axes.size(); ++i) {
+        const int64_t target = llround(targets[i] * axes[i].stepsPerMillimeter);
+        const int64_t delta = target - stepPositions[i];
+        const double distance = (double) delta / axes[i].stepsPerMillimeter;
+
+        block.steps[axes[i].axis] = delta;
+        block.entryDirection[axes[i].axis] = distance;
+        lengthSquared += distance * distance;
+        tickCount = max(tickCount, (uint64_t) (delta < 0 ? -delta : delta));
+
+        positions[i] = targets[i];
+        stepPositions[i] = target;
+    }
+
+    if (tickCount == 0) {
+        return true;
+    }
+
+    block.length = sqrt(lengthSquared);
+    block.distancePerTick = block.length / (double) tickCount;
+    block.nominalSpeed = rapid ? config.rapidFeedRate / 60 : feedRate;
+    block.acceleration = config.acceleration;
+
+    for (size_t i = 0; i < axes.size(); ++i) {
+        double &direction = block.entryDirection[axes[i].axis];
+        direction /= block.length;
+        if (direction != 0) {
+            block.nominalSpeed = min(block.nominalSpeed, maxSpeeds[i] / fabs(direction));
+        }
+    }
+    for (size_t i = 0; i < block.axisCount; ++i) {
+        block.exitDirection[i] = block.entryDirection[i];
+    }
+
+    return push();
+}
+
+bool GcodeInterpreter::moveArc(const GcodeLine &line, const RotationDirection direction) {
+    const size_t x = findAxis('X');
+    const size_t y = findAxis('Y');
+    if (x == NO_AXIS || y == NO_AXIS) {
+        throw FormatError("Arcs need the X and Y axes, on " + describeLine(line));
+    }
+    if (axes[x].stepsPerMillimeter != axes[y].stepsPerMillimeter) {
+        throw FormatError("Arcs need X and Y to have the same steps per millimeter, on " + describeLine(line));
+    }
+
+    setTargets(line);
+    for (size_t i = 0; i < axes.size(); ++i) {
+        if (i != x && i != y && targets[i] != positions[i]) {
+            throw FormatError("Helical arcs aren't supported, on " + describeLine(line));
+        }
+    }
+
+    const double stepsPerMillimeter = axes[x].stepsPerMillimeter;
+    double centerX;
+    double centerY;
+    if (line.has('R')) {
+        // The center is on the perpendicular bisector of the chord, to the right of it for clockwise
+        // arcs. A negative radius picks the other center, for arcs of more than half a circle.
+        const double radius = line.get('R') * unitScale;
+        const double dx = targets[x] - positions[x];
+        const double dy = targets[y] - positions[y];
+        const double chord = sqrt(dx * dx + dy * dy);
+        if (chord == 0) {
+            throw FormatError("Full circles need I and J, on " + describeLine(line));
+        }
+
+        double heightSquared = radius * radius - chord * chord / 4;
+        if (heightSquared < 0) {
+            if (heightSquared < -1e-6 * radius * radius) {
+                throw FormatError("The arc radius is too small for its end point, on " + describeLine(line));
+            }
+            heightSquared = 0;
+        }
+
+        double height = sqrt(heightSquared) / chord;
+        if ((direction == CLOCKWISE) != (radius < 0)) {
+            height = -height;
+        }
+        centerX = positions[x] + dx / 2 - height * dy;
+        centerY = positions[y] + dy / 2 + height * dx;
+    } else {
+        centerX = positions[x] + line.get('I', 0) * unitScale;
+        centerY = positions[y] + line.get('J', 0) * unitScale;
+    }
+
+    const int64_t targetX = llround(targets[x] * stepsPerMillimeter);
+    const int64_t targetY = llround(targets[y] * stepsPerMillimeter);
+
+    block.type = PlannerBlock::ARC;
+    block.axisCount = executor.getAxisCount();
+    for (size_t i = 0; i < block.axisCount; ++i) {
+        block.steps[i] = 0;
+        block.entryDirection[i] = 0;
+        block.exitDirection[i] = 0;
+    }
+    block.xAxis = axes[x].axis;
+    block.yAxis = axes[y].axis;
+    block.steps[block.xAxis] = targetX - stepPositions[x];
+    block.steps[block.yAxis] = targetY - stepPositions[y];
+    block.centerX = llround(centerX * stepsPerMillimeter) - stepPositions[x];
+    block.centerY = llround(centerY * stepsPerMillimeter) - stepPositions[y];
+    block.direction = direction;
+
+    if ((block.centerX == 0 && block.centerY == 0) ||
+        (block.centerX == block.steps[block.xAxis] && block.centerY == block.steps[block.yAxis])) {
+        throw FormatError("The arc has no radius, on " + describeLine(line));
+    }
+
+    // The start and the end, relative to the center
+    const double startX = (double) -block.centerX;
+    const double startY = (double) -block.centerY;
+    const double endX = (double) (block.steps[block.xAxis] - block.centerX);
+    const double endY = (double) (block.steps[block.yAxis] - block.centerY);
+    const double radius = sqrt(startX * startX + startY * startY);
+    const double endRadius = sqrt(endX * endX + endY * endY);
+
+    // The angle swept, which is a full circle if the arc ends where it starts
+    double sweep = atan2(endY, endX) - atan2(startY, startX);
+    if (direction == CLOCKWISE) {
+        sweep = -sweep;
+    }
+    if (sweep <= 0) {
+        sweep += 2 * PI;
+    }
+
+    // The tangents at the start and the end
+    const double orientation = direction == COUNTER_CLOCKWISE ? 1 : -1;
+    block.entryDirection[block.xAxis] = -orientation * startY / radius;
+    block.entryDirection[block.yAxis] = orientation * startX / radius;
+    block.exitDirection[block.xAxis] = -orientation * endY / endRadius;
+    block.exitDirection[block.yAxis] = orientation * endX / endRadius;
+
+    block.length = radius * sweep / stepsPerMillimeter;
+    // Spread over the ticks the arc actually takes, so that they add up to its length, and the last ones don't
+    // run past the end of the speed profile
+    block.distancePerTick = block.length / getArcTicks(radius, atan2(startY, startX), sweep, orientation);
+    block.acceleration = config.acceleration;
+    // Neither axis moves faster than the path, and the centripetal acceleration is limited too.
+    block.nominalSpeed = min(feedRate, min(maxSpeeds[x], maxSpeeds[y]));
+    block.nominalSpeed = min(block.nominalSpeed, sqrt(config.acceleration * radius / stepsPerMillimeter));
+
+    positions[x] = targets[x];
+    positions[y] = targets[y];
+    stepPositions[x] = targetX;
+    stepPositions[y] = targetY;
+    return push();
+}
+
+bool GcodeInterpreter::dwell(const GcodeLine &line) {
+    const double seconds = line.has('P') ? line.get('P') / 1000 : line.get('S', 0);
+    if (seconds < 0) {
+        throw FormatError("The dwell time can't be negative, on " + describeLine(line));
+    }
+
+    block.type = PlannerBlock::DWELL;
+    block.axisCount = executor.getAxisCount();
+    for (size_t i = 0; i < block.axisCount; ++i) {
+        block.steps[i] = 0;
+        block.entryDirection[i] = 0;
+        block.exitDirection[i] = 0;
+    }
+    block.dwellMicros = (uint64_t) llround(seconds * 1000000);
+    block.length = 0;
+    block.distancePerTick = 0;
+    block.nominalSpeed = 0;
+    block.acceleration = config.acceleration;
+    return push();
+}
+
+bool GcodeInterpreter::home(const GcodeLine &line) {
+    bool hasAxisWords = false;
+    for (size_t i = 0; i < axes.size(); ++i) {
+        hasAxisWords = hasAxisWords || line.has(axes[i].letter);
+    }
+
+    if (hasAxisWords) {
+        setTargets(line);
+        if (!moveLinear(true)) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < axes.size(); ++i) {
+        targets[i] = !hasAxisWords || line.has(axes[i].letter) ? 0 : positions[i];
+    }
+    return moveLinear(true);
+}
+
+}
@@ -0,0 +1,443 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <offline.hpp>
+#include <interpolator.hpp>
+#include <trajectory.hpp>
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <exception>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <cmath>
+
+using namespace std;
+
+namespace libstepper {
+
+// Runs task(0) to task(taskCount - 1) on up to threadCount threads, including the calling one. The first
+// exception thrown by any task is rethrown once they're all done.
+static void runInParallel(const size_t taskCount, const size_t threadCount, const function<void(size_t)> &task) {
+    atomic<size_t> nextTask(0);
+    exception_ptr error;
+    mutex errorMutex;
+
+    auto worker = [&]() {
+        for (size_t i = nextTask++; i < taskCount; i = nextTask++) {
+            try {
+                task(i);
+            } catch (...) {
+                unique_lock<mutex> lock(errorMutex);
+                if (!error) {
+                    error = current_exception();
+                }
+            }
+        }
+    };
+
+    vector<thread> threads;
+    for (size_t i = 1; i < min(threadCount, taskCount); ++i) {
+        threads.push_back(thread(worker));
+    }
+    worker();
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+
+    if (error) {
+        rethrow_exception(error);
+    }
+}
+
+// The speed a block can reach over its length, starting from speed. An acceleration of 0 is unlimited.
+static double getReachableSpeed(const double speed, const PlannerBlock &block) {
+    return block.acceleration > 0 ? sqrt(speed * speed + 2 * block.acceleration * block.length) : HUGE_VAL;
+}
+
+/**
+ The time taken to reach any distance along a planned block, for its trapezoidal speed profile.
+*/
+class BlockTiming {
+public:
+    explicit BlockTiming(const PlannerBlock &block) : block(block) {
+        if (block.type == PlannerBlock::DWELL) {
+            peakSpeed = 0;
+            accelerationDistance = cruiseDistance = 0;
+            accelerationSeconds = cruiseSeconds = decelerationSeconds = 0;
+            durationSeconds = (double) block.dwellMicros / 1000000;
+            return;
+        }
+
+        if (!(block.acceleration > 0)) {
+            peakSpeed = block.nominalSpeed;
+            accelerationDistance = 0;
+            cruiseDistance = block.length;
+            accelerationSeconds = decelerationSeconds = 0;
+            cruiseSeconds = block.length / peakSpeed;
+            durationSeconds = cruiseSeconds;
+            return;
+        }
+
+        // If the block is too short to reach its nominal speed, it peaks where the ramps meet.
+        const double acceleration = block.acceleration;
+        const double entrySquared = block.entrySpeed * block.entrySpeed;
+        const double exitSquared = block.exitSpeed * block.exitSpeed;
+        const double peakSquared = min(block.nominalSpeed * block.nominalSpeed, (2 * acceleration * block.length + entrySquared + exitSquared) / 2);
+        peakSpeed = sqrt(peakSquared);
+
+        accelerationDistance = max(0.0, (peakSquared - entrySquared) / (2 * acceleration));
+        const double decelerationDistance = max(0.0, (peakSquared - exitSquared) / (2 * acceleration));
+        cruiseDistance = max(0.0, block.length - accelerationDistance - decelerationDistance);
+
+        accelerationSeconds = max(0.0, peakSpeed - block.entrySpeed) / acceleration;
+        cruiseSeconds = cruiseDistance / peakSpeed;
+        decelerationSeconds = max(0.0, peakSpeed - block.exitSpeed) / acceleration;
+        durationSeconds = accelerationSeconds + cruiseSeconds + decelerationSeconds;
+    }
+
+    double getDurationSeconds() const {
+        return durationSeconds;
+    }
+
+    // The time at which the block has moved by distance
+    double getSeconds(double distance) const {
+        distance = min(max(distance, 0.0), block.length);
+
+        if (!(block.acceleration > 0)) {
+            return distance / peakSpeed;
+        }
+        if (distance < accelerationDistance) {
+            const double speed = sqrt(block.entrySpeed * block.entrySpeed + 2 * block.acceleration * distance);
+            return (speed - block.entrySpeed) / block.acceleration;
+        }
+        if (distance <= accelerationDistance + cruiseDistance) {
+            return accelerationSeconds + (distance - accelerationDistance) / peakSpeed;
+        }
+
+        const double decelerated = distance - accelerationDistance - cruiseDistance;
+        const double speed = sqrt(max(0.0, peakSpeed * peakSpeed - 2 * block.acceleration * decelerated));
+        return min(durationSeconds, accelerationSeconds + cruiseSeconds + (peakSpeed - speed) / block.acceleration);
+    }
+
+private:
+    const PlannerBlock &block;
+    double peakSpeed;
+    double accelerationDistance;
+    double cruiseDistance;
+    double accelerationSeconds;
+    double cruiseSeconds;
+    double decelerationSeconds;
+    double durationSeconds;
+};
+
+// One axis's steps in a chunk. The first step's interval depends on the chunks before, so it's kept out of
+// the queues, and added when the chunks are joined.
+struct ChunkTrack {
+    ChunkTrack() : stepCount(0), firstStepMicros(0), lastStepMicros(0), firstDirection(CLOCKWISE) {
+    }
+
+    vector<StepQueue> queues;
+    uint64_t stepCount;
+    uint64_t firstStepMicros;
+    uint64_t lastStepMicros;
+    RotationDirection firstDirection;
+};
+
+struct OfflinePlanner::Chunk {
+    size_t begin;
+    size_t end;
+    vector<ChunkTrack> tracks;
+};
+
+OfflinePlanner::OfflinePlanner(const vector<OfflineAxis> &axes, const size_t chunkSize, const uint32_t maxErrorMicros)
+    : axes(axes), chunkSize(chunkSize), maxErrorMicros(maxErrorMicros), queues(axes.size()) {
+    if (axes.empty() || axes.size() > PLANNER_MAX_AXES) {
+        throw invalid_argument("The offline planner needs 1 to PLANNER_MAX_AXES axes");
+    }
+    if (chunkSize == 0) {
+        throw invalid_argument("The chunk size must be positive");
+    }
+}
+
+size_t OfflinePlanner::getAxisCount() const {
+    return axes.size();
+}
+
+double OfflinePlanner::getMaxStepRate(const size_t axis) const {
+    return axes.at(axis).maxStepRate;
+}
+
+void OfflinePlanner::begin() {
+    blocks.clear();
+    startMicros.clear();
+    for (size_t i = 0; i < queues.size(); ++i) {
+        queues[i].clear();
+    }
+}
+
+void OfflinePlanner::end() {
+}
+
+bool OfflinePlanner::execute(const PlannerBlock &block) {
+    blocks.push_back(block);
+    return true;
+}
+
+const vector<PlannerBlock> &OfflinePlanner::getBlocks() const {
+    return blocks;
+}
+
+const vector<StepQueue> &OfflinePlanner::getQueues(const size_t axis) const {
+    return queues.at(axis);
+}
+
+uint64_t OfflinePlanner::getDurationMicros() const {
+    return startMicros.empty() ? 0 : (uint64_t) llround(startMicros.back());
+}
+
+void OfflinePlanner::plan(const size_t threadCount) {
+    size_t threads = threadCount;
+    if (threads == 0) {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+
+    planBackward(threads);
+    planForward(threads);
+    render(threads);
+}
+
+void OfflinePlanner::planBackward(const size_t threadCount) {
+    // The entry speeds here are the highest ones every block can still stop in time from.
+    const size_t count = blocks.size();
+    const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+    runInParallel(chunkCount, threadCount, [this, count](const size_t chunk) {
+        const size_t begin = chunk * chunkSize;
+        const size_t end = min(count, begin + chunkSize);
+        double exitSpeed = end < count ? blocks[end].maxEntrySpeed : 0;
+        for (size_t i = end; i-- > begin;) {
+            blocks[i].entrySpeed = min(blocks[i].maxEntrySpeed, getReachableSpeed(exitSpeed, blocks[i]));
+            exitSpeed = blocks[i].entrySpeed;
+        }
+    });
+
+    // Every chunk assumed the highest speed at its end. Going backwards, the next chunk is final, so a
+    // chunk only needs correcting from its end until its speeds stop changing.
+    for (size_t chunk = chunkCount; chunk-- > 1;) {
+        const size_t end = chunk * chunkSize;
+        double exitSpeed = blocks[end].entrySpeed;
+        for (size_t i = end; i-- > end - chunkSize;) {
+            const double entrySpeed = min(blocks[i].maxEntrySpeed, getReachableSpeed(exitSpeed, blocks[i]));
+            if (entrySpeed == blocks[i].entrySpeed) {
+                break;
+            }
+            blocks[i].entrySpeed = entrySpeed;
+            exitSpeed = entrySpeed;
+        }
+    }
+}
+
+void OfflinePlanner::planForward(const size_t threadCount) {
+    // The exit speeds here are the final ones. The entry speeds from the backward pass are only read, and
+    // are replaced by the previous blocks' exit speeds once done.
+    const size_t count = blocks.size();
+    const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+    runInParallel(chunkCount, threadCount, [this, count](const size_t chunk) {
+        const size_t begin = chunk * chunkSize;
+        const size_t end = min(count, begin + chunkSize);
+        double entrySpeed = blocks[begin].entrySpeed;
+        for (size_t i = begin; i < end; ++i) {
+            const double nextEntrySpeed = i + 1 < count ? blocks[i + 1].entrySpeed : 0;
+            blocks[i].exitSpeed = min(nextEntrySpeed, getReachableSpeed(entrySpeed, blocks[i]));
+            entrySpeed = blocks[i].exitSpeed;
+        }
+    });
+
+    // Every chunk assumed the highest speed at its start. Going forwards, the previous chunk is final.
+    for (size_t chunk = 1; chunk < chunkCount; ++chunk) {
+        const size_t begin = chunk * chunkSize;
+        const size_t end = min(count, begin + chunkSize);
+        double entrySpeed = blocks[begin - 1].exitSpeed;
+        for (size_t i = begin; i < end; ++i) {
+            const double nextEntrySpeed = i + 1 < count ? blocks[i + 1].entrySpeed : 0;
+            const double exitSpeed = min(nextEntrySpeed, getReachableSpeed(entrySpeed, blocks[i]));
+            if (exitSpeed == blocks[i].exitSpeed) {
+                break;
+            }
+            blocks[i].exitSpeed = exitSpeed;
+            entrySpeed = exitSpeed;
+        }
+    }
+
+    runInParallel(chunkCount, threadCount, [this, count](const size_t chunk) {
+        const size_t begin = chunk * chunkSize;
+        const size_t end = min(count, begin + chunkSize);
+        for (size_t i = max<size_t>(begin, 1); i < end; ++i) {
+            blocks[i].entrySpeed = blocks[i - 1].exitSpeed;
+        }
+    });
+}
+
+void OfflinePlanner::render(const size_t threadCount) {
+    const size_t count = blocks.size();
+    const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+    // The start times are summed in order, so that they don't depend on the chunk size.
+    startMicros.assign(count + 1, 0);
+    runInParallel(chunkCount, threadCount, [this, count](const size_t chunk) {
+        const size_t begin = chunk * chunkSize;
+        const size_t end = min(count, begin + chunkSize);
+        for (size_t i = begin; i < end; ++i) {
+            startMicros[i + 1] = BlockTiming(blocks[i]).getDurationSeconds() * 1000000;
+        }
+    });
+    for (size_t i = 0; i < count; ++i) {
+        startMicros[i + 1] += startMicros[i];
+    }
+
+    vector<Chunk> chunks(chunkCount);
+    for (size_t i = 0; i < chunkCount; ++i) {
+        chunks[i].begin = i * chunkSize;
+        chunks[i].end = min(count, chunks[i].begin + chunkSize);
+        chunks[i].tracks.resize(axes.size());
+    }
+    runInParallel(chunkCount, threadCount, [this, &chunks](const size_t chunk) {
+        renderChunk(chunks[chunk]);
+    });
+
+    // Joins the chunks, timing each axis's first step in a chunk against its last step before it.
+    runInParallel(axes.size(), threadCount, [this, &chunks](const size_t axis) {
+        vector<StepQueue> &joined = queues[axis];
+        joined.clear();
+        uint64_t lastStepMicros = 0;
+
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            ChunkTrack &track = chunks[i].tracks[axis];
+            if (track.stepCount == 0) {
+                continue;
+            }
+
+            if (joined.empty() || joined.back().getDirection() != track.firstDirection) {
+                joined.push_back(StepQueue(track.firstDirection));
+            }
+            // Gaps too long for one segment (e.g. long dwells) wait out the excess first
+            uint64_t gapMicros = track.firstStepMicros - lastStepMicros;
+            while (gapMicros > UINT32_MAX) {
+                const uint64_t wait = min(gapMicros - UINT32_MAX, (uint64_t) UINT32_MAX);
+                joined.back().append(StepSegment { (uint32_t) wait, 0, 0 });
+                gapMicros -= wait;
+            }
+            StepSegment first = { (uint32_t) gapMicros, 1, 0 };
+            joined.back().append(first);
+
+            for (size_t j = 0; j < track.queues.size(); ++j) {
+                const StepQueue &queue = track.queues[j];
+                if (joined.back().getDirection() != queue.getDirection()) {
+                    joined.push_back(StepQueue(queue.getDirection()));
+                }
+                for (size_t k = 0; k < queue.size(); ++k) {
+                    joined.back().append(queue[k]);
+                }
+            }
+
+            lastStepMicros = track.lastStepMicros;
+            vector<StepQueue>().swap(track.queues);
+        }
+    });
+}
+
+void OfflinePlanner::renderChunk(Chunk &chunk) const {
+    const size_t axisCount = axes.size();
+    vector<int8_t> tickSteps(axisCount, 0);
+    vector<int64_t> deltas(axisCount, 0);
+    vector<StepQueue> runs(axisCount);
+    vector<unique_ptr<StepQueueEncoder> > encoders(axisCount);
+
+    for (size_t b = chunk.begin; b < chunk.end; ++b) {
+        const PlannerBlock &block = blocks[b];
+        if (block.type == PlannerBlock::DWELL) {
+            continue;
+        }
+
+        unique_ptr<MotionInterpolator> interpolator;
+        if (block.type == PlannerBlock::ARC) {
+            interpolator.reset(new ArcInterpolator(axisCount,
+                                                   block.xAxis,
+                                                   block.yAxis,
+                                                   block.steps[block.xAxis],
+                                                   block.steps[block.yAxis],
+                                                   block.centerX,
+                                                   block.centerY,
+                                                   block.direction));
+        } else {
+            for (size_t i = 0; i < axisCount; ++i) {
+                deltas[i] = block.steps[i];
+            }
+            interpolator.reset(new LinearInterpolator(deltas));
+        }
+
+        const BlockTiming timing(block);
+        double distance = 0;
+        while (interpolator->next(tickSteps.data())) {
+            distance += block.distancePerTick * interpolator->getTickWeight() / TICK_WEIGHT_UNIT;
+            const uint64_t stepMicros = (uint64_t) llround(startMicros[b] + timing.getSeconds(distance) * 1000000);
+
+            for (size_t i = 0; i < axisCount; ++i) {
+                if (tickSteps[i] == 0) {
+                    continue;
+                }
+
+                const RotationDirection direction = tickSteps[i] > 0 ? COUNTER_CLOCKWISE : CLOCKWISE;
+                ChunkTrack &track = chunk.tracks[i];
+                if (track.stepCount == 0) {
+                    track.firstStepMicros = stepMicros;
+                    track.firstDirection = direction;
+                    runs[i] = StepQueue(direction);
+                    encoders[i].reset(new StepQueueEncoder(runs[i], maxErrorMicros));
+                } else {
+                    if (direction != runs[i].getDirection()) {
+                        encoders[i]->flush();
+                        if (!runs[i].empty()) {
+                            track.queues.push_back(runs[i]);
+                        }
+                        runs[i] = StepQueue(direction);
+                        encoders[i].reset(new StepQueueEncoder(runs[i], maxErrorMicros));
+                    }
+                    encoders[i]->push(stepMicros - track.lastStepMicros);
+                }
+                track.lastStepMicros = stepMicros;
+                ++track.stepCount;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < axisCount; ++i) {
+        if (encoders[i]) {
+            encoders[i]->flush();
+            if (!runs[i].empty()) {
+                chunk.tracks[i].queues.push_back(runs[i]);
+            }
+        }
+    }
+}
+
+void OfflinePlanner::write(const vector<string> &paths) const {
+    if (paths.size() != axes.size()) {
+        throw invalid_argument("Expected a path for every axis");
+    }
+
+    for (size_t i = 0; i < axes.size(); ++i) {
+        TrajectoryWriter writer(paths[i], axes[i].stepsInRotation);
+        for (size_t j = 0; j < queues[i].size(); ++j) {
+            writer.append(queues[i][j]);
+        }
+        writer.close();
+    }
+}
+
+}
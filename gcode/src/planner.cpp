@@ -0,0 +1,143 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <planner.hpp>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace libstepper {
+
+// The speed a block can reach over its length, starting from speed. An acceleration of 0 is unlimited.
+static double getReachableSpeed(const double speed, const PlannerBlock &block) {
+    return block.acceleration > 0 ? sqrt(speed * speed + 2 * block.acceleration * block.length) : HUGE_VAL;
+}
+
+LookaheadPlanner::LookaheadPlanner(BlockExecutor &executor, const size_t capacity, const double junctionDeviation)
+    : executor(executor), head(0), count(0), junctionDeviation(junctionDeviation), hasPrevious(false), executedCount(0) {
+    if (capacity < 2) {
+        throw invalid_argument("The planner needs to queue at least 2 blocks");
+    }
+    if (junctionDeviation < 0) {
+        throw invalid_argument("The junction deviation can't be negative");
+    }
+    blocks.resize(capacity);
+}
+
+size_t LookaheadPlanner::size() const {
+    return count;
+}
+
+size_t LookaheadPlanner::getCapacity() const {
+    return blocks.size();
+}
+
+uint64_t LookaheadPlanner::getExecutedCount() const {
+    return executedCount;
+}
+
+PlannerBlock &LookaheadPlanner::at(const size_t index) {
+    return blocks[(head + index) % blocks.size()];
+}
+
+double LookaheadPlanner::getJunctionSpeed(const PlannerBlock &previous, const PlannerBlock &next, const double junctionDeviation) {
+    const size_t axisCount = min(previous.axisCount, next.axisCount);
+    double cosTheta = 0;
+    for (size_t i = 0; i < axisCount; ++i) {
+        cosTheta -= previous.exitDirection[i] * next.entryDirection[i];
+    }
+
+    const double limit = min(previous.nominalSpeed, next.nominalSpeed);
+    if (cosTheta > 0.999999) {
+        // A reversal
+        return 0;
+    }
+    if (cosTheta < -0.999999) {
+        // A straight line
+        return limit;
+    }
+
+    // The speed at which the centripetal acceleration of a circle tangent to both blocks, that deviates
+    // from the corner by junctionDeviation, equals the acceleration.
+    const double sinHalfTheta = sqrt(0.5 * (1 - cosTheta));
+    const double acceleration = min(previous.acceleration, next.acceleration);
+    const double speed = sqrt(acceleration * junctionDeviation * sinHalfTheta / (1 - sinHalfTheta));
+    return min(speed, limit);
+}
+
+bool LookaheadPlanner::push(const PlannerBlock &block) {
+    if (count == blocks.size() && !executeOldest()) {
+        return false;
+    }
+
+    PlannerBlock &queued = at(count);
+    queued = block;
+    if (block.type == PlannerBlock::DWELL || !hasPrevious) {
+        queued.maxEntrySpeed = 0;
+    } else {
+        queued.maxEntrySpeed = min(block.nominalSpeed, getJunctionSpeed(previous, block, junctionDeviation));
+    }
+    // The oldest block's entry speed is the exit speed the block before it was executed with. The queue
+    // only ever empties when flushed, which ends at rest.
+    queued.entrySpeed = 0;
+    queued.exitSpeed = 0;
+
+    hasPrevious = block.type != PlannerBlock::DWELL;
+    if (hasPrevious) {
+        previous = block;
+    }
+
+    ++count;
+    recalculate();
+    return true;
+}
+
+void LookaheadPlanner::recalculate() {
+    // Backwards from the newest block, which must end at rest, so that every block can slow down in time.
+    // The oldest block's entry speed is fixed.
+    double exitSpeed = 0;
+    for (size_t i = count; i-- > 1;) {
+        PlannerBlock &block = at(i);
+        block.entrySpeed = min(block.maxEntrySpeed, getReachableSpeed(exitSpeed, block));
+        exitSpeed = block.entrySpeed;
+    }
+
+    // Forwards from the oldest block, so that every block can speed up in time.
+    for (size_t i = 0; i < count; ++i) {
+        PlannerBlock &block = at(i);
+        const double nextEntrySpeed = i + 1 < count ? at(i + 1).entrySpeed : 0;
+        block.exitSpeed = min(nextEntrySpeed, getReachableSpeed(block.entrySpeed, block));
+        if (i + 1 < count) {
+            at(i + 1).entrySpeed = block.exitSpeed;
+        }
+    }
+}
+
+bool LookaheadPlanner::executeOldest() {
+    const PlannerBlock &block = at(0);
+    head = (head + 1) % blocks.size();
+    --count;
+    ++executedCount;
+    return executor.execute(block);
+}
+
+bool LookaheadPlanner::flush() {
+    hasPrevious = false;
+    while (count > 0) {
+        if (!executeOldest()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void LookaheadPlanner::clear() {
+    head = 0;
+    count = 0;
+    hasPrevious = false;
+}
+
+}
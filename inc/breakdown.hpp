@@ -0,0 +1,79 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <ostream>
+
+namespace libstepper {
+
+/**
+ Where the time of a step of the driver's playback goes.
+*/
+enum StepPhase {
+    // Checking for an interrupt, i.e. taking the interrupt mutex
+    STEP_PHASE_LOCK,
+    // The 4 coil terminal writes
+    STEP_PHASE_WRITE,
+    // Working out when the step is due, and the bookkeeping after it: the counters, the jitter histogram, the
+    // late step policy, and the follower
+    STEP_PHASE_SCHEDULE,
+    // How much later than due the sleep before the step returned, by the driver's clock. Only steps that
+    // slept are counted.
+    STEP_PHASE_OVERSLEEP,
+    // Rendering the next chunk of step() or drive(), or decoding it from a StepQueue. Counted once per chunk,
+    // rather than per step.
+    STEP_PHASE_RENDER
+};
+
+static const size_t STEP_PHASE_COUNT = 5;
+
+/**
+ The time spent in a StepPhase, in nanoseconds.
+*/
+struct StepPhaseStats {
+    uint64_t count;
+    uint64_t totalNanos;
+    uint64_t maxNanos;
+
+    double getMeanNanos() const;
+};
+
+/**
+ Attributes the time inside every step of a driver's playback to StepPhases, e.g. to see whether late steps
+ are down to lock contention, a slow signal backend, or the OS. Pass one to
+ StepperDriverBuilder::setStepBreakdown(). Drivers without one don't read the time for it at all.
+
+ The phases are timed on the steady clock, which costs a few tens of nanoseconds per reading on most
+ platforms, so profiled steps are a little slower than unprofiled ones. Like LatencyHistogram, the driver
+ updates it wait-free, and it can be read from any thread while the driver runs.
+*/
+class StepBreakdown {
+public:
+    StepBreakdown();
+    StepBreakdown(const StepBreakdown &rhs) = delete;
+
+    void add(const StepPhase phase, const uint64_t nanos) noexcept;
+    // Adds the time since sinceNanos (from nowNanos()) to the phase, and returns the time now, so that
+    // consecutive phases can be timed with one reading each.
+    uint64_t addSince(const StepPhase phase, const uint64_t sinceNanos) noexcept;
+    void reset();
+
+    StepPhaseStats get(const StepPhase phase) const;
+    // Writes a table of the phases, with their share of the total time.
+    void write(std::ostream &output) const;
+
+    static uint64_t nowNanos() noexcept;
+    static const char *getPhaseName(const StepPhase phase);
+
+private:
+    std::atomic<uint64_t> counts[STEP_PHASE_COUNT];
+    std::atomic<uint64_t> totalNanos[STEP_PHASE_COUNT];
+    std::atomic<uint64_t> maxNanos[STEP_PHASE_COUNT];
+};
+
+}
@@ -0,0 +1,29 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace libstepper {
+
+// StepperDriver::calibrate() times this many coil writes and sleeps by default, which takes around 20 ms.
+static const size_t CALIBRATION_SAMPLES = 16;
+// How long each of calibrate()'s sleeps asks for, which is about as long as a step's wait at speed.
+static const uint64_t CALIBRATION_SLEEP_MICROS = 1000;
+
+/**
+ How long a driver's coil writes take, and how much later than asked its clock's sleeps typically return,
+ from StepperDriver::calibrate(). The driver's playback wakes up early by the sum of the two, so that the
+ coils have changed by the time every step is due.
+*/
+struct TimingCalibration {
+    // The mean time of writing all 4 coil terminals, or 0 for drivers with a waveform chain
+    uint64_t writeMicros;
+    // The median time that a sleep overshot by
+    uint64_t oversleepMicros;
+};
+
+}
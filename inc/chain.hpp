@@ -0,0 +1,60 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <signal.hpp>
+#include <timeline.hpp>
+#include <chrono>
+
+namespace libstepper {
+
+/**
+ Consumes the coil waveform of a move as batches of timed transitions, instead of as individual
+ DigitalSignalConsumer::write() calls. This is the interface for backends that play a whole list of pin
+ transitions with their own timing, e.g. pigpio-style wave chains, SPI bit-banging, or PRU/DMA engines.
+
+ Each move is delivered as begin(), one or more write() calls, and end(). The timestamps in a batch are
+ relative to the last event of the previous batch of the same move, or to begin() for the first batch.
+*/
+class WaveformChainConsumer {
+public:
+    virtual void begin() = 0;
+    // Queues a batch for output. Should return once the backend can accept the next batch, and false if the
+    // batch could not be queued, which stops the move.
+    virtual bool write(const StepEvent *events, const size_t count) = 0;
+    // Should return once all the queued batches of the move have been output.
+    virtual void end() = 0;
+};
+
+/**
+ An in-process WaveformChainConsumer that plays the batches synchronously on four DigitalSignalConsumers,
+ timing them with the steady clock. Useful as a stand-in for a hardware chain in tests, or as a software
+ fallback on platforms without one.
+*/
+class LocalWaveformChain : public WaveformChainConsumer {
+public:
+    LocalWaveformChain(DigitalSignalConsumer &coil1Terminal1,
+                       DigitalSignalConsumer &coil2Terminal1,
+                       DigitalSignalConsumer &coil1Terminal2,
+                       DigitalSignalConsumer &coil2Terminal2);
+
+    void begin();
+    bool write(const StepEvent *events, const size_t count);
+    void end();
+
+    uint64_t getBatchCount() const;
+    uint64_t getEventCount() const;
+
+private:
+    //a1, b1, a2, and b2
+    DigitalSignalConsumer *coilTerminals[4];
+    std::chrono::steady_clock::time_point anchor;
+    uint64_t batchCount;
+    uint64_t eventCount;
+};
+
+}
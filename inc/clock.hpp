@@ -0,0 +1,54 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+namespace libstepper {
+
+/**
+ The time source that a StepperDriver waits on between steps. Set one with StepperDriverBuilder::setClock().
+ Drivers use a SteadyClock by default.
+*/
+class Clock {
+public:
+    virtual ~Clock() {
+    }
+
+    // Microseconds since an arbitrary point, which never goes backwards.
+    virtual uint64_t nowMicros() = 0;
+    virtual void sleepForMicros(const uint64_t micros) = 0;
+};
+
+/**
+ The real time, from std::chrono::steady_clock.
+*/
+class SteadyClock : public Clock {
+public:
+    uint64_t nowMicros();
+    void sleepForMicros(const uint64_t micros);
+
+    // The clock that drivers are built with, unless they're given another.
+    static SteadyClock &getInstance();
+};
+
+/**
+ A clock that only moves when it's slept on, by exactly the time slept, without sleeping. A driver on a
+ VirtualClock runs its moves as fast as it can, with the timing it would have had in real time, which is
+ useful for tests and for measuring the driver's own overhead.
+*/
+class VirtualClock : public Clock {
+public:
+    VirtualClock();
+
+    uint64_t nowMicros();
+    void sleepForMicros(const uint64_t micros);
+
+private:
+    std::atomic<uint64_t> micros;
+};
+
+}
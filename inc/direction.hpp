@@ -0,0 +1,14 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+namespace libstepper {
+
+enum RotationDirection {
+    CLOCKWISE,
+    COUNTER_CLOCKWISE
+};
+
+}
@@ -15,4 +15,16 @@ public:
     }
 };
 
+class IOError : public std::runtime_error {
+public:
+    IOError(const std::string &message) : runtime_error(message) {
+    }
+};
+
+class FormatError : public std::runtime_error {
+public:
+    FormatError(const std::string &message) : runtime_error(message) {
+    }
+};
+
 }
\ No newline at end of file
@@ -0,0 +1,104 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <direction.hpp>
+#include <vector>
+
+namespace libstepper {
+
+class StepperDriver;
+
+/**
+ Receives the step events of a leader StepperDriver, from inside the leader's own timing loop. Set one with
+ StepperDriverBuilder::setFollower(). onLeaderStep() is called right after each of the leader's steps is
+ output, so it should be quick: anything it does delays the leader's next step.
+*/
+class StepFollower {
+public:
+    virtual ~StepFollower() {
+    }
+
+    // Called when the leader starts a move, before its first step.
+    virtual void start() = 0;
+    virtual void onLeaderStep(const RotationDirection direction) = 0;
+    // Called when the leader finishes (or is interrupted out of) a move, after its last step.
+    virtual void finish() = 0;
+    // Called by StepperDriverBuilder::build() with the leader's fastest step rate, in steps per second (infinity
+    // if it has no max safe RPM). Throws IllegalStateError if that would step the follower at or past its own
+    // max safe RPM.
+    virtual void checkLeaderRate(const double) const {
+    }
+};
+
+/**
+ Electronic gearing: steps a follower StepperDriver numerator/denominator times for every step of the
+ leader. The fractional steps are carried in an integer accumulator, so the follower never drifts from the
+ leader, no matter how long they run. A negative numerator turns the follower the other way. The ratio
+can't be steeper than 1 follower step per leader step, so that the follower is always stepped at the
+leader's pace; gear the leader down instead.
+*/
+class GearFollower : public StepFollower {
+public:
+    // Throws std::invalid_argument if the denominator is 0, or |numerator| > denominator.
+    GearFollower(StepperDriver &follower, const int64_t numerator, const uint64_t denominator);
+
+    void start();
+    void onLeaderStep(const RotationDirection direction);
+    void finish();
+    void checkLeaderRate(const double leaderStepsPerSecond) const;
+
+    // The follower's net steps since construction, with positive steps being COUNTER_CLOCKWISE.
+    int64_t getFollowerSteps() const;
+
+private:
+    StepperDriver &follower;
+    const int64_t numerator;
+    const int64_t denominator;
+    // The follower's fractional position, in 1/denominator steps, always within (-denominator, denominator).
+    int64_t accumulator;
+    int64_t followerSteps;
+};
+
+/**
+ Cam motion: moves a follower StepperDriver along a cam profile, i.e. a table of follower positions (in
+ steps) at evenly spaced positions of the leader. The profile repeats every table.size() * stepsPerEntry
+ leader steps, closing from the last entry back to the first. The positions between the entries are
+ linearly interpolated once, when the table is loaded, so every leader step costs a single lookup,
+ however complex the cam. Where the profile is steeper than 1 follower step per leader step, the follower
+ takes its steps back to back.
+
+ The follower is assumed to be at table[0] when the CamFollower is constructed, with the leader at the
+ start of the profile.
+*/
+class CamFollower : public StepFollower {
+public:
+    // Throws std::invalid_argument if the table is empty, stepsPerEntry is 0, or the profile is steeper than 1
+    // follower step per leader step anywhere, including from the last entry back to the first.
+    CamFollower(StepperDriver &follower, const std::vector<int64_t> &table, const uint64_t stepsPerEntry);
+
+    void start();
+    void onLeaderStep(const RotationDirection direction);
+    void finish();
+    void checkLeaderRate(const double leaderStepsPerSecond) const;
+
+    // The leader's position in the profile, in [0, getCycleLength()).
+    uint64_t getLeaderPhase() const;
+    uint64_t getCycleLength() const;
+    // The follower's position, in the table's units.
+    int64_t getFollowerPosition() const;
+
+private:
+    StepperDriver &follower;
+    // The follower's position at every leader step of the profile
+    std::vector<int64_t> positions;
+    // The most follower steps that any leader step takes, i.e. 0 for a flat profile, and 1 otherwise
+    uint64_t maxStepsPerLeaderStep;
+    uint64_t leaderPhase;
+    int64_t followerPosition;
+};
+
+}
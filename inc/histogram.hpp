@@ -0,0 +1,51 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+namespace libstepper {
+
+// Every power of 2 is split into this many equal buckets, so a bucket is within 1/16 (6.25%) of its values.
+static const size_t LATENCY_HISTOGRAM_SUB_BUCKETS = 16;
+// Enough buckets for the whole uint64_t range
+static const size_t LATENCY_HISTOGRAM_BUCKETS = 61 * LATENCY_HISTOGRAM_SUB_BUCKETS;
+
+/**
+ A fixed size, log-linear histogram of latencies (in any unit, e.g. microseconds): the values below 32 each
+ have their own bucket, and every power of 2 above that is split into 16 equal buckets. Recording a value is
+ a few bit operations and an increment, without allocating or locking.
+
+ Values should be recorded by one thread at a time, but the histogram can be read from any thread while
+ they are. Reads during recording are approximate, since the count, max, and buckets aren't updated
+ together.
+*/
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+    LatencyHistogram(const LatencyHistogram &rhs) = delete;
+
+    void record(const uint64_t value) noexcept;
+    void reset();
+
+    uint64_t getCount() const;
+    uint64_t getMax() const;
+    // The smallest value that at least the fraction (e.g. 0.99 for the p99) of the recorded values are at
+    // or below, to within its bucket. 0 if nothing has been recorded.
+    uint64_t getPercentile(const double fraction) const;
+
+    static size_t getBucketIndex(const uint64_t value) noexcept;
+    // The largest value that goes in a bucket
+    static uint64_t getBucketUpperBound(const size_t index);
+
+private:
+    std::atomic<uint64_t> buckets[LATENCY_HISTOGRAM_BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> max;
+};
+
+}
@@ -0,0 +1,109 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <direction.hpp>
+
+namespace libstepper {
+
+// The duration of a tick that moves the path by 1 step. See MotionInterpolator::getTickWeight().
+static const uint32_t TICK_WEIGHT_UNIT = 128;
+// sqrt(2) in TICK_WEIGHT_UNITs, for the ArcInterpolator's ticks that step both axes
+static const uint32_t DIAGONAL_TICK_WEIGHT = 181;
+
+/**
+ Generates the steps of a coordinated multi-axis move, one tick of a shared clock at a time. A positive
+ step is a COUNTER_CLOCKWISE step, which is the direction StepperDriver's position increases in.
+*/
+class MotionInterpolator {
+public:
+    virtual ~MotionInterpolator() {
+    }
+
+    virtual size_t getAxisCount() const = 0;
+    // Fills steps with -1, 0, or 1 for every axis for the next tick. Returns false once the move is done.
+    virtual bool next(int8_t *steps) = 0;
+
+    // How long the last tick should take, in TICK_WEIGHT_UNITs of the nominal tick interval. Interpolators
+    // whose ticks move the path by different lengths can use this to keep the path speed constant.
+    virtual uint32_t getTickWeight() const {
+        return TICK_WEIGHT_UNIT;
+    }
+};
+
+/**
+ Interpolates a straight line with an integer DDA (Bresenham's algorithm generalised to any number of
+ axes). The axis with the most steps steps on every tick, and the others are spread evenly across the
+ ticks, so that all the axes start and finish together.
+*/
+class LinearInterpolator : public MotionInterpolator {
+public:
+    explicit LinearInterpolator(const std::vector<int64_t> &deltas);
+
+    size_t getAxisCount() const;
+    bool next(int8_t *steps);
+    uint64_t getTickCount() const;
+
+private:
+    std::vector<uint64_t> distances;
+    std::vector<int8_t> directions;
+    std::vector<uint64_t> errors;
+    uint64_t tickCount;
+    uint64_t tick;
+};
+
+/**
+ Interpolates a circular arc in the plane of two axes with integer arithmetic only, in the manner of the
+ midpoint circle algorithm. On every tick, the axis along which the arc is moving faster steps, and the
+ other axis steps too if that keeps the path closer to the circle. Memory use is constant regardless of
+ the radius, and ticks that step both axes take sqrt(2) times longer, so the speed along the arc is
+ constant.
+
+ The end point and the center are relative to the start. The arc ends at the end point even if it isn't
+ exactly on the circle, by finishing with a short straight line. End points equal to the start are full
+ circles. Coordinates must be within +/-2^30 steps.
+*/
+class ArcInterpolator : public MotionInterpolator {
+public:
+    ArcInterpolator(const size_t axisCount,
+                    const size_t xAxis,
+                    const size_t yAxis,
+                    const int64_t endX,
+                    const int64_t endY,
+                    const int64_t centerX,
+                    const int64_t centerY,
+                    const RotationDirection direction);
+
+    size_t getAxisCount() const;
+    bool next(int8_t *steps);
+    uint32_t getTickWeight() const;
+
+private:
+    int64_t getError(const int64_t x, const int64_t y) const;
+    int64_t getCross(const int64_t x, const int64_t y) const;
+    bool hasPassedEnd(const int64_t x, const int64_t y) const;
+
+    const size_t axisCount;
+    const size_t xAxis;
+    const size_t yAxis;
+    // Relative to the center
+    int64_t x;
+    int64_t y;
+    int64_t endX;
+    int64_t endY;
+    int64_t radiusSquared;
+    // +1 for counter clockwise arcs, -1 for clockwise ones
+    int64_t orientation;
+    // Set once the end point has been ahead of the path, so that full circles don't end immediately
+    bool armed;
+    bool finishing;
+    LinearInterpolator finish;
+    uint32_t tickWeight;
+};
+
+}
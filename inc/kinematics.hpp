@@ -0,0 +1,96 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace libstepper {
+
+// The number of toolhead coordinates (x, y, and z, in mm) that Kinematics work with.
+static const size_t KINEMATICS_COORDINATES = 3;
+
+/**
+ Converts toolhead positions to motor positions, for a machine's geometry. Motor positions are absolute,
+ in steps, with positive steps being COUNTER_CLOCKWISE.
+*/
+class Kinematics {
+public:
+    virtual ~Kinematics() {
+    }
+
+    virtual size_t getMotorCount() const = 0;
+    // Fills steps with the position of every motor for the toolhead position (x, y, z). Throws
+    // std::invalid_argument if the position can't be reached.
+    virtual void toMotorSteps(const double *position, int64_t *steps) const = 0;
+    // The inverse of toMotorSteps(), to within a step: fills position with the toolhead position for the
+    // motor positions. Throws std::invalid_argument if the motors can't be there.
+    virtual void toPosition(const int64_t *steps, double *position) const = 0;
+    // Whether straight toolhead moves are straight motor moves too, so that they don't need to be
+    // segmented.
+    virtual bool isLinear() const = 0;
+};
+
+/**
+ One motor per coordinate.
+*/
+class CartesianKinematics : public Kinematics {
+public:
+    // Throws std::invalid_argument if any steps per millimeter aren't positive.
+    CartesianKinematics(const double xStepsPerMillimeter, const double yStepsPerMillimeter, const double zStepsPerMillimeter);
+
+    size_t getMotorCount() const;
+    void toMotorSteps(const double *position, int64_t *steps) const;
+    void toPosition(const int64_t *steps, double *position) const;
+    bool isLinear() const;
+
+private:
+    double stepsPerMillimeter[KINEMATICS_COORDINATES];
+};
+
+/**
+ Two motors (A and B) that move x and y together through a shared belt, with A = x + y and B = x - y, and
+ one motor for z.
+*/
+class CoreXYKinematics : public Kinematics {
+public:
+    // Throws std::invalid_argument if any steps per millimeter aren't positive.
+    CoreXYKinematics(const double xyStepsPerMillimeter, const double zStepsPerMillimeter);
+
+    size_t getMotorCount() const;
+    void toMotorSteps(const double *position, int64_t *steps) const;
+    void toPosition(const int64_t *steps, double *position) const;
+    bool isLinear() const;
+
+private:
+    const double xyStepsPerMillimeter;
+    const double zStepsPerMillimeter;
+};
+
+/**
+ A linear delta: 3 carriages on vertical towers, at 210, 330, and 90 degrees around the center, each
+ connected to the toolhead by rods of the same length. A carriage's height is z + sqrt(rod^2 - d^2), where
+ d is the horizontal distance from the toolhead to its tower, so straight toolhead moves aren't straight
+ motor moves.
+*/
+class LinearDeltaKinematics : public Kinematics {
+public:
+    // Throws std::invalid_argument if the rods are no longer than the radius, or the steps per millimeter
+    // aren't positive.
+    LinearDeltaKinematics(const double towerRadius, const double rodLength, const double stepsPerMillimeter);
+
+    size_t getMotorCount() const;
+    void toMotorSteps(const double *position, int64_t *steps) const;
+    void toPosition(const int64_t *steps, double *position) const;
+    bool isLinear() const;
+
+private:
+    double towerX[3];
+    double towerY[3];
+    const double rodLengthSquared;
+    const double stepsPerMillimeter;
+};
+
+}
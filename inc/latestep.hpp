@@ -0,0 +1,31 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+namespace libstepper {
+
+/**
+ What a StepperDriver does after a step misses its deadline, i.e. is taken after the next step was due,
+ e.g. because the stepping thread was preempted. Steps are always scheduled against the move's clock, so
+ smaller delays are made up by the next step either way. Set one with StepperDriverBuilder::setLateStepPolicy().
+*/
+enum LateStepPolicy {
+    // Moves the rest of the schedule back by the delay, so the move keeps its step spacing, and takes longer.
+    SHIFT_SCHEDULE,
+    // Keeps the schedule, and takes the late steps back to back until the move is back on it, but no faster
+    // than the max safe RPM, and never more than LATE_STEP_MAX_BURST steps behind.
+    CATCH_UP,
+    // Shifts the schedule, and slows the rest of the move down by a quarter every time LATE_STEP_DERATE_MISSES
+    // steps in a row miss their deadlines, down to LATE_STEP_MIN_SPEED_PERCENT of the commanded speed.
+    DERATE
+};
+
+static const uint64_t LATE_STEP_MAX_BURST = 8;
+static const uint64_t LATE_STEP_DERATE_MISSES = 4;
+static const uint64_t LATE_STEP_MIN_SPEED_PERCENT = 25;
+
+}
@@ -0,0 +1,108 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <stepper.hpp>
+#include <interpolator.hpp>
+
+namespace libstepper {
+
+/**
+ The speed along a path for MultiAxisController::run(), with trapezoidal ramps: the speed rises from
+ entrySpeed at the given acceleration, cruises at cruiseSpeed, and falls to exitSpeed by the end of the
+ path. Distances and speeds can be in any units (e.g. mm and mm/s), as long as they're consistent. An
+ acceleration of 0 moves at cruiseSpeed throughout.
+*/
+struct PathProfile {
+    double length;
+    // The distance moved by a tick of weight TICK_WEIGHT_UNIT
+    double distancePerTick;
+    double entrySpeed;
+    double cruiseSpeed;
+    double exitSpeed;
+    double acceleration;
+};
+
+/**
+ A coordinated move scaled so that every axis follows the same trapezoidal profile, stretched to its
+ own distance. See MultiAxisController::planSynchronized().
+*/
+struct SynchronizedMove {
+    // In ticks of the longest axis, i.e. one of its steps per unit of length
+    PathProfile profile;
+    uint64_t durationMicros;
+};
+
+/**
+ Drives several StepperDrivers from a single timing loop on the calling thread, so that their steps are
+ interleaved on one clock instead of each driver running step() on its own thread. Positive step counts
+ are COUNTER_CLOCKWISE.
+*/
+class MultiAxisController {
+public:
+    explicit MultiAxisController(const std::vector<StepperDriver *> &axes);
+    MultiAxisController(const MultiAxisController &rhs) = delete;
+
+    // Moves in a straight line, with the axis that has the most steps taking stepsPerSecond steps every
+    // second. The rate is lowered if needed, so that no axis exceeds its max safe RPM, even if that's below 1
+    // step per second. Returns false if interrupted, or if stepsPerSecond is 0.
+    bool move(const std::vector<int64_t> &steps, const uint64_t stepsPerSecond);
+    // Moves along a circular arc in the plane of xAxis and yAxis (G2/G3 style), at stepsPerSecond along the
+    // arc. The end point and the center are relative to the current position, and an end point equal to it
+    // is a full circle. See ArcInterpolator.
+    bool arc(const size_t xAxis,
+             const size_t yAxis,
+             const int64_t endX,
+             const int64_t endY,
+             const int64_t centerX,
+             const int64_t centerY,
+             const RotationDirection direction,
+             const uint64_t stepsPerSecond);
+    // Works out the fastest move in which every axis starts and finishes together, and follows the same
+    // speed profile scaled to its distance, without exceeding any axis's limits. An axis's speed limit is
+    // its max safe RPM, or its current RPM if it has no max safe RPM, and its acceleration limit is its
+    // acceleration (0 being unlimited). The axis with the tightest limits for its distance sets the pace.
+    // Throws std::invalid_argument if there isn't a step count for every axis.
+    SynchronizedMove planSynchronized(const std::vector<int64_t> &steps) const;
+    // Moves as planned by planSynchronized(). Returns false if interrupted, or if an axis that needs to
+    // move has a speed limit of 0.
+    bool moveSynchronized(const std::vector<int64_t> &steps);
+    // Drives the steps generated by an interpolator, one tick every 1/ticksPerSecond s. The rate isn't
+    // limited by the axes' max safe RPMs.
+    bool run(MotionInterpolator &interpolator, const uint64_t ticksPerSecond);
+    // Drives the steps generated by an interpolator at the speeds of a path profile. Returns false if
+    // interrupted, or if the profile has no cruise speed.
+    bool run(MotionInterpolator &interpolator, const PathProfile &profile);
+    // Holds the axes still for the given time. Returns false if interrupted.
+    bool dwell(const uint64_t micros);
+    void interrupt();
+
+    // Keeps the axes enabled between begin() and end(), and schedules every run() and dwell() in between
+    // on one clock, so that back to back moves (e.g. the blocks of a G-code job) don't stop in between.
+    // Otherwise, every run() enables the axes and disables them again when done.
+    void begin();
+    void end();
+    bool hasBegun() const;
+
+    size_t getAxisCount() const;
+    StepperDriver &getAxis(const size_t index) const;
+
+private:
+    bool isInterrupted();
+
+    std::vector<StepperDriver *> axes;
+    std::vector<int8_t> tickSteps;
+    bool energized;
+    std::chrono::steady_clock::time_point deadline;
+    bool interrupted;
+    std::mutex interruptMutex;
+};
+
+}
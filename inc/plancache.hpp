@@ -0,0 +1,66 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <stepqueue.hpp>
+
+namespace libstepper {
+
+/**
+ Everything a compiled move depends on, except its direction.
+*/
+struct PlanKey {
+    uint64_t steps;
+    uint64_t rpm;
+    uint64_t acceleration;
+    uint64_t stepsInRotation;
+
+    bool operator==(const PlanKey &rhs) const;
+};
+
+struct PlanKeyHash {
+    size_t operator()(const PlanKey &key) const;
+};
+
+/**
+ A thread-safe, least-recently-used cache of compiled moves. The cached StepQueues are direction
+ independent, i.e., the same plan is reused for either direction, and their own direction is meaningless.
+ A cache can be shared by several StepperDrivers, since the motor's stepsInRotation is part of the key.
+*/
+class PlanCache {
+public:
+    explicit PlanCache(const size_t capacity);
+    PlanCache(const PlanCache &rhs) = delete;
+
+    // Returns nullptr, and counts a miss, if the plan isn't cached.
+    std::shared_ptr<const StepQueue> find(const PlanKey &key);
+    void insert(const PlanKey &key, const std::shared_ptr<const StepQueue> &plan);
+    void clear();
+
+    size_t size() const;
+    size_t getCapacity() const;
+    uint64_t getHitCount() const;
+    uint64_t getMissCount() const;
+
+private:
+    typedef std::list<std::pair<PlanKey, std::shared_ptr<const StepQueue>>> Entries;
+
+    const size_t capacity;
+    // Most recently used first
+    Entries entries;
+    std::unordered_map<PlanKey, Entries::iterator, PlanKeyHash> index;
+    uint64_t hits;
+    uint64_t misses;
+    mutable std::mutex cacheMutex;
+};
+
+}
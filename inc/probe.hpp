@@ -0,0 +1,55 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <clock.hpp>
+#include <calibration.hpp>
+#include <histogram.hpp>
+
+namespace libstepper {
+
+// LatencyProbe::run() takes this many wakeups by default, i.e. 10 s at 1 ms, enough for a stable p99.9.
+static const size_t LATENCY_PROBE_SAMPLES = 10000;
+static const uint64_t LATENCY_PROBE_INTERVAL_MICROS = 1000;
+
+/**
+ Measures how late this host wakes up a thread on a clock, like cyclictest: it sleeps until a series of
+ evenly spaced deadlines, the way a StepperDriver's playback does, and records how late every wakeup was.
+ From that, it suggests the highest step rate at which steps are rarely late by much of their period, to
+ pass to StepperDriverBuilder::setMaxSafeRPM() instead of a guess, e.g.
+
+   LatencyProbe probe;
+   probe.run();
+   builder.setMaxSafeRPM(probe.getSafeRPM(200, 0.1));
+
+ Run it from the thread, and under the load, that the motors will be driven with. Give it the calibration
+ of the drivers, if they're calibrated, so that it wakes up early like they do.
+*/
+class LatencyProbe {
+public:
+    explicit LatencyProbe(Clock &clock = SteadyClock::getInstance(), const TimingCalibration &calibration = TimingCalibration());
+    LatencyProbe(const LatencyProbe &rhs) = delete;
+
+    // Blocks for about samples * intervalMicros. The results add up over runs, until reset().
+    void run(const size_t samples = LATENCY_PROBE_SAMPLES, const uint64_t intervalMicros = LATENCY_PROBE_INTERVAL_MICROS);
+    void reset();
+
+    // The wakeup lateness of every sample so far, in microseconds
+    const LatencyHistogram &getHistogram() const;
+    // The highest rate at which the p99.9 lateness is at most the fraction (e.g. 0.1) of the step period. The
+    // rate is unbounded (UINT64_MAX) if no wakeup was late at all, or if nothing has been probed yet.
+    uint64_t getSafeStepsPerSecond(const double fraction) const;
+    // The same, in the RPM of a motor with stepsInRotation steps, rounded down.
+    uint64_t getSafeRPM(const uint64_t stepsInRotation, const double fraction) const;
+
+private:
+    Clock &clock;
+    const TimingCalibration calibration;
+    LatencyHistogram histogram;
+};
+
+}
@@ -0,0 +1,31 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+namespace libstepper {
+
+/**
+ The velocity profile of a move: a trapezoid that ramps up from rest at a constant acceleration, cruises at
+ the RPM, and ramps back down to rest over the last steps. Moves too short to reach the RPM become
+ triangles. An acceleration of 0 disables the ramps, so that every step is taken at the RPM.
+*/
+class StepProfile {
+public:
+    // acceleration is in RPM per second
+    StepProfile(const uint64_t stepsInRotation, const uint64_t rpm, const uint64_t acceleration);
+
+    // Time to wait before taking the step-th step (starting at 1) of a move that is totalSteps long
+    uint64_t getIntervalMicros(const uint64_t step, const uint64_t totalSteps) const;
+    uint64_t getCruiseIntervalMicros() const;
+
+private:
+    uint64_t cruiseIntervalMicros;
+    // Time taken by the first step from rest; the n-th step from rest is taken at rampScaleMicros * sqrt(n)
+    double rampScaleMicros;
+};
+
+}
@@ -0,0 +1,70 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace libstepper {
+
+enum RealtimePolicy {
+    // Leaves the thread's scheduling policy alone
+    REALTIME_POLICY_NONE,
+    // SCHED_FIFO at RealtimeConfig::priority
+    REALTIME_POLICY_FIFO,
+    // SCHED_DEADLINE, with RealtimeConfig's runtime, deadline, and period
+    REALTIME_POLICY_DEADLINE
+};
+
+/**
+ How to set up a thread that steps motors, for lower jitter. Everything is off by default. Only supported on
+ Linux; elsewhere, every requested setting fails.
+*/
+struct RealtimeConfig {
+    RealtimeConfig();
+
+    // Throws std::invalid_argument if the config is invalid, e.g. a FIFO priority out of range.
+    void validate() const;
+
+    RealtimePolicy policy;
+    // 1 to 99, for REALTIME_POLICY_FIFO
+    int priority;
+    // For REALTIME_POLICY_DEADLINE: the thread may run for runtimeMicros within deadlineMicros of the start of
+    // every periodMicros, so runtime <= deadline <= period.
+    uint64_t runtimeMicros;
+    uint64_t deadlineMicros;
+    uint64_t periodMicros;
+    // The CPU to pin the thread to, or -1 to leave its affinity alone
+    int cpu;
+    // Makes the kernel wake the thread's sleeps up as close to when they asked as it can (1 ns of slack),
+    // instead of the default 50 us
+    bool minimizeTimerSlack;
+    // Locks the process's current and future memory into RAM with mlockall(), so that steps don't page fault
+    bool lockMemory;
+    // Touches this much of the thread's stack up front, so that it's faulted in (and locked, with lockMemory)
+    // before the first step rather than during it
+    size_t prefaultStackBytes;
+};
+
+/**
+ What applyRealtimeConfig() managed to set up. Failing to get a setting, e.g. without the privileges for a
+ real-time policy, isn't an error: the thread keeps running as it was, and the failure is described here.
+*/
+struct RealtimeStatus {
+    RealtimeStatus();
+
+    // Whether every requested setting took effect
+    bool applied;
+    // One message per setting that didn't, e.g. "SCHED_FIFO: Operation not permitted"
+    std::vector<std::string> failures;
+};
+
+// Applies the config to the calling thread, and to the process for lockMemory. Throws std::invalid_argument if
+// the config is invalid.
+RealtimeStatus applyRealtimeConfig(const RealtimeConfig &config);
+
+}
@@ -8,6 +8,8 @@ namespace libstepper {
 
 class DigitalSignalConsumer {
 public:
+    // Called from the driver's stepping loop, which doesn't allocate or throw itself, so a write shouldn't
+    // either: allocator latency and exceptions there delay steps, or leave the coils half written.
     virtual void write(bool value) = 0;
 };
 
@@ -0,0 +1,82 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <direction.hpp>
+
+namespace libstepper {
+
+/**
+ A snapshot of a StepperDriver's counters, from StepperDriver::getStats().
+*/
+struct StepperStats {
+    uint64_t clockwiseSteps;
+    uint64_t counterClockwiseSteps;
+    // Moves started by the driver's own methods (step(), play(), drive(), ...), by whether they ran to the end
+    // or were stopped early, e.g. by interrupt().
+    uint64_t completedMoves;
+    uint64_t interruptedMoves;
+    // Total time the motor has been enabled, including the current move
+    uint64_t enabledMicros;
+    // Steps that were taken after the next step was due
+    uint64_t missedDeadlines;
+    uint64_t maxLatenessMicros;
+    // Times the DERATE late step policy slowed a move down
+    uint64_t derations;
+    // The rate of the last step of the current move, or 0 between moves
+    double stepsPerSecond;
+};
+
+/**
+ The counters behind StepperStats. Updated by the one thread that steps the motor, with plain atomic loads
+ and stores, so that updating them is wait-free, and they can be read from any thread without locking.
+ A snapshot isn't taken atomically as a whole, so its fields may be a step apart from each other.
+*/
+class StepperCounters {
+public:
+    StepperCounters();
+    StepperCounters(const StepperCounters &rhs) = delete;
+
+    void addSteps(const uint64_t steps, const RotationDirection direction) noexcept;
+    void addMove(const bool completed) noexcept;
+    void setEnabled(const bool enabled, const uint64_t nowMicros) noexcept;
+    // Records a step of the driver's own playback, which should have been taken intervalMicros after the
+    // previous one, and was latenessMicros behind schedule.
+    void addScheduledStep(const uint64_t intervalMicros, const uint64_t latenessMicros) noexcept;
+    void setIntervalMicros(const uint64_t intervalMicros) noexcept;
+    void addDeration() noexcept;
+
+    StepperStats getSnapshot(const uint64_t nowMicros) const;
+
+private:
+    std::atomic<uint64_t> clockwiseSteps;
+    std::atomic<uint64_t> counterClockwiseSteps;
+    std::atomic<uint64_t> completedMoves;
+    std::atomic<uint64_t> interruptedMoves;
+    std::atomic<uint64_t> enabledMicros;
+    // When the current move enabled the motor, if enabled
+    std::atomic<uint64_t> enabledSinceMicros;
+    std::atomic<bool> enabled;
+    std::atomic<uint64_t> missedDeadlines;
+    std::atomic<uint64_t> maxLatenessMicros;
+    std::atomic<uint64_t> derations;
+    std::atomic<uint64_t> intervalMicros;
+};
+
+/**
+ Writes StepperStats in the Prometheus text exposition format, with a motor label for each driver, e.g. for
+ a node exporter's textfile collector, or an HTTP handler's response. Pass an std::ofstream to write to a
+ file, or an std::ostringstream for a buffer.
+*/
+void writePrometheus(std::ostream &output, const std::vector<std::pair<std::string, StepperStats>> &motors);
+void writePrometheus(std::ostream &output, const std::string &motor, const StepperStats &stats);
+
+}
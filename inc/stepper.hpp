@@ -6,15 +6,29 @@
 
 #include <stdint.h>
 #include <signal.hpp>
+#include <direction.hpp>
+#include <timeline.hpp>
+#include <chain.hpp>
+#include <profile.hpp>
+#include <stepqueue.hpp>
+#include <trajectory.hpp>
+#include <plancache.hpp>
+#include <follower.hpp>
+#include <units.hpp>
+#include <clock.hpp>
+#include <histogram.hpp>
+#include <stats.hpp>
+#include <latestep.hpp>
+#include <breakdown.hpp>
+#include <calibration.hpp>
+#include <realtime.hpp>
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <memory>
 
 namespace libstepper {
 
-enum RotationDirection {
-    CLOCKWISE,
-    COUNTER_CLOCKWISE
-};
-
 class StepperDriverBuilder;
 
 class StepperDriver {
@@ -25,15 +39,52 @@ public:
     bool step(const uint64_t steps, const RotationDirection direction);
     bool rotateBy(const double angleInDegrees, const RotationDirection direction);
     void drive(const RotationDirection direction);
+    // Moves to an absolute position in steps, as returned by getPosition(), e.g. for linear axes.
+    bool moveTo(const int64_t absoluteSteps);
+    // Turns to an angle in [0, 360), by whichever direction is shorter, so it takes at most half a turn.
+    bool moveToAngle(const double angleInDegrees);
     void interrupt();
 
+    // Renders a move from the current position and RPM into a timeline, without driving the motor.
+    StepTimeline plan(const uint64_t steps, const RotationDirection direction) const;
+    // Drives a timeline previously rendered by plan(). Returns false if interrupted.
+    bool play(const StepTimeline &timeline);
+    // Like plan(), but compresses the move into StepSegments, each step within maxErrorMicros of plan()'s.
+    StepQueue compile(const uint64_t steps, const RotationDirection direction, const uint32_t maxErrorMicros = 0) const;
+    // Drives a StepQueue, regenerating the step times on the fly. Returns false if interrupted.
+    bool play(const StepQueue &queue);
+    // Streams the moves of a trajectory file. Throws before moving if it was planned for a different motor.
+    bool play(const TrajectoryFile &trajectory);
+
     bool setRPM(const uint64_t rpm);
     uint64_t getRPM() const;
+    // In RPM per second. 0 disables the acceleration ramps.
+    void setAcceleration(const uint64_t acceleration);
+    uint64_t getAcceleration() const;
     uint64_t getMaxSafeRPM() const;
     uint64_t getStepsInRotation() const;
     double getPositionInDegrees() const;
+    // The net steps taken since the driver was built, across any number of turns, with positive steps being
+    // COUNTER_CLOCKWISE.
+    int64_t getPosition() const;
+    // A snapshot of the driver's counters. Safe to call from any thread, even during a move, without
+    // blocking the move.
+    StepperStats getStats() const;
+    // Measures the cost of the coil writes and the clock's sleep overshoot, by rewriting the coil state of the
+    // last step (or all coils off, before the first step) and sleeping samples times, and makes playback wake
+    // up early by both from then on. Doesn't move the motor. Call it between moves, e.g. after the system settles, or pass the result to another driver
+    // on the same backend with setCalibration().
+    TimingCalibration calibrate(const size_t samples = CALIBRATION_SAMPLES);
+    void setCalibration(const TimingCalibration &calibration);
+    TimingCalibration getCalibration() const;
+    // What the real-time config could be applied to the thread of the latest move, if the driver has one.
+    // Read it from that thread, or between moves.
+    RealtimeStatus getRealtimeStatus() const;
 
     friend class StepperDriverBuilder;
+    friend class MultiAxisController;
+    friend class GearFollower;
+    friend class CamFollower;
 
 private:
     StepperDriver(DigitalSignalConsumer *enableTerminal,
@@ -43,21 +94,106 @@ private:
                   DigitalSignalConsumer *coil2Terminal2,
                   const uint64_t stepsInRotation,
                   const uint64_t initialRPM,
-                  const uint64_t maxSafeRPM);
+                  const uint64_t maxSafeRPM,
+                  const uint64_t acceleration,
+                  WaveformChainConsumer *waveformChain,
+                  PlanCache *planCache,
+                  StepFollower *follower,
+                  Clock *clock,
+                  LatencyHistogram *jitterHistogram,
+                  const LateStepPolicy lateStepPolicy,
+                  StepBreakdown *breakdown,
+                  const RealtimeConfig *realtimeConfig);
 
+    void startMove();
+    // waitMicros is the wait carried into the segments, and is set to the wait left after them.
+    bool playSegments(const StepSegment *segments, const size_t count, const RotationDirection direction, uint64_t &waitMicros);
+    void finishMove();
     bool driveWaveform(const uint64_t steps, const RotationDirection direction);
-    bool adjustSpeed();
+    // Compiles and caches the plan on a miss. Returns nullptr if the RPM is 0.
+    std::shared_ptr<const StepQueue> findCachedPlan(const uint64_t steps, const RotationDirection direction);
+    void render(StepTimeline &timeline,
+                const StepProfile &profile,
+                const uint64_t firstStep,
+                const uint64_t steps,
+                const uint64_t totalSteps,
+                const RotationDirection direction,
+                const uint64_t horizonMicros) const;
+    void render(StepTimeline &timeline, StepQueueDecoder &decoder, const RotationDirection direction) const;
+    // render()'s loops, specialized for the direction
+    template <RotationDirection direction>
+    static void renderProfile(StepTimeline &timeline,
+                              const StepProfile &profile,
+                              uint8_t waveformStep,
+                              const uint64_t firstStep,
+                              const uint64_t steps,
+                              const uint64_t totalSteps,
+                              const uint64_t horizonMicros) noexcept;
+    template <RotationDirection direction>
+    static void renderDecoded(StepTimeline &timeline, StepQueueDecoder &decoder, uint8_t waveformStep);
+    size_t output(const StepTimeline &timeline);
+    size_t playback(const StepTimeline &timeline);
+    // Works out when the next step, intervalMicros after the last one, is due by the late step policy
+    uint64_t scheduleStep(const uint64_t intervalMicros, const uint64_t nowMicros) noexcept;
+    // Records a step taken at nowMicros, and applies the late step policy if it missed its deadline
+    void completeStep(const uint64_t intervalMicros, const uint64_t nowMicros) noexcept;
+    void writeCoils(const uint8_t coilMask);
+    // Takes a single step right away, for drivers that are being stepped by an external timing loop
+    void pulse(const RotationDirection direction);
+    void advancePosition(const uint64_t steps, const RotationDirection direction) noexcept;
+    StepProfile getProfile(const uint64_t currentRPM) const;
+    // compile(), at an RPM that's already been read
+    StepQueue compile(const uint64_t steps, const RotationDirection direction, const uint64_t currentRPM, const uint32_t maxErrorMicros) const;
     bool isInterrupted();
 
     DigitalSignalConsumer *enableTerminal;
     //a1, b1, a2, and b2
     DigitalSignalConsumer *coilTerminals[4];
+    // If set, the coil waveform goes here instead of to coilTerminals
+    WaveformChainConsumer *waveformChain;
+    // If set, step() and rotateBy() reuse compiled moves from here
+    PlanCache *planCache;
+    // If set, gets every step of this driver, from inside its timing loop
+    StepFollower *follower;
+    // What playback waits on between steps
+    Clock *clock;
+    // If set, playback records how late every step is here, in microseconds
+    LatencyHistogram *jitterHistogram;
+    const LateStepPolicy lateStepPolicy;
+    // If set, playback times the phases of every step here
+    StepBreakdown *breakdown;
+    // Applied to every thread that starts a move, once per thread
+    const bool hasRealtimeConfig;
+    const RealtimeConfig realtimeConfig;
+    std::thread::id realtimeThread;
+    RealtimeStatus realtimeStatus;
     const uint64_t stepsInRotation;
-    uint64_t rpm;
+    // Atomic, since setRPM() may be called from other threads during a move
+    std::atomic<uint64_t> rpm;
     const uint64_t maxSafeRPM;
+    uint64_t acceleration;
     bool interrupted;
     uint8_t nextWaveformStep;
+    // The coil mask last written to the coil terminals, which are all off (0) before the first step
+    uint8_t writtenCoilMask;
     uint64_t nextRotationStep;
+    int64_t position;
+    // When the last step of the current move should have been taken, by the clock
+    uint64_t idealStepMicros;
+    // When the last step of the current move was actually taken
+    uint64_t lastStepMicros;
+    // The shortest interval that CATCH_UP can take steps at, i.e. the interval at the max safe RPM
+    uint64_t catchUpIntervalMicros;
+    // Applied by playback, as the time to wake up before a step is due
+    TimingCalibration calibration;
+    // The DERATE policy's share of the commanded speed for the rest of the move, and the misses in a row
+    uint64_t speedPercent;
+    uint64_t consecutiveMisses;
+    StepperCounters counters;
+    // Converts rotateBy()'s angles, and carries their fractional steps from one call to the next
+    UnitConverter degrees;
+    // Reused by step() and drive() for rendering one chunk of a move at a time
+    StepTimeline chunk;
     mutable std::mutex interruptMutex;
 };
 
@@ -69,11 +205,41 @@ public:
     StepperDriverBuilder &setCoil2Terminal1(DigitalSignalConsumer &consumer);
     StepperDriverBuilder &setCoil1Terminal2(DigitalSignalConsumer &consumer);
     StepperDriverBuilder &setCoil2Terminal2(DigitalSignalConsumer &consumer);
+    // Alternative to the 4 coil terminals, for backends that output timed batches of transitions
+    StepperDriverBuilder &setWaveformChain(WaveformChainConsumer &chain);
 
     StepperDriverBuilder &setRotationStepCount(const uint64_t stepsInRotation);
     StepperDriverBuilder &setInitialRPM(const uint64_t initialRPM);
 
     StepperDriverBuilder &setMaxSafeRPM(const uint64_t maxSafeRPM);
+    // In RPM per second. Defaults to 0, which disables the acceleration ramps.
+    StepperDriverBuilder &setAcceleration(const uint64_t acceleration);
+    // Caches the plans of step() and rotateBy() moves. The RPM is then only read at the start of these moves,
+    // and a miss compiles the plan (allocating) before the move starts.
+    StepperDriverBuilder &setPlanCache(PlanCache &cache);
+    // Feeds every step of the driver to the follower, e.g. a GearFollower to slave another motor to it. build()
+    // throws IllegalStateError if the driver also has a waveform chain, or if the follower can't keep up with
+    // the driver's max safe RPM.
+    StepperDriverBuilder &setFollower(StepFollower &follower);
+    // The time source to wait on between steps. Defaults to SteadyClock::getInstance().
+    StepperDriverBuilder &setClock(Clock &clock);
+    // Timestamps every step on the clock, and records how late it was against the move's ideal schedule.
+    // Only the driver's own playback is measured, not waveform chains or MultiAxisController moves.
+    StepperDriverBuilder &setJitterHistogram(LatencyHistogram &histogram);
+    // What playback does after a missed step deadline. Defaults to SHIFT_SCHEDULE. Waveform chains and
+    // MultiAxisController moves do their own timing, and aren't affected.
+    StepperDriverBuilder &setLateStepPolicy(const LateStepPolicy policy);
+    // Times where every step of the driver's own playback spends its time. Off by default, since reading the
+    // time for it slows the steps down a little.
+    StepperDriverBuilder &setStepBreakdown(StepBreakdown &breakdown);
+    // Runs StepperDriver::calibrate() as part of build(). Off by default, since it writes the coil terminals,
+    // and takes around 20 ms.
+    StepperDriverBuilder &setCalibrateOnBuild(const bool calibrateOnBuild);
+    // Sets up the thread of every move with the config, e.g. a real-time policy, when it starts its first move
+    // with the driver. The driver steps on the threads that call it, so they stay set up after the move.
+    // Settings that can't be applied, e.g. without privileges, are reported by getRealtimeStatus(), and the
+    // move goes ahead without them. Throws std::invalid_argument if the config is invalid.
+    StepperDriverBuilder &setRealtimeConfig(const RealtimeConfig &config);
 
     StepperDriver *build() const;
 
@@ -83,8 +249,19 @@ private:
     DigitalSignalConsumer *coil2Terminal1;
     DigitalSignalConsumer *coil1Terminal2;
     DigitalSignalConsumer *coil2Terminal2;
+    WaveformChainConsumer *waveformChain;
+    PlanCache *planCache;
+    StepFollower *follower;
+    Clock *clock;
+    LatencyHistogram *jitterHistogram;
+    LateStepPolicy lateStepPolicy;
+    StepBreakdown *breakdown;
+    bool calibrateOnBuild;
+    bool hasRealtimeConfig;
+    RealtimeConfig realtimeConfig;
     uint64_t stepsInRotation;
     uint64_t initialRPM;
     uint64_t maxSafeRPM;
+    uint64_t acceleration;
 };
 }
\ No newline at end of file
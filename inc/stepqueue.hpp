@@ -0,0 +1,103 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <direction.hpp>
+#include <timeline.hpp>
+
+namespace libstepper {
+
+/**
+ A run of count steps, the first of which is taken interval us after the previous step. Every following
+ step waits add us longer than the one before it (or shorter, if add < 0).
+
+ A segment with a count of 0 is a wait: its interval is added to the next step's, for gaps too long for one
+ interval (about 71 minutes).
+*/
+struct StepSegment {
+    uint32_t interval;
+    uint32_t count;
+    int32_t add;
+};
+
+/**
+ A move in one direction, compressed into StepSegments. Constant speed runs take a single segment regardless
+ of their length, and acceleration ramps take a few segments each.
+*/
+class StepQueue {
+public:
+    StepQueue();
+    explicit StepQueue(const RotationDirection direction);
+
+    void append(const StepSegment &segment);
+
+    size_t size() const;
+    bool empty() const;
+    const StepSegment &operator[](const size_t index) const;
+    const StepSegment *data() const;
+
+    RotationDirection getDirection() const;
+    uint64_t getStepCount() const;
+
+private:
+    std::vector<StepSegment> segments;
+    RotationDirection direction;
+    uint64_t stepCount;
+};
+
+/**
+ Compresses the intervals between consecutive steps into the StepSegments of a StepQueue. Every step
+ regenerated from the queue is within maxErrorMicros of the time it was pushed at, so the default of 0 is
+ lossless.
+*/
+class StepQueueEncoder {
+public:
+    StepQueueEncoder(StepQueue &queue, const uint32_t maxErrorMicros = 0);
+
+    void push(const uint64_t intervalMicros);
+    // Appends the pending segment to the queue. Must be called once all the intervals have been pushed.
+    void flush();
+
+private:
+    void start(const int64_t intervalMicros);
+
+    StepQueue &queue;
+    const int64_t maxErrorMicros;
+    StepSegment pending;
+    // Time of the latest pushed step, the predicted time of the last step of the previous segment, and the
+    // predicted time taken by the pending segment, all since the start of the move
+    int64_t actualMicros;
+    int64_t segmentStartMicros;
+    int64_t pendingElapsedMicros;
+};
+
+/**
+ Regenerates the intervals between consecutive steps from StepSegments, with one add per step.
+*/
+class StepQueueDecoder {
+public:
+    // waitMicros is added to the first step, e.g. to carry the waits left over from the previous segments.
+    StepQueueDecoder(const StepSegment *segments, const size_t count, const uint64_t waitMicros = 0);
+
+    // Returns false once all the steps have been decoded
+    bool next(uint64_t &intervalMicros);
+    // The waits decoded since the last step, which only the next step (if any) would have waited out
+    uint64_t getWaitMicros() const;
+
+private:
+    const StepSegment *segment;
+    const StepSegment *end;
+    uint32_t remaining;
+    int64_t interval;
+    int64_t add;
+    uint64_t waitMicros;
+};
+
+StepQueue encode(const StepTimeline &timeline, const uint32_t maxErrorMicros = 0);
+
+}
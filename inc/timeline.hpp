@@ -0,0 +1,58 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <direction.hpp>
+
+namespace libstepper {
+
+/**
+ One coil transition of a pre-rendered move. At timestampMicros after the start of the move, the
+ coil terminals a1, b1, a2, and b2 take the values of bits 3, 2, 1, and 0 of coilMask respectively.
+*/
+struct StepEvent {
+    uint64_t timestampMicros;
+    uint8_t coilMask;
+};
+
+/**
+ A move rendered ahead of time by StepperDriver::plan(), as a list of StepEvents in playback order.
+ It also remembers where in the waveform it was planned from, so that it can only be played back
+ from that same point.
+*/
+class StepTimeline {
+public:
+    StepTimeline();
+    StepTimeline(const RotationDirection direction, const uint8_t startWaveformStep);
+
+    void reset(const RotationDirection direction, const uint8_t startWaveformStep);
+    void reserve(const size_t capacity);
+    void append(const uint64_t timestampMicros, const uint8_t coilMask);
+
+    size_t size() const;
+    bool empty() const;
+    const StepEvent &operator[](const size_t index) const;
+    const StepEvent *data() const;
+
+    RotationDirection getDirection() const;
+    uint8_t getStartWaveformStep() const;
+    uint64_t getDurationMicros() const;
+
+    friend class StepperDriver;
+
+private:
+    // Like append(), but without checking the order, for the driver's renderers, whose timestamps can only
+    // grow. Never allocates: returns false instead if the timeline is already at its reserved capacity.
+    bool appendInOrder(const uint64_t timestampMicros, const uint8_t coilMask) noexcept;
+
+    std::vector<StepEvent> events;
+    RotationDirection direction;
+    uint8_t startWaveformStep;
+};
+
+}
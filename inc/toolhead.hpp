@@ -0,0 +1,57 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <multiaxis.hpp>
+#include <kinematics.hpp>
+
+namespace libstepper {
+
+// The default rate at which moves of non-linear kinematics are split into straight motor moves.
+static const double TOOLHEAD_SEGMENTS_PER_SECOND = 200;
+
+/**
+ Moves a machine's toolhead in straight lines through its Kinematics, with the motors driven by a
+ MultiAxisController. Machines whose kinematics aren't linear (e.g. deltas) have their moves split into
+ short segments, each of which is a straight line for the motors, so the toolhead path only deviates from
+ the line by the curvature within a segment. A higher segment rate follows the line more closely, but
+ costs more kinematics math.
+*/
+class ToolheadController {
+public:
+    // The toolhead starts at (0, 0, 0). Throws std::invalid_argument if the controller doesn't have an axis
+    // for every motor, or the segment rate isn't positive.
+    ToolheadController(MultiAxisController &controller, const Kinematics &kinematics, const double segmentsPerSecond = TOOLHEAD_SEGMENTS_PER_SECOND);
+    ToolheadController(const ToolheadController &rhs) = delete;
+
+    // Moves to (x, y, z), in mm, at speed mm/s. Returns false if interrupted, or if the speed isn't
+    // positive. Throws std::invalid_argument if any point on the way can't be reached. If interrupted, the
+    // position is wherever the motors stopped.
+    bool moveTo(const double x, const double y, const double z, const double speed);
+    // Sets the toolhead position without moving, e.g. after homing.
+    void setPosition(const double x, const double y, const double z);
+    // 0, 1, and 2 for x, y, and z
+    double getPosition(const size_t coordinate) const;
+    // The number of straight motor moves made so far.
+    uint64_t getSegmentCount() const;
+
+private:
+    bool moveSegment(const double *target, const double length, const double speed);
+
+    MultiAxisController &controller;
+    const Kinematics &kinematics;
+    const double segmentsPerSecond;
+    double position[KINEMATICS_COORDINATES];
+    std::vector<int64_t> motorSteps;
+    std::vector<int64_t> targetSteps;
+    std::vector<int64_t> deltas;
+    std::vector<int64_t> startSteps;
+    uint64_t segmentCount;
+};
+
+}
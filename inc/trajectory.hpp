@@ -0,0 +1,94 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <fstream>
+#include <direction.hpp>
+#include <stepqueue.hpp>
+
+namespace libstepper {
+
+/**
+ Trajectory files store a whole job as compressed StepSegments, so that it can be planned offline and
+ streamed to a StepperDriver with constant memory use. All the fields are little-endian.
+
+ Header (32 bytes):
+    char[4]  magic: "LSTJ"
+    uint16   version: TRAJECTORY_VERSION
+    uint8    waveform mode: TRAJECTORY_WAVEFORM_FULL_STEP, the only waveform StepperDriver drives
+    uint8    reserved, 0
+    uint64   stepsInRotation of the motor the job was planned for
+    uint64   number of segments
+    uint64   total number of steps
+
+ Segments (16 bytes each):
+    uint32   interval
+    uint32   count
+    int32    add
+    uint8    RotationDirection
+    uint8[3] reserved, 0
+*/
+static const uint16_t TRAJECTORY_VERSION = 1;
+static const uint8_t TRAJECTORY_WAVEFORM_FULL_STEP = 1;
+static const size_t TRAJECTORY_HEADER_SIZE = 32;
+static const size_t TRAJECTORY_SEGMENT_SIZE = 16;
+
+/**
+ A read-only, memory-mapped trajectory file. The header and the segments' step counts and intervals are
+ validated when it's opened, throwing FormatError, so that a corrupt file is rejected before the motor
+ moves. The segments' directions are only validated as they're read.
+*/
+class TrajectoryFile {
+public:
+    explicit TrajectoryFile(const std::string &path);
+    ~TrajectoryFile();
+    TrajectoryFile(const TrajectoryFile &rhs) = delete;
+    TrajectoryFile &operator=(const TrajectoryFile &rhs) = delete;
+
+    uint16_t getVersion() const;
+    uint8_t getWaveformMode() const;
+    uint64_t getStepsInRotation() const;
+    uint64_t getSegmentCount() const;
+    uint64_t getStepCount() const;
+
+    StepSegment getSegment(const uint64_t index, RotationDirection &direction) const;
+    // Copies up to capacity consecutive segments starting at first, stopping early at a change of direction.
+    // Returns the number of segments copied, all of which are in the returned direction.
+    size_t read(const uint64_t first, StepSegment *segments, const size_t capacity, RotationDirection &direction) const;
+
+private:
+    const uint8_t *data;
+    size_t size;
+    uint64_t stepsInRotation;
+    uint64_t segmentCount;
+    uint64_t stepCount;
+};
+
+/**
+ Writes a trajectory file one move at a time, so that arbitrarily long jobs can be written with constant
+ memory use. The header's counts are filled in by close().
+*/
+class TrajectoryWriter {
+public:
+    TrajectoryWriter(const std::string &path, const uint64_t stepsInRotation);
+    ~TrajectoryWriter();
+
+    void append(const StepQueue &move);
+    void append(const StepSegment &segment, const RotationDirection direction);
+    void close();
+
+private:
+    void writeHeader();
+
+    std::ofstream out;
+    const uint64_t stepsInRotation;
+    uint64_t segmentCount;
+    uint64_t stepCount;
+};
+
+}
@@ -0,0 +1,56 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+namespace libstepper {
+
+// UnitConverter works in fixed-point units, in millionths of a unit (e.g. microdegrees, or nanometers if the
+// unit is the mm).
+static const int64_t UNIT_SCALE = 1000000;
+
+/**
+ Converts distances in a unit (e.g. degrees, or mm) to steps exactly, with a rational number of steps per
+ unit. The ratio is reduced once, at construction, so a conversion is one integer multiply and divide. The
+ fractional step left over by each conversion is carried into the next one, so a sequence of small moves
+ adds up to the same steps as one big move, instead of drifting.
+
+ The fixed-point distance times the reduced steps per unit has to fit in an int64_t, which is more than a
+ million turns for motors with up to a few thousand steps per turn.
+*/
+class UnitConverter {
+public:
+    // steps per units, e.g. (200, 360) for degrees on a 200 step motor, or (3200, 8) for mm on a lead screw
+    // with an 8 mm lead, driven at 3200 steps per turn. Throws std::invalid_argument if either is 0.
+    UnitConverter(const uint64_t steps, const uint64_t units);
+
+    // The same unit after a gearbox, where motorTurns turns of the motor make outputTurns turns of the
+    // output. The remainder isn't carried over to the new converter.
+    UnitConverter withGearRatio(const uint64_t motorTurns, const uint64_t outputTurns) const;
+
+    // Rounds a distance in units to the nearest fixed-point unit.
+    static int64_t toFixed(const double units);
+
+    // The whole steps in the fixed-point distance, plus the remainder of the previous conversions, rounded
+    // towards 0. Negative distances give negative steps.
+    int64_t toSteps(const int64_t fixedUnits);
+    // The distance that a number of steps covers, in fixed-point units, rounded towards 0.
+    int64_t toFixedUnits(const int64_t steps) const;
+    // The steps carried over to the next toSteps(), in 1/getDenominator() steps.
+    int64_t getRemainder() const;
+    void resetRemainder();
+
+    // The reduced steps per fixed-point unit is getNumerator() / getDenominator().
+    int64_t getNumerator() const;
+    int64_t getDenominator() const;
+
+private:
+    int64_t numerator;
+    int64_t denominator;
+    int64_t remainder;
+};
+
+}
@@ -0,0 +1,103 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <breakdown.hpp>
+#include <stdexcept>
+#include <chrono>
+#include <iomanip>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace libstepper {
+
+double StepPhaseStats::getMeanNanos() const {
+    return count == 0 ? 0.0 : (double) totalNanos / (double) count;
+}
+
+StepBreakdown::StepBreakdown() {
+    reset();
+}
+
+void StepBreakdown::add(const StepPhase phase, const uint64_t nanos) noexcept {
+    // Only the stepping thread adds, so a plain load and store is enough, and cheaper than fetch_add().
+    counts[phase].store(counts[phase].load(memory_order_relaxed) + 1, memory_order_relaxed);
+    totalNanos[phase].store(totalNanos[phase].load(memory_order_relaxed) + nanos, memory_order_relaxed);
+    if (nanos > maxNanos[phase].load(memory_order_relaxed)) {
+        maxNanos[phase].store(nanos, memory_order_relaxed);
+    }
+}
+
+uint64_t StepBreakdown::addSince(const StepPhase phase, const uint64_t sinceNanos) noexcept {
+    const uint64_t now = nowNanos();
+    add(phase, now > sinceNanos ? now - sinceNanos : 0);
+    return now;
+}
+
+void StepBreakdown::reset() {
+    for (size_t i = 0; i < STEP_PHASE_COUNT; ++i) {
+        counts[i].store(0, memory_order_relaxed);
+        totalNanos[i].store(0, memory_order_relaxed);
+        maxNanos[i].store(0, memory_order_relaxed);
+    }
+}
+
+StepPhaseStats StepBreakdown::get(const StepPhase phase) const {
+    if ((size_t) phase >= STEP_PHASE_COUNT) {
+        throw invalid_argument("Unknown StepPhase value");
+    }
+
+    StepPhaseStats stats;
+    stats.count = counts[phase].load(memory_order_relaxed);
+    stats.totalNanos = totalNanos[phase].load(memory_order_relaxed);
+    stats.maxNanos = maxNanos[phase].load(memory_order_relaxed);
+    return stats;
+}
+
+void StepBreakdown::write(ostream &output) const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < STEP_PHASE_COUNT; ++i) {
+        total += get((StepPhase) i).totalNanos;
+    }
+
+    output << left << setw(10) << "phase" << right
+           << setw(12) << "count"
+           << setw(16) << "total (us)"
+           << setw(12) << "mean (ns)"
+           << setw(12) << "max (ns)"
+           << setw(9) << "share" << "\n";
+    for (size_t i = 0; i < STEP_PHASE_COUNT; ++i) {
+        const StepPhaseStats stats = get((StepPhase) i);
+        const double share = total == 0 ? 0.0 : 100.0 * (double) stats.totalNanos / (double) total;
+        output << left << setw(10) << getPhaseName((StepPhase) i) << right
+               << setw(12) << stats.count
+               << setw(16) << fixed << setprecision(1) << (double) stats.totalNanos / 1000
+               << setw(12) << stats.getMeanNanos()
+               << setw(12) << stats.maxNanos
+               << setw(8) << share << "%\n";
+    }
+}
+
+uint64_t StepBreakdown::nowNanos() noexcept {
+    return (uint64_t) duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+const char *StepBreakdown::getPhaseName(const StepPhase phase) {
+    switch (phase) {
+        case STEP_PHASE_LOCK:
+            return "lock";
+        case STEP_PHASE_WRITE:
+            return "write";
+        case STEP_PHASE_SCHEDULE:
+            return "schedule";
+        case STEP_PHASE_OVERSLEEP:
+            return "oversleep";
+        case STEP_PHASE_RENDER:
+            return "render";
+        default:
+            throw invalid_argument("Unknown StepPhase value");
+    }
+}
+
+}
@@ -0,0 +1,57 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <chain.hpp>
+#include <thread>
+
+using namespace std::this_thread;
+using namespace std::chrono;
+using namespace std;
+
+namespace libstepper {
+
+LocalWaveformChain::LocalWaveformChain(DigitalSignalConsumer &coil1Terminal1,
+                                       DigitalSignalConsumer &coil2Terminal1,
+                                       DigitalSignalConsumer &coil1Terminal2,
+                                       DigitalSignalConsumer &coil2Terminal2) :
+    coilTerminals { &coil1Terminal1, &coil2Terminal1, &coil1Terminal2, &coil2Terminal2 },
+    anchor(steady_clock::now()),
+    batchCount(0),
+    eventCount(0) {
+}
+
+void LocalWaveformChain::begin() {
+    anchor = steady_clock::now();
+}
+
+bool LocalWaveformChain::write(const StepEvent *events, const size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        // Unlike the driver's own playback, a chain is timed against absolute time points, the way a
+        // hardware timer would be.
+        sleep_until(anchor + microseconds(events[i].timestampMicros));
+        for (uint8_t j = 0; j < 4; ++j) {
+            coilTerminals[j]->write(events[i].coilMask & (0x08 /*0b00001000*/ >> j));
+        }
+    }
+
+    if (count > 0) {
+        anchor += microseconds(events[count - 1].timestampMicros);
+    }
+    ++batchCount;
+    eventCount += count;
+    return true;
+}
+
+void LocalWaveformChain::end() {
+}
+
+uint64_t LocalWaveformChain::getBatchCount() const {
+    return batchCount;
+}
+
+uint64_t LocalWaveformChain::getEventCount() const {
+    return eventCount;
+}
+
+}
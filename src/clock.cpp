@@ -0,0 +1,39 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <clock.hpp>
+#include <chrono>
+#include <thread>
+
+using namespace std::this_thread;
+using namespace std::chrono;
+using namespace std;
+
+namespace libstepper {
+
+uint64_t SteadyClock::nowMicros() {
+    return (uint64_t) duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void SteadyClock::sleepForMicros(const uint64_t micros) {
+    sleep_for(microseconds(micros));
+}
+
+SteadyClock &SteadyClock::getInstance() {
+    static SteadyClock instance;
+    return instance;
+}
+
+VirtualClock::VirtualClock() : micros(0) {
+}
+
+uint64_t VirtualClock::nowMicros() {
+    return micros.load();
+}
+
+void VirtualClock::sleepForMicros(const uint64_t micros) {
+    this->micros += micros;
+}
+
+}
@@ -0,0 +1,144 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <follower.hpp>
+#include <stepper.hpp>
+#include <exception.hpp>
+#include <stdexcept>
+#include <limits>
+
+using namespace std;
+
+namespace libstepper {
+
+static void checkFollowerRate(const StepperDriver &follower, const double stepsPerSecond) {
+    if (follower.getMaxSafeRPM() == UINT64_MAX) {
+        return;
+    }
+
+    const double maxStepsPerSecond = (double) follower.getMaxSafeRPM() * (double) follower.getStepsInRotation() / 60;
+    if (stepsPerSecond >= maxStepsPerSecond) {
+        throw IllegalStateError("The leader's max safe RPM would step the follower at or past its own");
+    }
+}
+
+GearFollower::GearFollower(StepperDriver &follower, const int64_t numerator, const uint64_t denominator)
+    : follower(follower), numerator(numerator), denominator((int64_t) denominator), accumulator(0), followerSteps(0) {
+    if (denominator == 0 || denominator > (uint64_t) numeric_limits<int64_t>::max()) {
+        throw invalid_argument("The denominator must be > 0, and fit in an int64_t");
+    }
+    // More than 1 follower step per leader step would have to be taken back to back, at whatever rate the
+    // follower's coils can be written, rather than at the leader's
+    if (numerator > this->denominator || numerator < -this->denominator) {
+        throw invalid_argument("The gear ratio must be within [-1, 1]");
+    }
+}
+
+void GearFollower::start() {
+    follower.startMove();
+}
+
+void GearFollower::onLeaderStep(const RotationDirection direction) {
+    accumulator += direction == COUNTER_CLOCKWISE ? numerator : -numerator;
+
+    // With |numerator| <= denominator, a leader step moves the follower by 1 step at most
+    if (accumulator >= denominator) {
+        accumulator -= denominator;
+        follower.pulse(COUNTER_CLOCKWISE);
+        ++followerSteps;
+    } else if (accumulator <= -denominator) {
+        accumulator += denominator;
+        follower.pulse(CLOCKWISE);
+        --followerSteps;
+    }
+}
+
+void GearFollower::finish() {
+    follower.finishMove();
+}
+
+void GearFollower::checkLeaderRate(const double leaderStepsPerSecond) const {
+    if (numerator != 0) {
+        checkFollowerRate(follower, leaderStepsPerSecond * (double) (numerator < 0 ? -numerator : numerator) / (double) denominator);
+    }
+}
+
+int64_t GearFollower::getFollowerSteps() const {
+    return followerSteps;
+}
+
+CamFollower::CamFollower(StepperDriver &follower, const vector<int64_t> &table, const uint64_t stepsPerEntry)
+    : follower(follower), maxStepsPerLeaderStep(0), leaderPhase(0), followerPosition(0) {
+    if (table.empty() || stepsPerEntry == 0) {
+        throw invalid_argument("The cam table must have entries, and stepsPerEntry must be > 0");
+    }
+
+    const int64_t spacing = (int64_t) stepsPerEntry;
+    positions.reserve(table.size() * stepsPerEntry);
+    for (size_t i = 0; i < table.size(); ++i) {
+        const int64_t from = table[i];
+        const int64_t rise = table[(i + 1) % table.size()] - from;
+        for (int64_t j = 0; j < spacing; ++j) {
+            // Rounded to the nearest step, with halves away from 0 so that rises and falls are symmetric
+            const int64_t scaled = rise * j;
+            positions.push_back(from + (scaled >= 0 ? (scaled + spacing / 2) / spacing : -((-scaled + spacing / 2) / spacing)));
+        }
+    }
+    followerPosition = positions[0];
+
+    for (size_t i = 0; i < positions.size(); ++i) {
+        const int64_t rise = positions[(i + 1) % positions.size()] - positions[i];
+        const uint64_t steps = (uint64_t) (rise < 0 ? -rise : rise);
+        maxStepsPerLeaderStep = steps > maxStepsPerLeaderStep ? steps : maxStepsPerLeaderStep;
+    }
+    // As with GearFollower, the steeper parts would have to be stepped back to back, instead of at the leader's pace
+    if (maxStepsPerLeaderStep > 1) {
+        throw invalid_argument("The cam profile can't be steeper than 1 follower step per leader step");
+    }
+}
+
+void CamFollower::start() {
+    follower.startMove();
+}
+
+void CamFollower::onLeaderStep(const RotationDirection direction) {
+    if (direction == COUNTER_CLOCKWISE) {
+        leaderPhase = leaderPhase + 1 == positions.size() ? 0 : leaderPhase + 1;
+    } else {
+        leaderPhase = leaderPhase == 0 ? positions.size() - 1 : leaderPhase - 1;
+    }
+
+    const int64_t target = positions[leaderPhase];
+    if (followerPosition < target) {
+        follower.pulse(COUNTER_CLOCKWISE);
+        ++followerPosition;
+    } else if (followerPosition > target) {
+        follower.pulse(CLOCKWISE);
+        --followerPosition;
+    }
+}
+
+void CamFollower::finish() {
+    follower.finishMove();
+}
+
+void CamFollower::checkLeaderRate(const double leaderStepsPerSecond) const {
+    if (maxStepsPerLeaderStep != 0) {
+        checkFollowerRate(follower, leaderStepsPerSecond * (double) maxStepsPerLeaderStep);
+    }
+}
+
+uint64_t CamFollower::getLeaderPhase() const {
+    return leaderPhase;
+}
+
+uint64_t CamFollower::getCycleLength() const {
+    return positions.size();
+}
+
+int64_t CamFollower::getFollowerPosition() const {
+    return followerPosition;
+}
+
+}
@@ -0,0 +1,96 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <histogram.hpp>
+#include <cmath>
+
+using namespace std;
+
+namespace libstepper {
+
+static const size_t SUB_BUCKET_BITS = 4;
+
+static size_t getHighestBit(const uint64_t value) noexcept {
+#ifdef __GNUC__
+    return (size_t) (63 - __builtin_clzll(value));
+#else
+    size_t bit = 0;
+    while (value >> (bit + 1) != 0) {
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::record(const uint64_t value) noexcept {
+    // Only one thread records at a time, so a plain load and store is enough, and cheaper than fetch_add().
+    std::atomic<uint64_t> &bucket = buckets[getBucketIndex(value)];
+    bucket.store(bucket.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    count.store(count.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    if (value > max.load(memory_order_relaxed)) {
+        max.store(value, memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; ++i) {
+        buckets[i].store(0, memory_order_relaxed);
+    }
+    count.store(0, memory_order_relaxed);
+    max.store(0, memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getCount() const {
+    return count.load(memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getMax() const {
+    return max.load(memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getPercentile(const double fraction) const {
+    const uint64_t total = getCount();
+    if (total == 0) {
+        return 0;
+    }
+
+    const double rank = ceil(fraction * (double) total);
+    const uint64_t target = rank < 1 ? 1 : (uint64_t) rank;
+    const uint64_t largest = getMax();
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; ++i) {
+        seen += buckets[i].load(memory_order_relaxed);
+        if (seen >= target) {
+            const uint64_t bound = getBucketUpperBound(i);
+            return bound < largest ? bound : largest;
+        }
+    }
+    return largest;
+}
+
+size_t LatencyHistogram::getBucketIndex(const uint64_t value) noexcept {
+    if (value < 2 * LATENCY_HISTOGRAM_SUB_BUCKETS) {
+        return (size_t) value;
+    }
+
+    // The top 5 bits of the value, of which the first is always 1, pick the bucket within its power of 2.
+    const size_t shift = getHighestBit(value) - SUB_BUCKET_BITS;
+    return (shift + 1) * LATENCY_HISTOGRAM_SUB_BUCKETS + (size_t) (value >> shift) - LATENCY_HISTOGRAM_SUB_BUCKETS;
+}
+
+uint64_t LatencyHistogram::getBucketUpperBound(const size_t index) {
+    if (index < 2 * LATENCY_HISTOGRAM_SUB_BUCKETS) {
+        return index;
+    }
+
+    const size_t shift = index / LATENCY_HISTOGRAM_SUB_BUCKETS - 1;
+    const uint64_t mantissa = LATENCY_HISTOGRAM_SUB_BUCKETS + index % LATENCY_HISTOGRAM_SUB_BUCKETS;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+}
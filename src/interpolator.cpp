@@ -0,0 +1,164 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <interpolator.hpp>
+#include <stdexcept>
+
+using namespace std;
+
+namespace libstepper {
+
+LinearInterpolator::LinearInterpolator(const vector<int64_t> &deltas) : tickCount(0), tick(0) {
+    for (size_t i = 0; i < deltas.size(); ++i) {
+        // Negating in unsigned arithmetic, so that INT64_MIN doesn't overflow
+        const uint64_t distance = deltas[i] < 0 ? 0 - (uint64_t) deltas[i] : (uint64_t) deltas[i];
+        distances.push_back(distance);
+        directions.push_back(deltas[i] < 0 ? -1 : 1);
+        tickCount = distance > tickCount ? distance : tickCount;
+    }
+
+    // Starting every error term half way spreads the steps of the minor axes evenly, instead of bunching
+    // them at the end of the move.
+    errors.assign(deltas.size(), tickCount / 2);
+}
+
+size_t LinearInterpolator::getAxisCount() const {
+    return distances.size();
+}
+
+bool LinearInterpolator::next(int8_t *steps) {
+    if (tick == tickCount) {
+        return false;
+    }
+
+    for (size_t i = 0; i < distances.size(); ++i) {
+        errors[i] += distances[i];
+        if (errors[i] >= tickCount) {
+            errors[i] -= tickCount;
+            steps[i] = directions[i];
+        } else {
+            steps[i] = 0;
+        }
+    }
+
+    ++tick;
+    return true;
+}
+
+uint64_t LinearInterpolator::getTickCount() const {
+    return tickCount;
+}
+
+static int64_t sign(const int64_t value) {
+    return value > 0 ? 1 : (value < 0 ? -1 : 0);
+}
+
+static int64_t absolute(const int64_t value) {
+    return value < 0 ? -value : value;
+}
+
+ArcInterpolator::ArcInterpolator(const size_t axisCount,
+                                 const size_t xAxis,
+                                 const size_t yAxis,
+                                 const int64_t endX,
+                                 const int64_t endY,
+                                 const int64_t centerX,
+                                 const int64_t centerY,
+                                 const RotationDirection direction) :
+    axisCount(axisCount),
+    xAxis(xAxis),
+    yAxis(yAxis),
+    x(-centerX),
+    y(-centerY),
+    endX(endX - centerX),
+    endY(endY - centerY),
+    radiusSquared(centerX * centerX + centerY * centerY),
+    orientation(direction == COUNTER_CLOCKWISE ? 1 : -1),
+    armed(false),
+    finishing(false),
+    finish(vector<int64_t>()),
+    tickWeight(TICK_WEIGHT_UNIT) {
+
+    if (xAxis >= axisCount || yAxis >= axisCount || xAxis == yAxis) {
+        throw invalid_argument("The arc's axes must be 2 different axes out of axisCount");
+    }
+    if (this->endX == 0 && this->endY == 0) {
+        throw invalid_argument("The end point of an arc can't be its center");
+    }
+
+    armed = getCross(x, y) > 0;
+}
+
+size_t ArcInterpolator::getAxisCount() const {
+    return axisCount;
+}
+
+uint32_t ArcInterpolator::getTickWeight() const {
+    return tickWeight;
+}
+
+int64_t ArcInterpolator::getError(const int64_t x, const int64_t y) const {
+    return absolute(x * x + y * y - radiusSquared);
+}
+
+// Positive while the end point is less than half a turn ahead of (x, y) in the arc's direction
+int64_t ArcInterpolator::getCross(const int64_t x, const int64_t y) const {
+    return orientation * (x * endY - y * endX);
+}
+
+bool ArcInterpolator::hasPassedEnd(const int64_t x, const int64_t y) const {
+    return armed && getCross(x, y) <= 0 && x * endX + y * endY > 0;
+}
+
+bool ArcInterpolator::next(int8_t *steps) {
+    for (size_t i = 0; i < axisCount; ++i) {
+        steps[i] = 0;
+    }
+
+    if (finishing) {
+        int8_t finishSteps[2];
+        if (!finish.next(finishSteps)) {
+            return false;
+        }
+        steps[xAxis] = finishSteps[0];
+        steps[yAxis] = finishSteps[1];
+        tickWeight = finishSteps[0] != 0 && finishSteps[1] != 0 ? DIAGONAL_TICK_WEIGHT : TICK_WEIGHT_UNIT;
+        return true;
+    }
+
+    // The tangent in the arc's direction is (-y, x) for counter clockwise arcs, and (y, -x) for clockwise ones.
+    const int64_t tangentX = -orientation * y;
+    const int64_t tangentY = orientation * x;
+    int64_t nextX = x;
+    int64_t nextY = y;
+
+    if (tangentX != 0 && absolute(tangentX) >= absolute(tangentY)) {
+        // Moving faster along x: always step x, and step y if that stays closer to the circle.
+        nextX += sign(tangentX);
+        const int64_t stepY = tangentY != 0 ? sign(tangentY) : -sign(y);
+        nextY = getError(nextX, y + stepY) < getError(nextX, y) ? y + stepY : y;
+    } else if (tangentY != 0) {
+        nextY += sign(tangentY);
+        const int64_t stepX = tangentX != 0 ? sign(tangentX) : -sign(x);
+        nextX = getError(x + stepX, nextY) < getError(x, nextY) ? x + stepX : x;
+    }
+
+    if ((nextX == x && nextY == y) || hasPassedEnd(nextX, nextY)) {
+        // Reached the end point, or the end point isn't exactly on the traced circle; either way, close the
+        // remaining gap (if any) with a straight line.
+        finishing = true;
+        finish = LinearInterpolator({ endX - x, endY - y });
+        return next(steps);
+    }
+
+    steps[xAxis] = (int8_t) (nextX - x);
+    steps[yAxis] = (int8_t) (nextY - y);
+    tickWeight = steps[xAxis] != 0 && steps[yAxis] != 0 ? DIAGONAL_TICK_WEIGHT : TICK_WEIGHT_UNIT;
+    x = nextX;
+    y = nextY;
+    armed = armed || getCross(x, y) > 0;
+    return true;
+}
+
+}
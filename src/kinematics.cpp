@@ -0,0 +1,157 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <kinematics.hpp>
+#include <stdexcept>
+#include <cmath>
+
+using namespace std;
+
+namespace libstepper {
+
+static const double PI = 3.14159265358979323846;
+
+CartesianKinematics::CartesianKinematics(const double xStepsPerMillimeter, const double yStepsPerMillimeter, const double zStepsPerMillimeter) {
+    if (!(xStepsPerMillimeter > 0) || !(yStepsPerMillimeter > 0) || !(zStepsPerMillimeter > 0)) {
+        throw invalid_argument("Steps per millimeter must be positive");
+    }
+    stepsPerMillimeter[0] = xStepsPerMillimeter;
+    stepsPerMillimeter[1] = yStepsPerMillimeter;
+    stepsPerMillimeter[2] = zStepsPerMillimeter;
+}
+
+size_t CartesianKinematics::getMotorCount() const {
+    return KINEMATICS_COORDINATES;
+}
+
+void CartesianKinematics::toMotorSteps(const double *position, int64_t *steps) const {
+    for (size_t i = 0; i < KINEMATICS_COORDINATES; ++i) {
+        steps[i] = llround(position[i] * stepsPerMillimeter[i]);
+    }
+}
+
+void CartesianKinematics::toPosition(const int64_t *steps, double *position) const {
+    for (size_t i = 0; i < KINEMATICS_COORDINATES; ++i) {
+        position[i] = (double) steps[i] / stepsPerMillimeter[i];
+    }
+}
+
+bool CartesianKinematics::isLinear() const {
+    return true;
+}
+
+CoreXYKinematics::CoreXYKinematics(const double xyStepsPerMillimeter, const double zStepsPerMillimeter)
+    : xyStepsPerMillimeter(xyStepsPerMillimeter), zStepsPerMillimeter(zStepsPerMillimeter) {
+    if (!(xyStepsPerMillimeter > 0) || !(zStepsPerMillimeter > 0)) {
+        throw invalid_argument("Steps per millimeter must be positive");
+    }
+}
+
+size_t CoreXYKinematics::getMotorCount() const {
+    return 3;
+}
+
+void CoreXYKinematics::toMotorSteps(const double *position, int64_t *steps) const {
+    steps[0] = llround((position[0] + position[1]) * xyStepsPerMillimeter);
+    steps[1] = llround((position[0] - position[1]) * xyStepsPerMillimeter);
+    steps[2] = llround(position[2] * zStepsPerMillimeter);
+}
+
+void CoreXYKinematics::toPosition(const int64_t *steps, double *position) const {
+    position[0] = (double) (steps[0] + steps[1]) / (2 * xyStepsPerMillimeter);
+    position[1] = (double) (steps[0] - steps[1]) / (2 * xyStepsPerMillimeter);
+    position[2] = (double) steps[2] / zStepsPerMillimeter;
+}
+
+bool CoreXYKinematics::isLinear() const {
+    return true;
+}
+
+LinearDeltaKinematics::LinearDeltaKinematics(const double towerRadius, const double rodLength, const double stepsPerMillimeter)
+    : rodLengthSquared(rodLength * rodLength), stepsPerMillimeter(stepsPerMillimeter) {
+    if (!(towerRadius > 0) || !(rodLength > towerRadius)) {
+        throw invalid_argument("The rods must be longer than the tower radius");
+    }
+    if (!(stepsPerMillimeter > 0)) {
+        throw invalid_argument("Steps per millimeter must be positive");
+    }
+
+    const double angles[] = { 210, 330, 90 };
+    for (size_t i = 0; i < 3; ++i) {
+        towerX[i] = towerRadius * cos(angles[i] * PI / 180);
+        towerY[i] = towerRadius * sin(angles[i] * PI / 180);
+    }
+}
+
+size_t LinearDeltaKinematics::getMotorCount() const {
+    return 3;
+}
+
+void LinearDeltaKinematics::toMotorSteps(const double *position, int64_t *steps) const {
+    for (size_t i = 0; i < 3; ++i) {
+        const double dx = position[0] - towerX[i];
+        const double dy = position[1] - towerY[i];
+        const double heightSquared = rodLengthSquared - dx * dx - dy * dy;
+        if (heightSquared < 0) {
+            throw invalid_argument("The position is out of the delta's reach");
+        }
+        steps[i] = llround((position[2] + sqrt(heightSquared)) * stepsPerMillimeter);
+    }
+}
+
+void LinearDeltaKinematics::toPosition(const int64_t *steps, double *position) const {
+    // Trilateration: the toolhead is where the spheres of the rods around the 3 carriages meet, below them.
+    double carriages[3][3];
+    for (size_t i = 0; i < 3; ++i) {
+        carriages[i][0] = towerX[i];
+        carriages[i][1] = towerY[i];
+        carriages[i][2] = (double) steps[i] / stepsPerMillimeter;
+    }
+
+    // A frame with the first carriage at the origin, the second on its x axis, and the third in its xy plane
+    double ex[3], ey[3], ez[3], toThird[3];
+    double d = 0;
+    for (size_t i = 0; i < 3; ++i) {
+        ex[i] = carriages[1][i] - carriages[0][i];
+        toThird[i] = carriages[2][i] - carriages[0][i];
+        d += ex[i] * ex[i];
+    }
+    d = sqrt(d);
+    double along = 0;
+    for (size_t i = 0; i < 3; ++i) {
+        ex[i] /= d;
+        along += ex[i] * toThird[i];
+    }
+    double across = 0;
+    for (size_t i = 0; i < 3; ++i) {
+        ey[i] = toThird[i] - along * ex[i];
+        across += ey[i] * ey[i];
+    }
+    across = sqrt(across);
+    for (size_t i = 0; i < 3; ++i) {
+        ey[i] /= across;
+    }
+    ez[0] = ex[1] * ey[2] - ex[2] * ey[1];
+    ez[1] = ex[2] * ey[0] - ex[0] * ey[2];
+    ez[2] = ex[0] * ey[1] - ex[1] * ey[0];
+
+    // The rods are all the same length, which simplifies the sphere intersection
+    const double x = d / 2;
+    const double y = (along * along + across * across - 2 * along * x) / (2 * across);
+    const double heightSquared = rodLengthSquared - x * x - y * y;
+    if (heightSquared < 0) {
+        throw invalid_argument("The carriages are out of the rods' reach");
+    }
+    // Whichever way ez points, the toolhead hangs below the carriages
+    const double height = ez[2] > 0 ? -sqrt(heightSquared) : sqrt(heightSquared);
+    for (size_t i = 0; i < 3; ++i) {
+        position[i] = carriages[0][i] + x * ex[i] + y * ey[i] + height * ez[i];
+    }
+}
+
+bool LinearDeltaKinematics::isLinear() const {
+    return false;
+}
+
+}
@@ -0,0 +1,299 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <multiaxis.hpp>
+#include <exception.hpp>
+#include <stdexcept>
+#include <cmath>
+#include <chrono>
+#include <thread>
+
+using namespace std::this_thread;
+using namespace std::chrono;
+using namespace std;
+
+namespace libstepper {
+
+MultiAxisController::MultiAxisController(const vector<StepperDriver *> &axes) : axes(axes), tickSteps(axes.size(), 0), energized(false), interrupted(false) {
+    if (axes.empty()) {
+        throw invalid_argument("A MultiAxisController needs at least 1 axis");
+    }
+    for (size_t i = 0; i < axes.size(); ++i) {
+        if (axes[i] == nullptr) {
+            throw invalid_argument("Axes can't be null");
+        }
+    }
+}
+
+size_t MultiAxisController::getAxisCount() const {
+    return axes.size();
+}
+
+StepperDriver &MultiAxisController::getAxis(const size_t index) const {
+    return *axes.at(index);
+}
+
+void MultiAxisController::interrupt() {
+    unique_lock<mutex> lock(interruptMutex);
+    for (size_t i = 0; i < axes.size(); ++i) {
+        axes[i]->interrupt();
+    }
+    interrupted = true;
+}
+
+bool MultiAxisController::isInterrupted() {
+    unique_lock<mutex> lock(interruptMutex);
+    return interrupted;
+}
+
+// A profile at a constant ticksPerSecond, kept as a double so that rates lowered below 1 tick per second
+// aren't truncated to 0
+static PathProfile getConstantProfile(const double ticksPerSecond) {
+    PathProfile profile;
+    profile.length = 0;
+    profile.distancePerTick = 1;
+    profile.entrySpeed = 0;
+    profile.cruiseSpeed = ticksPerSecond;
+    profile.exitSpeed = 0;
+    profile.acceleration = 0;
+    return profile;
+}
+
+bool MultiAxisController::move(const vector<int64_t> &steps, const uint64_t stepsPerSecond) {
+    if (steps.size() != axes.size()) {
+        throw invalid_argument("Expected a step count for every axis");
+    }
+
+    LinearInterpolator interpolator(steps);
+    double ticksPerSecond = (double) stepsPerSecond;
+
+    // An axis with d of the N steps of the longest axis takes d/N steps per tick.
+    for (size_t i = 0; i < axes.size(); ++i) {
+        const uint64_t maxSafeRPM = axes[i]->getMaxSafeRPM();
+        if (steps[i] == 0 || maxSafeRPM == UINT64_MAX) {
+            continue;
+        }
+        const double distance = steps[i] < 0 ? -(double) steps[i] : (double) steps[i];
+        const double maxSafeStepsPerSecond = (double) maxSafeRPM * (double) axes[i]->getStepsInRotation() / 60.0;
+        const double limit = maxSafeStepsPerSecond * (double) interpolator.getTickCount() / distance;
+        ticksPerSecond = limit < ticksPerSecond ? limit : ticksPerSecond;
+    }
+
+    return run(interpolator, getConstantProfile(ticksPerSecond));
+}
+
+SynchronizedMove MultiAxisController::planSynchronized(const vector<int64_t> &steps) const {
+    if (steps.size() != axes.size()) {
+        throw invalid_argument("Expected a step count for every axis");
+    }
+
+    // Every axis moves d/N of the longest axis's N steps on every tick, so an axis limited to v steps/s
+    // and a steps/s^2 limits the ticks to v * N/d ticks/s, and a * N/d ticks/s^2.
+    double tickCount = 0;
+    for (size_t i = 0; i < steps.size(); ++i) {
+        tickCount = max(tickCount, fabs((double) steps[i]));
+    }
+
+    SynchronizedMove move;
+    move.profile.length = tickCount;
+    move.profile.distancePerTick = 1;
+    move.profile.entrySpeed = 0;
+    move.profile.cruiseSpeed = HUGE_VAL;
+    move.profile.exitSpeed = 0;
+    move.profile.acceleration = HUGE_VAL;
+    move.durationMicros = 0;
+
+    for (size_t i = 0; i < axes.size(); ++i) {
+        if (steps[i] == 0) {
+            continue;
+        }
+
+        const StepperDriver *axis = axes[i];
+        const double scale = tickCount / fabs((double) steps[i]);
+        const double stepsPerRevolution = (double) axis->getStepsInRotation();
+        const uint64_t rpm = axis->getMaxSafeRPM() == UINT64_MAX ? axis->getRPM() : axis->getMaxSafeRPM();
+        move.profile.cruiseSpeed = min(move.profile.cruiseSpeed, (double) rpm * stepsPerRevolution / 60 * scale);
+        if (axis->getAcceleration() != 0) {
+            move.profile.acceleration = min(move.profile.acceleration, (double) axis->getAcceleration() * stepsPerRevolution / 60 * scale);
+        }
+    }
+
+    if (tickCount == 0) {
+        // Nothing moves, and nothing limits the move
+        move.profile.cruiseSpeed = 1;
+        move.profile.acceleration = 0;
+        return move;
+    }
+    if (!(move.profile.cruiseSpeed > 0)) {
+        move.profile.cruiseSpeed = 0;
+        move.profile.acceleration = 0;
+        return move;
+    }
+
+    // Rest to rest, a trapezoid cruises only if the ramps take less than the whole distance.
+    const double speed = move.profile.cruiseSpeed;
+    double seconds = tickCount / speed;
+    if (move.profile.acceleration == HUGE_VAL) {
+        move.profile.acceleration = 0;
+    } else {
+        const double acceleration = move.profile.acceleration;
+        seconds = tickCount >= speed * speed / acceleration ? tickCount / speed + speed / acceleration : 2 * sqrt(tickCount / acceleration);
+    }
+    move.durationMicros = (uint64_t) llround(seconds * 1000000);
+    return move;
+}
+
+bool MultiAxisController::moveSynchronized(const vector<int64_t> &steps) {
+    const SynchronizedMove move = planSynchronized(steps);
+    LinearInterpolator interpolator(steps);
+    return run(interpolator, move.profile);
+}
+
+bool MultiAxisController::arc(const size_t xAxis,
+                              const size_t yAxis,
+                              const int64_t endX,
+                              const int64_t endY,
+                              const int64_t centerX,
+                              const int64_t centerY,
+                              const RotationDirection direction,
+                              const uint64_t stepsPerSecond) {
+    ArcInterpolator interpolator(axes.size(), xAxis, yAxis, endX, endY, centerX, centerY, direction);
+
+    // Neither axis ever moves faster than the path itself.
+    double ticksPerSecond = (double) stepsPerSecond;
+    const size_t arcAxes[] = { xAxis, yAxis };
+    for (size_t i = 0; i < 2; ++i) {
+        const StepperDriver *axis = axes[arcAxes[i]];
+        if (axis->getMaxSafeRPM() == UINT64_MAX) {
+            continue;
+        }
+        const double maxSafeStepsPerSecond = (double) axis->getMaxSafeRPM() * (double) axis->getStepsInRotation() / 60.0;
+        ticksPerSecond = maxSafeStepsPerSecond < ticksPerSecond ? maxSafeStepsPerSecond : ticksPerSecond;
+    }
+
+    return run(interpolator, getConstantProfile(ticksPerSecond));
+}
+
+void MultiAxisController::begin() {
+    if (energized) {
+        throw IllegalStateError("The controller has already begun");
+    }
+
+    {
+        unique_lock<mutex> lock(interruptMutex);
+        interrupted = false;
+    }
+
+    for (size_t i = 0; i < axes.size(); ++i) {
+        axes[i]->startMove();
+    }
+    deadline = steady_clock::now();
+    energized = true;
+}
+
+void MultiAxisController::end() {
+    if (!energized) {
+        throw IllegalStateError("The controller hasn't begun");
+    }
+
+    for (size_t i = 0; i < axes.size(); ++i) {
+        axes[i]->finishMove();
+    }
+    energized = false;
+}
+
+bool MultiAxisController::hasBegun() const {
+    return energized;
+}
+
+bool MultiAxisController::run(MotionInterpolator &interpolator, const uint64_t ticksPerSecond) {
+    return run(interpolator, getConstantProfile((double) ticksPerSecond));
+}
+
+bool MultiAxisController::run(MotionInterpolator &interpolator, const PathProfile &profile) {
+    if (interpolator.getAxisCount() != axes.size()) {
+        throw invalid_argument("The interpolator must have as many axes as the controller");
+    }
+
+    if (!(profile.cruiseSpeed > 0)) {
+        if (!energized) {
+            unique_lock<mutex> lock(interruptMutex);
+            interrupted = false;
+        }
+        return false;
+    }
+
+    const bool ownsSession = !energized;
+    if (ownsSession) {
+        begin();
+    }
+    // Moves don't start in the past, e.g. after a gap since begin() or the last move, or the ticks would
+    // burst until the schedule caught up, faster than any axis's max safe RPM.
+    deadline = max(deadline, steady_clock::now());
+
+    // Every tick is scheduled against the same absolute clock, so the axes can't drift apart, and late
+    // ticks don't stretch the rest of the move.
+    const double twiceAcceleration = 2 * profile.acceleration;
+    const double entrySquared = profile.entrySpeed * profile.entrySpeed;
+    const double exitSquared = profile.exitSpeed * profile.exitSpeed;
+    double position = 0;
+    bool completed = true;
+
+    while (interpolator.next(tickSteps.data())) {
+        if (isInterrupted()) {
+            completed = false;
+            break;
+        }
+
+        const double distance = profile.distancePerTick * interpolator.getTickWeight() / TICK_WEIGHT_UNIT;
+        double speed = profile.cruiseSpeed;
+        if (profile.acceleration > 0) {
+            // The speed halfway through the tick, so that ticks starting from a standstill take finite time
+            const double midpoint = position + distance / 2;
+            const double remaining = profile.length > midpoint ? profile.length - midpoint : 0;
+            speed = min(speed, sqrt(entrySquared + twiceAcceleration * midpoint));
+            speed = min(speed, sqrt(exitSquared + twiceAcceleration * remaining));
+            // Never slower than half a tick from a standstill, so that ticks past the end of a profile that's
+            // shorter than its interpolator still take finite time
+            speed = max(speed, min(profile.cruiseSpeed, sqrt(profile.acceleration * distance)));
+        }
+        position += distance;
+
+        if (distance > 0) {
+            deadline += nanoseconds((int64_t) llround(1e9 * distance / speed));
+        }
+        sleep_until(deadline);
+
+        for (size_t i = 0; i < axes.size(); ++i) {
+            if (tickSteps[i] != 0) {
+                axes[i]->pulse(tickSteps[i] > 0 ? COUNTER_CLOCKWISE : CLOCKWISE);
+            }
+        }
+    }
+
+    if (ownsSession) {
+        end();
+    }
+    return completed;
+}
+
+bool MultiAxisController::dwell(const uint64_t micros) {
+    // Like run(), a dwell doesn't start in the past
+    const steady_clock::time_point until = (energized ? max(deadline, steady_clock::now()) : steady_clock::now()) + microseconds(micros);
+    if (energized) {
+        deadline = until;
+    }
+
+    // Sleeps in slices, so that long dwells can be interrupted.
+    const microseconds slice(10000);
+    for (steady_clock::time_point now = steady_clock::now(); now < until; now = steady_clock::now()) {
+        if (isInterrupted()) {
+            return false;
+        }
+        sleep_until(min(until, now + slice));
+    }
+    return !isInterrupted();
+}
+
+}
@@ -0,0 +1,87 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <plancache.hpp>
+#include <stdexcept>
+#include <functional>
+
+using namespace std;
+
+namespace libstepper {
+
+bool PlanKey::operator==(const PlanKey &rhs) const {
+    return steps == rhs.steps && rpm == rhs.rpm && acceleration == rhs.acceleration && stepsInRotation == rhs.stepsInRotation;
+}
+
+size_t PlanKeyHash::operator()(const PlanKey &key) const {
+    const hash<uint64_t> hasher;
+    size_t seed = hasher(key.steps);
+    seed ^= hasher(key.rpm) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    seed ^= hasher(key.acceleration) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    seed ^= hasher(key.stepsInRotation) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    return seed;
+}
+
+PlanCache::PlanCache(const size_t capacity) : capacity(capacity), hits(0), misses(0) {
+    if (capacity == 0) {
+        throw invalid_argument("capacity must be > 0");
+    }
+}
+
+shared_ptr<const StepQueue> PlanCache::find(const PlanKey &key) {
+    unique_lock<mutex> lock(cacheMutex);
+    auto found = index.find(key);
+    if (found == index.end()) {
+        ++misses;
+        return shared_ptr<const StepQueue>();
+    }
+
+    ++hits;
+    entries.splice(entries.begin(), entries, found->second);
+    return found->second->second;
+}
+
+void PlanCache::insert(const PlanKey &key, const shared_ptr<const StepQueue> &plan) {
+    unique_lock<mutex> lock(cacheMutex);
+    auto found = index.find(key);
+    if (found != index.end()) {
+        found->second->second = plan;
+        entries.splice(entries.begin(), entries, found->second);
+        return;
+    }
+
+    if (entries.size() == capacity) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+    entries.push_front(make_pair(key, plan));
+    index[key] = entries.begin();
+}
+
+void PlanCache::clear() {
+    unique_lock<mutex> lock(cacheMutex);
+    entries.clear();
+    index.clear();
+}
+
+size_t PlanCache::size() const {
+    unique_lock<mutex> lock(cacheMutex);
+    return entries.size();
+}
+
+size_t PlanCache::getCapacity() const {
+    return capacity;
+}
+
+uint64_t PlanCache::getHitCount() const {
+    unique_lock<mutex> lock(cacheMutex);
+    return hits;
+}
+
+uint64_t PlanCache::getMissCount() const {
+    unique_lock<mutex> lock(cacheMutex);
+    return misses;
+}
+
+}
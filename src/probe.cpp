@@ -0,0 +1,75 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <probe.hpp>
+#include <stdexcept>
+#include <cmath>
+
+using namespace std;
+
+namespace libstepper {
+
+LatencyProbe::LatencyProbe(Clock &clock, const TimingCalibration &calibration) : clock(clock), calibration(calibration) {
+}
+
+void LatencyProbe::run(const size_t samples, const uint64_t intervalMicros) {
+    if (samples == 0 || intervalMicros == 0) {
+        throw invalid_argument("samples and intervalMicros must be > 0");
+    }
+
+    // Against absolute deadlines, so that one late wakeup doesn't push the rest back
+    const uint64_t leadMicros = calibration.oversleepMicros;
+    uint64_t dueMicros = clock.nowMicros();
+    for (size_t i = 0; i < samples; ++i) {
+        dueMicros += intervalMicros;
+        const uint64_t nowMicros = clock.nowMicros();
+        if (dueMicros > nowMicros + leadMicros) {
+            clock.sleepForMicros(dueMicros - nowMicros - leadMicros);
+        }
+
+        const uint64_t wokenMicros = clock.nowMicros();
+        histogram.record(wokenMicros > dueMicros ? wokenMicros - dueMicros : 0);
+        // Like SHIFT_SCHEDULE, a wakeup past the next deadline starts the schedule over
+        if (wokenMicros > dueMicros + intervalMicros) {
+            dueMicros = wokenMicros;
+        }
+    }
+}
+
+void LatencyProbe::reset() {
+    histogram.reset();
+}
+
+const LatencyHistogram &LatencyProbe::getHistogram() const {
+    return histogram;
+}
+
+uint64_t LatencyProbe::getSafeStepsPerSecond(const double fraction) const {
+    if (!(fraction > 0 && fraction <= 1)) {
+        throw invalid_argument("fraction must be in (0, 1]");
+    }
+
+    const uint64_t latenessMicros = histogram.getPercentile(0.999);
+    if (latenessMicros == 0) {
+        return UINT64_MAX;
+    }
+
+    // The shortest period that the lateness is at most the fraction of
+    const double periodMicros = ceil((double) latenessMicros / fraction);
+    return (uint64_t) floor(1000000.0 / periodMicros);
+}
+
+uint64_t LatencyProbe::getSafeRPM(const uint64_t stepsInRotation, const double fraction) const {
+    if (stepsInRotation == 0) {
+        throw invalid_argument("stepsInRotation must be > 0");
+    }
+
+    const uint64_t stepsPerSecond = getSafeStepsPerSecond(fraction);
+    if (stepsPerSecond == UINT64_MAX) {
+        return UINT64_MAX;
+    }
+    return stepsPerSecond * 60 / stepsInRotation;
+}
+
+}
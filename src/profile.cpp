@@ -0,0 +1,60 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <profile.hpp>
+#include <stdexcept>
+#include <cmath>
+
+using namespace std;
+
+namespace libstepper {
+
+/*
+    Let the delay be x us; stepsInRotation = s
+
+    s steps == 360 degrees. Therefore, => 1 step == 360/s degrees ... (1)
+
+    1 step takes x us. Therefore, by (1), 360/s degrees take x us.
+    Therefore, angular velocity
+        = 360/(sx) degrees/us
+        == 1/(sx) rotations/us
+        == (10^6) * 60/(sx) RPM
+
+    Therefore, rpm = 60 * 1000 * 1000/(sx)
+        => x = 60'000'000/(rpm*s)
+*/
+
+/*
+    Let the acceleration be A RPM/s; stepsInRotation = s
+
+    A RPM/s == A*s/60 steps/s^2 == a. Starting from rest, the n-th step is taken at t(n) = sqrt(2n/a) s.
+    Therefore, t(n) = (10^6) * sqrt(2/a) * sqrt(n) us, and the n-th step waits t(n) - t(n-1) us.
+*/
+
+StepProfile::StepProfile(const uint64_t stepsInRotation, const uint64_t rpm, const uint64_t acceleration) {
+    if (stepsInRotation == 0 || rpm == 0) {
+        throw invalid_argument("stepsInRotation and rpm must be > 0");
+    }
+
+    cruiseIntervalMicros = 60000000/(rpm * stepsInRotation);
+    rampScaleMicros = acceleration == 0 ? 0.0 : 1000000.0 * sqrt(120.0 / ((double) acceleration * (double) stepsInRotation));
+}
+
+uint64_t StepProfile::getIntervalMicros(const uint64_t step, const uint64_t totalSteps) const {
+    if (rampScaleMicros == 0.0) {
+        return cruiseIntervalMicros;
+    }
+
+    // Distance from the nearer end of the move, so that the ramp down mirrors the ramp up.
+    const uint64_t stepsFromRest = totalSteps - step + 1 < step ? totalSteps - step + 1 : step;
+    const uint64_t rampIntervalMicros = (uint64_t) (llround(rampScaleMicros * sqrt((double) stepsFromRest)) - llround(rampScaleMicros * sqrt((double) (stepsFromRest - 1))));
+
+    return rampIntervalMicros > cruiseIntervalMicros ? rampIntervalMicros : cruiseIntervalMicros;
+}
+
+uint64_t StepProfile::getCruiseIntervalMicros() const {
+    return cruiseIntervalMicros;
+}
+
+}
@@ -0,0 +1,177 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <realtime.hpp>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <alloca.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace libstepper {
+
+RealtimeConfig::RealtimeConfig() :
+    policy(REALTIME_POLICY_NONE),
+    priority(0),
+    runtimeMicros(0),
+    deadlineMicros(0),
+    periodMicros(0),
+    cpu(-1),
+    minimizeTimerSlack(false),
+    lockMemory(false),
+    prefaultStackBytes(0) {
+}
+
+RealtimeStatus::RealtimeStatus() : applied(true) {
+}
+
+void RealtimeConfig::validate() const {
+    switch (policy) {
+        case REALTIME_POLICY_NONE:
+            break;
+        case REALTIME_POLICY_FIFO:
+            if (priority < 1 || priority > 99) {
+                throw invalid_argument("The SCHED_FIFO priority must be in [1, 99]");
+            }
+            break;
+        case REALTIME_POLICY_DEADLINE:
+            if (runtimeMicros == 0 || runtimeMicros > deadlineMicros || deadlineMicros > periodMicros) {
+                throw invalid_argument("SCHED_DEADLINE needs 0 < runtime <= deadline <= period");
+            }
+            break;
+        default:
+            throw invalid_argument("Unknown RealtimePolicy value");
+    }
+
+    if (cpu < -1) {
+        throw invalid_argument("cpu must be >= 0, or -1");
+    }
+}
+
+static void fail(RealtimeStatus &status, const string &setting, const string &reason) {
+    status.applied = false;
+    status.failures.push_back(setting + ": " + reason);
+}
+
+#ifdef __linux__
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+// glibc has no wrapper for sched_setattr(), so it's called through syscall(), with the kernel's struct.
+struct DeadlineAttributes {
+    uint32_t size;
+    uint32_t policy;
+    uint64_t flags;
+    int32_t nice;
+    uint32_t priority;
+    uint64_t runtimeNanos;
+    uint64_t deadlineNanos;
+    uint64_t periodNanos;
+};
+
+static void setPolicy(const RealtimeConfig &config, RealtimeStatus &status) {
+    if (config.policy == REALTIME_POLICY_FIFO) {
+        sched_param param;
+        param.sched_priority = config.priority;
+        const int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (error != 0) {
+            fail(status, "SCHED_FIFO", strerror(error));
+        }
+    } else if (config.policy == REALTIME_POLICY_DEADLINE) {
+#ifdef SYS_sched_setattr
+        DeadlineAttributes attributes;
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        attributes.policy = SCHED_DEADLINE;
+        attributes.runtimeNanos = config.runtimeMicros * 1000;
+        attributes.deadlineNanos = config.deadlineMicros * 1000;
+        attributes.periodNanos = config.periodMicros * 1000;
+        if (syscall(SYS_sched_setattr, 0, &attributes, 0) != 0) {
+            fail(status, "SCHED_DEADLINE", strerror(errno));
+        }
+#else
+        fail(status, "SCHED_DEADLINE", "not supported by this kernel's headers");
+#endif
+    }
+}
+
+// Not inlined, so that the stack it touches is below the caller's, where the steps will run.
+static void __attribute__((noinline)) prefaultStack(const size_t bytes) {
+    volatile unsigned char *stack = (volatile unsigned char *) alloca(bytes);
+    const size_t pageBytes = (size_t) sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < bytes; i += pageBytes) {
+        stack[i] = 0;
+    }
+}
+
+RealtimeStatus applyRealtimeConfig(const RealtimeConfig &config) {
+    config.validate();
+    RealtimeStatus status;
+
+    // Locked first, so that the prefaulted stack stays locked
+    if (config.lockMemory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        fail(status, "mlockall", strerror(errno));
+    }
+    if (config.prefaultStackBytes > 0) {
+        prefaultStack(config.prefaultStackBytes);
+    }
+
+    if (config.cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET((size_t) config.cpu, &cpus);
+        const int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (error != 0) {
+            fail(status, "CPU affinity", strerror(error));
+        }
+    }
+
+    if (config.minimizeTimerSlack && prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL) != 0) {
+        fail(status, "timer slack", strerror(errno));
+    }
+
+    setPolicy(config, status);
+    return status;
+}
+
+#else
+
+RealtimeStatus applyRealtimeConfig(const RealtimeConfig &config) {
+    config.validate();
+    RealtimeStatus status;
+
+    const char *reason = "only supported on Linux";
+    if (config.lockMemory) {
+        fail(status, "mlockall", reason);
+    }
+    if (config.prefaultStackBytes > 0) {
+        fail(status, "stack prefault", reason);
+    }
+    if (config.cpu >= 0) {
+        fail(status, "CPU affinity", reason);
+    }
+    if (config.minimizeTimerSlack) {
+        fail(status, "timer slack", reason);
+    }
+    if (config.policy != REALTIME_POLICY_NONE) {
+        fail(status, config.policy == REALTIME_POLICY_FIFO ? "SCHED_FIFO" : "SCHED_DEADLINE", reason);
+    }
+    return status;
+}
+
+#endif
+
+}
@@ -0,0 +1,196 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <stats.hpp>
+#include <iomanip>
+#include <limits>
+#include <locale>
+#include <sstream>
+
+using namespace std;
+
+namespace libstepper {
+
+// Only the stepping thread writes the counters, so a plain load and store is enough, and cheaper than fetch_add().
+static void add(atomic<uint64_t> &counter, const uint64_t value) noexcept {
+    counter.store(counter.load(memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+StepperCounters::StepperCounters() :
+    clockwiseSteps(0),
+    counterClockwiseSteps(0),
+    completedMoves(0),
+    interruptedMoves(0),
+    enabledMicros(0),
+    enabledSinceMicros(0),
+    enabled(false),
+    missedDeadlines(0),
+    maxLatenessMicros(0),
+    derations(0),
+    intervalMicros(0) {
+}
+
+void StepperCounters::addSteps(const uint64_t steps, const RotationDirection direction) noexcept {
+    // The driver validates the direction of a move before it starts
+    add(direction == COUNTER_CLOCKWISE ? counterClockwiseSteps : clockwiseSteps, steps);
+}
+
+void StepperCounters::addMove(const bool completed) noexcept {
+    add(completed ? completedMoves : interruptedMoves, 1);
+}
+
+void StepperCounters::setEnabled(const bool enabled, const uint64_t nowMicros) noexcept {
+    if (enabled == this->enabled.load(memory_order_relaxed)) {
+        return;
+    }
+
+    if (enabled) {
+        enabledSinceMicros.store(nowMicros, memory_order_relaxed);
+    } else {
+        add(enabledMicros, nowMicros - enabledSinceMicros.load(memory_order_relaxed));
+        intervalMicros.store(0, memory_order_relaxed);
+    }
+    this->enabled.store(enabled, memory_order_release);
+}
+
+void StepperCounters::addScheduledStep(const uint64_t intervalMicros, const uint64_t latenessMicros) noexcept {
+    if (latenessMicros > intervalMicros) {
+        add(missedDeadlines, 1);
+    }
+    if (latenessMicros > maxLatenessMicros.load(memory_order_relaxed)) {
+        maxLatenessMicros.store(latenessMicros, memory_order_relaxed);
+    }
+    this->intervalMicros.store(intervalMicros, memory_order_relaxed);
+}
+
+void StepperCounters::setIntervalMicros(const uint64_t intervalMicros) noexcept {
+    this->intervalMicros.store(intervalMicros, memory_order_relaxed);
+}
+
+void StepperCounters::addDeration() noexcept {
+    add(derations, 1);
+}
+
+StepperStats StepperCounters::getSnapshot(const uint64_t nowMicros) const {
+    StepperStats stats;
+    stats.clockwiseSteps = clockwiseSteps.load(memory_order_relaxed);
+    stats.counterClockwiseSteps = counterClockwiseSteps.load(memory_order_relaxed);
+    stats.completedMoves = completedMoves.load(memory_order_relaxed);
+    stats.interruptedMoves = interruptedMoves.load(memory_order_relaxed);
+    stats.enabledMicros = enabledMicros.load(memory_order_relaxed);
+    if (enabled.load(memory_order_acquire)) {
+        const uint64_t since = enabledSinceMicros.load(memory_order_relaxed);
+        stats.enabledMicros += nowMicros > since ? nowMicros - since : 0;
+    }
+    stats.missedDeadlines = missedDeadlines.load(memory_order_relaxed);
+    stats.maxLatenessMicros = maxLatenessMicros.load(memory_order_relaxed);
+    stats.derations = derations.load(memory_order_relaxed);
+    const uint64_t interval = intervalMicros.load(memory_order_relaxed);
+    stats.stepsPerSecond = interval == 0 ? 0.0 : 1000000.0 / (double) interval;
+    return stats;
+}
+
+// Label values may not contain raw backslashes, quotes, or newlines.
+static string escapeLabel(const string &value) {
+    string escaped;
+    for (size_t i = 0; i < value.size(); ++i) {
+        switch (value[i]) {
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            default:
+                escaped += value[i];
+                break;
+        }
+    }
+    return escaped;
+}
+
+static void writeFamily(ostream &output, const char *name, const char *type, const char *help) {
+    output << "# HELP " << name << " " << help << "\n"
+           << "# TYPE " << name << " " << type << "\n";
+}
+
+// Exactly, rather than through a double, which would round long enabled times at the default 6 digits.
+static void writeSeconds(ostream &output, const uint64_t micros) {
+    output << micros / 1000000;
+    uint64_t fraction = micros % 1000000;
+    if (fraction == 0) {
+        return;
+    }
+
+    int digits = 6;
+    while (fraction % 10 == 0) {
+        fraction /= 10;
+        --digits;
+    }
+    output << "." << setw(digits) << setfill('0') << fraction;
+}
+
+void writePrometheus(ostream &output, const vector<pair<string, StepperStats>> &motors) {
+    // Written through a stream of its own, so that the caller's locale or formatting can't change the numbers
+    ostringstream text;
+    text.imbue(locale::classic());
+    text << setprecision(numeric_limits<double>::max_digits10);
+
+    vector<string> labels;
+    for (size_t i = 0; i < motors.size(); ++i) {
+        labels.push_back("motor=\"" + escapeLabel(motors[i].first) + "\"");
+    }
+
+    writeFamily(text, "libstepper_steps_total", "counter", "Steps taken, by direction.");
+    for (size_t i = 0; i < motors.size(); ++i) {
+        text << "libstepper_steps_total{" << labels[i] << ",direction=\"clockwise\"} " << motors[i].second.clockwiseSteps << "\n"
+             << "libstepper_steps_total{" << labels[i] << ",direction=\"counter_clockwise\"} " << motors[i].second.counterClockwiseSteps << "\n";
+    }
+
+    writeFamily(text, "libstepper_moves_total", "counter", "Moves, by whether they ran to the end or were stopped early.");
+    for (size_t i = 0; i < motors.size(); ++i) {
+        text << "libstepper_moves_total{" << labels[i] << ",result=\"completed\"} " << motors[i].second.completedMoves << "\n"
+             << "libstepper_moves_total{" << labels[i] << ",result=\"interrupted\"} " << motors[i].second.interruptedMoves << "\n";
+    }
+
+    writeFamily(text, "libstepper_enabled_seconds_total", "counter", "Time the motor has been enabled.");
+    for (size_t i = 0; i < motors.size(); ++i) {
+        text << "libstepper_enabled_seconds_total{" << labels[i] << "} ";
+        writeSeconds(text, motors[i].second.enabledMicros);
+        text << "\n";
+    }
+
+    writeFamily(text, "libstepper_missed_deadlines_total", "counter", "Steps taken after the next step was due.");
+    for (size_t i = 0; i < motors.size(); ++i) {
+        text << "libstepper_missed_deadlines_total{" << labels[i] << "} " << motors[i].second.missedDeadlines << "\n";
+    }
+
+    writeFamily(text, "libstepper_max_lateness_seconds", "gauge", "The latest that any step has been taken.");
+    for (size_t i = 0; i < motors.size(); ++i) {
+        text << "libstepper_max_lateness_seconds{" << labels[i] << "} ";
+        writeSeconds(text, motors[i].second.maxLatenessMicros);
+        text << "\n";
+    }
+
+    writeFamily(text, "libstepper_derations_total", "counter", "Times a move was slowed down after repeatedly missing its deadlines.");
+    for (size_t i = 0; i < motors.size(); ++i) {
+        text << "libstepper_derations_total{" << labels[i] << "} " << motors[i].second.derations << "\n";
+    }
+
+    writeFamily(text, "libstepper_step_rate", "gauge", "Steps per second of the current move.");
+    for (size_t i = 0; i < motors.size(); ++i) {
+        text << "libstepper_step_rate{" << labels[i] << "} " << motors[i].second.stepsPerSecond << "\n";
+    }
+
+    output << text.str();
+}
+
+void writePrometheus(ostream &output, const string &motor, const StepperStats &stats) {
+    writePrometheus(output, vector<pair<string, StepperStats>>(1, make_pair(motor, stats)));
+}
+
+}
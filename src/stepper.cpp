@@ -5,18 +5,27 @@
 #include <stepper.hpp>
 #include <stdexcept>
 #include <exception.hpp>
-#include <chrono>
-#include <thread>
+#include <memory>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <vector>
 
-using namespace std::this_thread;
-using namespace std::chrono;
 using namespace std;
 
 #define ABS(x) (x < 0 ? -x : x)
 
 namespace libstepper {
 
-StepperDriverBuilder::StepperDriverBuilder() : coil1Terminal1(nullptr), coil2Terminal1(nullptr), coil1Terminal2(nullptr), coil2Terminal2(nullptr), stepsInRotation(0), initialRPM(0), maxSafeRPM(UINT64_MAX) {
+// step() and drive() render at most this many steps ahead, and no more than this far ahead in time.
+static const uint64_t TIMELINE_CHUNK_CAPACITY = 64;
+static const uint64_t TIMELINE_CHUNK_HORIZON_MICROS = 20000;
+// play(const TrajectoryFile &) decodes this many segments of the file at a time.
+static const size_t TRAJECTORY_WINDOW_CAPACITY = 64;
+// drive() is a move of this many steps, which never ends by itself, and never ramps down.
+static const uint64_t INDEFINITE_STEPS = UINT64_MAX;
+
+StepperDriverBuilder::StepperDriverBuilder() : enableTerminal(nullptr), coil1Terminal1(nullptr), coil2Terminal1(nullptr), coil1Terminal2(nullptr), coil2Terminal2(nullptr), waveformChain(nullptr), planCache(nullptr), follower(nullptr), clock(&SteadyClock::getInstance()), jitterHistogram(nullptr), lateStepPolicy(SHIFT_SCHEDULE), breakdown(nullptr), calibrateOnBuild(false), hasRealtimeConfig(false), stepsInRotation(0), initialRPM(0), maxSafeRPM(UINT64_MAX), acceleration(0) {
 }
 
 StepperDriverBuilder &StepperDriverBuilder::setEnableTerminal(DigitalSignalConsumer &consumer) {
@@ -44,6 +53,11 @@ StepperDriverBuilder &StepperDriverBuilder::setCoil2Terminal2(DigitalSignalConsu
     return *this;
 }
 
+StepperDriverBuilder &StepperDriverBuilder::setWaveformChain(WaveformChainConsumer &chain) {
+    waveformChain = &chain;
+    return *this;
+}
+
 StepperDriverBuilder &StepperDriverBuilder::setRotationStepCount(const uint64_t stepsInRotation) {
     if (stepsInRotation == 0) {
         throw invalid_argument("stepsInRotation must be > 0");
@@ -62,19 +76,101 @@ StepperDriverBuilder &StepperDriverBuilder::setMaxSafeRPM(const uint64_t maxSafe
     return *this;
 }
 
+StepperDriverBuilder &StepperDriverBuilder::setAcceleration(const uint64_t acceleration) {
+    this->acceleration = acceleration;
+    return *this;
+}
+
+StepperDriverBuilder &StepperDriverBuilder::setPlanCache(PlanCache &cache) {
+    planCache = &cache;
+    return *this;
+}
+
+StepperDriverBuilder &StepperDriverBuilder::setFollower(StepFollower &follower) {
+    this->follower = &follower;
+    return *this;
+}
+
+StepperDriverBuilder &StepperDriverBuilder::setClock(Clock &clock) {
+    this->clock = &clock;
+    return *this;
+}
+
+StepperDriverBuilder &StepperDriverBuilder::setJitterHistogram(LatencyHistogram &histogram) {
+    jitterHistogram = &histogram;
+    return *this;
+}
+
+StepperDriverBuilder &StepperDriverBuilder::setLateStepPolicy(const LateStepPolicy policy) {
+    if (policy != SHIFT_SCHEDULE && policy != CATCH_UP && policy != DERATE) {
+        throw invalid_argument("Unknown LateStepPolicy value");
+    }
+    lateStepPolicy = policy;
+    return *this;
+}
+
+StepperDriverBuilder &StepperDriverBuilder::setStepBreakdown(StepBreakdown &breakdown) {
+    this->breakdown = &breakdown;
+    return *this;
+}
+
+StepperDriverBuilder &StepperDriverBuilder::setCalibrateOnBuild(const bool calibrateOnBuild) {
+    this->calibrateOnBuild = calibrateOnBuild;
+    return *this;
+}
+
+StepperDriverBuilder &StepperDriverBuilder::setRealtimeConfig(const RealtimeConfig &config) {
+    config.validate();
+    realtimeConfig = config;
+    hasRealtimeConfig = true;
+    return *this;
+}
+
 StepperDriver *StepperDriverBuilder::build() const {
-    if (enableTerminal == nullptr || coil1Terminal1 == nullptr || coil2Terminal1 == nullptr || coil1Terminal2 == nullptr || coil2Terminal2 == nullptr || stepsInRotation == 0) {
-        throw IllegalStateError("Enable terminal, all 4 coil terminals should be initialized, and the stepsInRotation for the motor must be specified before the builder can build the StepperDriver.");
+    const bool hasCoilTerminals = coil1Terminal1 != nullptr && coil2Terminal1 != nullptr && coil1Terminal2 != nullptr && coil2Terminal2 != nullptr;
+    const bool hasAnyCoilTerminal = coil1Terminal1 != nullptr || coil2Terminal1 != nullptr || coil1Terminal2 != nullptr || coil2Terminal2 != nullptr;
+
+    if (enableTerminal == nullptr || (!hasCoilTerminals && waveformChain == nullptr) || stepsInRotation == 0) {
+        throw IllegalStateError("Enable terminal, all 4 coil terminals (or a waveform chain) should be initialized, and the stepsInRotation for the motor must be specified before the builder can build the StepperDriver.");
+    }
+
+    if (hasAnyCoilTerminal && waveformChain != nullptr) {
+        throw IllegalStateError("The coil terminals and the waveform chain are mutually exclusive");
     }
 
     if (initialRPM > maxSafeRPM) {
         throw IllegalStateError("initialRPM must be <= maxSafeRPM");
     }
 
-    return new StepperDriver(enableTerminal, coil1Terminal1, coil2Terminal1, coil1Terminal2, coil2Terminal2, stepsInRotation, initialRPM, maxSafeRPM);
+    if (follower != nullptr) {
+        // The chain times its batches itself, so the follower couldn't be stepped in phase with the leader.
+        if (waveformChain != nullptr) {
+            throw IllegalStateError("A follower can't be driven by a leader with a waveform chain");
+        }
+        follower->checkLeaderRate(maxSafeRPM == UINT64_MAX ? numeric_limits<double>::infinity() : (double) maxSafeRPM * (double) stepsInRotation / 60);
+    }
+
+    StepperDriver *driver = new StepperDriver(enableTerminal, coil1Terminal1, coil2Terminal1, coil1Terminal2, coil2Terminal2, stepsInRotation, initialRPM, maxSafeRPM, acceleration, waveformChain, planCache, follower, clock, jitterHistogram, lateStepPolicy, breakdown, hasRealtimeConfig ? &realtimeConfig : nullptr);
+    if (calibrateOnBuild) {
+        driver->calibrate();
+    }
+    return driver;
 }
 
 
+// The interval at the max safe RPM, rounded up so that catching up never steps faster than it. 0 if there's
+// no max safe RPM, and at least 1 otherwise.
+static uint64_t getCatchUpIntervalMicros(const uint64_t maxSafeRPM, const uint64_t stepsInRotation) {
+    if (maxSafeRPM == 0 || maxSafeRPM == UINT64_MAX) {
+        return 0;
+    }
+    if (maxSafeRPM > 60000000 / stepsInRotation) {
+        return 1;
+    }
+    const uint64_t stepsPerMinute = maxSafeRPM * stepsInRotation;
+    return (60000000 + stepsPerMinute - 1) / stepsPerMinute;
+}
+
 StepperDriver::StepperDriver(DigitalSignalConsumer *enableTerminal,
                              DigitalSignalConsumer *coil1Terminal1,
                              DigitalSignalConsumer *coil2Terminal1,
@@ -82,20 +178,57 @@ StepperDriver::StepperDriver(DigitalSignalConsumer *enableTerminal,
                              DigitalSignalConsumer *coil2Terminal2,
                              const uint64_t stepsInRotation,
                              const uint64_t initialRPM,
-                             const uint64_t maxSafeRPM) :
+                             const uint64_t maxSafeRPM,
+                             const uint64_t acceleration,
+                             WaveformChainConsumer *waveformChain,
+                             PlanCache *planCache,
+                             StepFollower *follower,
+                             Clock *clock,
+                             LatencyHistogram *jitterHistogram,
+                             const LateStepPolicy lateStepPolicy,
+                             StepBreakdown *breakdown,
+                             const RealtimeConfig *realtimeConfig) :
 
     enableTerminal(enableTerminal),
     coilTerminals { coil1Terminal1, coil2Terminal1, coil1Terminal2, coil2Terminal2 },
+    waveformChain(waveformChain),
+    planCache(planCache),
+    follower(follower),
+    clock(clock),
+    jitterHistogram(jitterHistogram),
+    lateStepPolicy(lateStepPolicy),
+    breakdown(breakdown),
+    hasRealtimeConfig(realtimeConfig != nullptr),
+    realtimeConfig(realtimeConfig == nullptr ? RealtimeConfig() : *realtimeConfig),
     stepsInRotation(stepsInRotation),
     rpm(initialRPM),
     maxSafeRPM(maxSafeRPM),
+    acceleration(acceleration),
     interrupted(false),
     nextWaveformStep(0),
-    nextRotationStep(0) {
+    writtenCoilMask(0),
+    nextRotationStep(0),
+    position(0),
+    idealStepMicros(0),
+    lastStepMicros(0),
+    catchUpIntervalMicros(getCatchUpIntervalMicros(maxSafeRPM, stepsInRotation)),
+    calibration { 0, 0 },
+    speedPercent(100),
+    consecutiveMisses(0),
+    degrees(stepsInRotation, 360) {
+    chunk.reserve(TIMELINE_CHUNK_CAPACITY);
 }
 
 StepperDriver::~StepperDriver() {
     enableTerminal->write(false);
+    if (waveformChain != nullptr) {
+        const StepEvent off = { 0, 0x00 };
+        waveformChain->begin();
+        waveformChain->write(&off, 1);
+        waveformChain->end();
+        return;
+    }
+
     for (uint8_t i = 0; i < 4; ++i) {
         coilTerminals[i]->write(false);
     }
@@ -124,6 +257,14 @@ uint64_t StepperDriver::getRPM() const {
     return rpm;
 }
 
+void StepperDriver::setAcceleration(const uint64_t acceleration) {
+    this->acceleration = acceleration;
+}
+
+uint64_t StepperDriver::getAcceleration() const {
+    return acceleration;
+}
+
 uint64_t StepperDriver::getMaxSafeRPM() const {
     return maxSafeRPM;
 }
@@ -132,60 +273,457 @@ uint64_t StepperDriver::getStepsInRotation() const {
     return stepsInRotation;
 }
 
-template <typename T>
-static void moddedStepUInt(T &num, const RotationDirection direction, const T maxValue) {
-    bool increment;
-    switch (direction) {
-        case CLOCKWISE:
-            increment = false;
-            break;
-        case COUNTER_CLOCKWISE:
-            increment = true;
-            break;
-        default:
-            throw IllegalStateError("Unknown RotationDirection value");
-            break;
+// Moves are validated with validateDirection() before their first step, so the steps themselves can't throw.
+static void validateDirection(const RotationDirection direction) {
+    if (direction != CLOCKWISE && direction != COUNTER_CLOCKWISE) {
+        throw IllegalStateError("Unknown RotationDirection value");
+    }
+}
+
+// The coil masks of the 4 full steps of the waveform, i.e. 0b1100 rotated right by the step
+static const uint8_t COIL_MASKS[4] = { 0x0C, 0x06, 0x03, 0x09 };
+
+static uint8_t getCoilMask(const uint8_t waveformStep) noexcept {
+    return COIL_MASKS[waveformStep];
+}
+
+// The direction is a template parameter, so that the render loops are specialized for it once per chunk,
+// instead of checking it on every step, and the waveform wraps around by comparison rather than by modulo.
+template <RotationDirection direction>
+static uint8_t getNextWaveformStep(const uint8_t waveformStep) noexcept {
+    if (direction == COUNTER_CLOCKWISE) {
+        return waveformStep == 3 ? 0 : (uint8_t) (waveformStep + 1);
+    }
+    return waveformStep == 0 ? 3 : (uint8_t) (waveformStep - 1);
+}
+
+// Both renderers stop early, rather than allocate, if the timeline wasn't reserved for the whole render.
+template <RotationDirection direction>
+void StepperDriver::renderProfile(StepTimeline &timeline,
+                                  const StepProfile &profile,
+                                  uint8_t waveformStep,
+                                  const uint64_t firstStep,
+                                  const uint64_t steps,
+                                  const uint64_t totalSteps,
+                                  const uint64_t horizonMicros) noexcept {
+    uint64_t timestampMicros = 0;
+    for (uint64_t i = 0; i < steps && timestampMicros < horizonMicros; ++i) {
+        timestampMicros += profile.getIntervalMicros(firstStep + i, totalSteps);
+        if (!timeline.appendInOrder(timestampMicros, getCoilMask(waveformStep))) {
+            return;
+        }
+        waveformStep = getNextWaveformStep<direction>(waveformStep);
+    }
+}
+
+template <RotationDirection direction>
+void StepperDriver::renderDecoded(StepTimeline &timeline, StepQueueDecoder &decoder, uint8_t waveformStep) {
+    uint64_t timestampMicros = 0;
+    uint64_t intervalMicros;
+    // Checked before decoding, so that a decoded step is never dropped
+    const size_t capacity = timeline.events.capacity() < TIMELINE_CHUNK_CAPACITY ? timeline.events.capacity() : TIMELINE_CHUNK_CAPACITY;
+    while (timeline.size() < capacity && timestampMicros < TIMELINE_CHUNK_HORIZON_MICROS && decoder.next(intervalMicros)) {
+        timestampMicros += intervalMicros;
+        timeline.appendInOrder(timestampMicros, getCoilMask(waveformStep));
+        waveformStep = getNextWaveformStep<direction>(waveformStep);
+    }
+}
+
+void StepperDriver::render(StepTimeline &timeline,
+                           const StepProfile &profile,
+                           const uint64_t firstStep,
+                           const uint64_t steps,
+                           const uint64_t totalSteps,
+                           const RotationDirection direction,
+                           const uint64_t horizonMicros) const {
+    timeline.reset(direction, nextWaveformStep);
+    if (direction == COUNTER_CLOCKWISE) {
+        renderProfile<COUNTER_CLOCKWISE>(timeline, profile, nextWaveformStep, firstStep, steps, totalSteps, horizonMicros);
+    } else {
+        renderProfile<CLOCKWISE>(timeline, profile, nextWaveformStep, firstStep, steps, totalSteps, horizonMicros);
+    }
+}
+
+void StepperDriver::render(StepTimeline &timeline, StepQueueDecoder &decoder, const RotationDirection direction) const {
+    timeline.reset(direction, nextWaveformStep);
+    if (direction == COUNTER_CLOCKWISE) {
+        renderDecoded<COUNTER_CLOCKWISE>(timeline, decoder, nextWaveformStep);
+    } else {
+        renderDecoded<CLOCKWISE>(timeline, decoder, nextWaveformStep);
+    }
+}
+
+size_t StepperDriver::output(const StepTimeline &timeline) {
+    if (waveformChain == nullptr) {
+        return playback(timeline);
+    }
+
+    // The chain does its own timing, so interrupts can only be honoured between batches.
+    if (isInterrupted() || !waveformChain->write(timeline.data(), timeline.size())) {
+        return 0;
+    }
+    if (!timeline.empty()) {
+        const StepEvent *events = timeline.data();
+        const size_t last = timeline.size() - 1;
+        counters.setIntervalMicros(events[last].timestampMicros - (last == 0 ? 0 : events[last - 1].timestampMicros));
+    }
+    return timeline.size();
+}
+
+size_t StepperDriver::playback(const StepTimeline &timeline) {
+    const StepEvent *events = timeline.data();
+    const size_t count = timeline.size();
+    uint64_t previousTimestampMicros = 0;
+    uint64_t nowMicros = clock->nowMicros();
+    // Without a breakdown, the phases aren't timed at all
+    uint64_t markNanos = breakdown == nullptr ? 0 : StepBreakdown::nowNanos();
+
+    for (size_t i = 0; i < count; ++i) {
+        if (isInterrupted()) {
+            return i;
+        }
+        if (breakdown != nullptr) {
+            markNanos = breakdown->addSince(STEP_PHASE_LOCK, markNanos);
+        }
+
+        // DERATE slows the move down by stretching the intervals
+        const uint64_t plannedIntervalMicros = events[i].timestampMicros - previousTimestampMicros;
+        const uint64_t intervalMicros = speedPercent == 100 ? plannedIntervalMicros : plannedIntervalMicros * 100 / speedPercent;
+        previousTimestampMicros = events[i].timestampMicros;
+        const uint64_t dueMicros = scheduleStep(intervalMicros, nowMicros);
+        // The scheduling before the sleep and the bookkeeping after the write are one phase, without the sleep
+        const uint64_t scheduleNanos = breakdown == nullptr ? 0 : StepBreakdown::nowNanos() - markNanos;
+        // Wakes up early by the calibrated sleep overshoot and write cost, so that the coils change on time
+        const uint64_t leadMicros = calibration.oversleepMicros + calibration.writeMicros;
+        if (dueMicros > nowMicros + leadMicros) {
+            clock->sleepForMicros(dueMicros - nowMicros - leadMicros);
+            if (breakdown != nullptr) {
+                const uint64_t wokenMicros = clock->nowMicros();
+                breakdown->add(STEP_PHASE_OVERSLEEP, wokenMicros > dueMicros ? (wokenMicros - dueMicros) * 1000 : 0);
+            }
+        }
+        if (breakdown != nullptr) {
+            markNanos = StepBreakdown::nowNanos();
+        }
+        writeCoils(events[i].coilMask);
+        if (breakdown != nullptr) {
+            markNanos = breakdown->addSince(STEP_PHASE_WRITE, markNanos);
+        }
+
+        nowMicros = clock->nowMicros();
+        completeStep(intervalMicros, nowMicros);
+        if (follower != nullptr) {
+            follower->onLeaderStep(timeline.getDirection());
+        }
+        if (breakdown != nullptr) {
+            markNanos = breakdown->addSince(STEP_PHASE_SCHEDULE, markNanos - scheduleNanos);
+        }
+    }
+
+    return count;
+}
+
+uint64_t StepperDriver::scheduleStep(const uint64_t intervalMicros, const uint64_t nowMicros) noexcept {
+    idealStepMicros += intervalMicros;
+    if (lateStepPolicy != CATCH_UP) {
+        return idealStepMicros;
+    }
+
+    // Drops whatever is more than a burst behind, and takes the rest of the burst no faster than allowed.
+    const uint64_t maxLagMicros = LATE_STEP_MAX_BURST * intervalMicros;
+    if (nowMicros > idealStepMicros + maxLagMicros) {
+        idealStepMicros = nowMicros - maxLagMicros;
+    }
+    const uint64_t earliestMicros = lastStepMicros + catchUpIntervalMicros;
+    return idealStepMicros > earliestMicros ? idealStepMicros : earliestMicros;
+}
+
+void StepperDriver::completeStep(const uint64_t intervalMicros, const uint64_t nowMicros) noexcept {
+    // Against the schedule, rather than when the step was allowed, so steps held back while catching up count as late
+    const uint64_t latenessMicros = nowMicros > idealStepMicros ? nowMicros - idealStepMicros : 0;
+    const bool missed = latenessMicros > intervalMicros;
+    counters.addScheduledStep(intervalMicros, latenessMicros);
+    if (jitterHistogram != nullptr) {
+        jitterHistogram->record(latenessMicros);
+    }
+    lastStepMicros = nowMicros;
+
+    if (!missed) {
+        consecutiveMisses = 0;
+        return;
     }
 
-    if (increment) {
-        num = (num + 1) % maxValue;
-    } else if (num == 0) {
-        num = maxValue - 1;
+    // The policy was validated by the builder, so there's nothing to throw for here
+    if (lateStepPolicy == CATCH_UP) {
+        return;
+    }
+    idealStepMicros = nowMicros;
+    if (lateStepPolicy == DERATE && ++consecutiveMisses >= LATE_STEP_DERATE_MISSES && speedPercent > LATE_STEP_MIN_SPEED_PERCENT) {
+        speedPercent = speedPercent * 3 / 4 < LATE_STEP_MIN_SPEED_PERCENT ? LATE_STEP_MIN_SPEED_PERCENT : speedPercent * 3 / 4;
+        consecutiveMisses = 0;
+        counters.addDeration();
+    }
+}
+
+void StepperDriver::writeCoils(const uint8_t coilMask) {
+    for (uint8_t i = 0; i < 4; ++i) {
+        coilTerminals[i]->write(coilMask & (0x08 /*0b00001000*/ >> i));
+    }
+    writtenCoilMask = coilMask;
+}
+
+void StepperDriver::pulse(const RotationDirection direction) {
+    const uint8_t coilMask = getCoilMask(nextWaveformStep);
+    if (waveformChain != nullptr) {
+        const StepEvent event = { 0, coilMask };
+        waveformChain->write(&event, 1);
     } else {
-        num = num - 1;
+        writeCoils(coilMask);
+    }
+    advancePosition(1, direction);
+    if (follower != nullptr) {
+        follower->onLeaderStep(direction);
     }
+
+    // Pulsed drivers follow someone else's schedule, so only their rate is tracked, from the last pulse.
+    const uint64_t nowMicros = clock->nowMicros();
+    counters.setIntervalMicros(nowMicros - lastStepMicros);
+    lastStepMicros = nowMicros;
+}
+
+void StepperDriver::advancePosition(const uint64_t steps, const RotationDirection direction) noexcept {
+    const uint8_t waveformSteps = (uint8_t) (steps & 0x03);
+    // Moves advance a chunk at a time, which is nearly always less than a turn, so the modulo is rarely needed
+    const uint64_t rotationSteps = steps < stepsInRotation ? steps : steps % stepsInRotation;
+
+    if (direction == COUNTER_CLOCKWISE) {
+        nextWaveformStep = (uint8_t) ((nextWaveformStep + waveformSteps) & 0x03);
+        nextRotationStep += rotationSteps;
+        if (nextRotationStep >= stepsInRotation) {
+            nextRotationStep -= stepsInRotation;
+        }
+        position += (int64_t) steps;
+    } else {
+        nextWaveformStep = (uint8_t) ((nextWaveformStep + 4 - waveformSteps) & 0x03);
+        nextRotationStep = nextRotationStep >= rotationSteps ? nextRotationStep - rotationSteps : nextRotationStep + stepsInRotation - rotationSteps;
+        position -= (int64_t) steps;
+    }
+    counters.addSteps(steps, direction);
 }
 
 bool StepperDriver::driveWaveform(const uint64_t steps, const RotationDirection direction) {
-    static const uint8_t baseWaveform = 0x0C; // == 0b00001100
+    uint64_t done = 0;
 
-    for (uint64_t i = 0; i < steps; ++i) {
-        if (isInterrupted() || !adjustSpeed()) {
+    while (steps == INDEFINITE_STEPS || done < steps) {
+        // Read once, so that a concurrent setRPM(0) can't slip in between the check and the profile
+        const uint64_t currentRPM = rpm;
+        if (currentRPM == 0) {
             return false;
         }
 
-        // Do a right bit shift by "nextWaveformStep" steps on "baseWaveform", wrapping around only on the last 4 bits.
-        const uint8_t valueToBeWritten = (baseWaveform >> nextWaveformStep) | (((baseWaveform << (8 - nextWaveformStep)) & 0xF0) >> 4);
+        // The move is planned one short chunk at a time, so that setRPM() still takes effect mid-move.
+        const uint64_t remaining = steps - done;
+        const uint64_t renderNanos = breakdown == nullptr ? 0 : StepBreakdown::nowNanos();
+        render(chunk, getProfile(currentRPM), done + 1, remaining < TIMELINE_CHUNK_CAPACITY ? remaining : TIMELINE_CHUNK_CAPACITY, steps, direction, TIMELINE_CHUNK_HORIZON_MICROS);
+        if (breakdown != nullptr) {
+            breakdown->addSince(STEP_PHASE_RENDER, renderNanos);
+        }
+        const size_t played = output(chunk);
+        advancePosition(played, direction);
 
-        for (uint8_t i = 0; i < 4; ++i) {
-            coilTerminals[i]->write(valueToBeWritten & (0x08 /*0b00001000*/ >> i));
+        if (played < chunk.size()) {
+            return false;
         }
 
-        moddedStepUInt(nextWaveformStep, direction, (uint8_t)4);
-        moddedStepUInt(nextRotationStep, direction, stepsInRotation);
+        done += played;
     }
 
     return true;
 }
 
-bool StepperDriver::step(const uint64_t steps, const RotationDirection direction) {
+StepTimeline StepperDriver::plan(const uint64_t steps, const RotationDirection direction) const {
+    validateDirection(direction);
+    const uint64_t currentRPM = rpm;
+    if (currentRPM == 0) {
+        throw IllegalStateError("Cannot plan a move while the RPM is 0");
+    }
+
+    StepTimeline timeline;
+    timeline.reserve(steps);
+    render(timeline, getProfile(currentRPM), 1, steps, steps, direction, UINT64_MAX);
+    return timeline;
+}
+
+StepQueue StepperDriver::compile(const uint64_t steps, const RotationDirection direction, const uint32_t maxErrorMicros) const {
+    validateDirection(direction);
+    const uint64_t currentRPM = rpm;
+    if (currentRPM == 0) {
+        throw IllegalStateError("Cannot compile a move while the RPM is 0");
+    }
+    return compile(steps, direction, currentRPM, maxErrorMicros);
+}
+
+StepQueue StepperDriver::compile(const uint64_t steps,
+                                 const RotationDirection direction,
+                                 const uint64_t currentRPM,
+                                 const uint32_t maxErrorMicros) const {
+    const StepProfile profile = getProfile(currentRPM);
+    StepQueue queue(direction);
+    StepQueueEncoder encoder(queue, maxErrorMicros);
+    for (uint64_t i = 1; i <= steps; ++i) {
+        encoder.push(profile.getIntervalMicros(i, steps));
+    }
+    encoder.flush();
+    return queue;
+}
+
+bool StepperDriver::playSegments(const StepSegment *segments, const size_t count, const RotationDirection direction, uint64_t &waitMicros) {
+    StepQueueDecoder decoder(segments, count, waitMicros);
+
+    while (true) {
+        const uint64_t renderNanos = breakdown == nullptr ? 0 : StepBreakdown::nowNanos();
+        render(chunk, decoder, direction);
+        if (breakdown != nullptr) {
+            breakdown->addSince(STEP_PHASE_RENDER, renderNanos);
+        }
+        if (chunk.empty()) {
+            waitMicros = decoder.getWaitMicros();
+            return true;
+        }
+        const size_t played = output(chunk);
+        advancePosition(played, direction);
+        if (played < chunk.size()) {
+            return false;
+        }
+    }
+}
+
+bool StepperDriver::play(const StepQueue &queue) {
+    validateDirection(queue.getDirection());
+    startMove();
+    uint64_t waitMicros = 0;
+    const bool completed = playSegments(queue.data(), queue.size(), queue.getDirection(), waitMicros);
+    finishMove();
+    counters.addMove(completed);
+    return completed;
+}
+
+bool StepperDriver::play(const TrajectoryFile &trajectory) {
+    if (trajectory.getStepsInRotation() != stepsInRotation) {
+        throw IllegalStateError("The trajectory was planned for a motor with " + to_string(trajectory.getStepsInRotation()) + " steps in a rotation");
+    }
+    if (trajectory.getWaveformMode() != TRAJECTORY_WAVEFORM_FULL_STEP) {
+        throw IllegalStateError("The trajectory was planned for an unsupported waveform mode");
+    }
+
+    // Only a small window of the file is decoded at a time, so memory use doesn't grow with the job.
+    StepSegment segments[TRAJECTORY_WINDOW_CAPACITY];
+    uint64_t next = 0;
+    // A window can end with the waits before the next window's first step
+    uint64_t waitMicros = 0;
+    bool completed = true;
+
+    startMove();
+    try {
+        while (completed && next < trajectory.getSegmentCount()) {
+            RotationDirection direction = CLOCKWISE;
+            const size_t count = trajectory.read(next, segments, TRAJECTORY_WINDOW_CAPACITY, direction);
+            validateDirection(direction);
+            completed = playSegments(segments, count, direction, waitMicros);
+            next += count;
+        }
+    } catch (...) {
+        // A corrupt window is only found once the move is underway, so the motor is released before rethrowing.
+        finishMove();
+        counters.addMove(false);
+        throw;
+    }
+    finishMove();
+    counters.addMove(completed);
+    return completed;
+}
+
+bool StepperDriver::play(const StepTimeline &timeline) {
+    validateDirection(timeline.getDirection());
+    if (timeline.getStartWaveformStep() != nextWaveformStep) {
+        throw IllegalStateError("The timeline was planned from a different position than the current one");
+    }
+
+    startMove();
+    const size_t played = output(timeline);
+    advancePosition(played, timeline.getDirection());
+    finishMove();
+    const bool completed = played == timeline.size();
+    counters.addMove(completed);
+    return completed;
+}
+
+void StepperDriver::startMove() {
+    if (hasRealtimeConfig && this_thread::get_id() != realtimeThread) {
+        realtimeStatus = applyRealtimeConfig(realtimeConfig);
+        realtimeThread = this_thread::get_id();
+    }
     {
         unique_lock<mutex> lock(interruptMutex);
         interrupted = false;
     }
     enableTerminal->write(true);
-    const bool completed = driveWaveform(steps, direction);
+    if (waveformChain != nullptr) {
+        waveformChain->begin();
+    }
+    idealStepMicros = clock->nowMicros();
+    lastStepMicros = idealStepMicros;
+    speedPercent = 100;
+    consecutiveMisses = 0;
+    counters.setEnabled(true, idealStepMicros);
+    if (follower != nullptr) {
+        follower->start();
+    }
+}
+
+void StepperDriver::finishMove() {
+    if (follower != nullptr) {
+        follower->finish();
+    }
+    if (waveformChain != nullptr) {
+        waveformChain->end();
+    }
     enableTerminal->write(false);
+    counters.setEnabled(false, clock->nowMicros());
+}
+
+shared_ptr<const StepQueue> StepperDriver::findCachedPlan(const uint64_t steps, const RotationDirection direction) {
+    // Read once, so that the cached plan is always the one for the RPM in its key
+    const uint64_t currentRPM = rpm;
+    if (currentRPM == 0) {
+        return nullptr;
+    }
+
+    const PlanKey key = { steps, currentRPM, acceleration, stepsInRotation };
+    shared_ptr<const StepQueue> plan = planCache->find(key);
+    if (!plan) {
+        plan = make_shared<const StepQueue>(compile(steps, direction, currentRPM, 0));
+        planCache->insert(key, plan);
+    }
+    return plan;
+}
+
+bool StepperDriver::step(const uint64_t steps, const RotationDirection direction) {
+    validateDirection(direction);
+    // A cache miss compiles the plan before the move starts, so that the move itself never allocates
+    const shared_ptr<const StepQueue> plan = planCache == nullptr ? nullptr : findCachedPlan(steps, direction);
+
+    startMove();
+    bool completed = false;
+    if (planCache == nullptr) {
+        completed = driveWaveform(steps, direction);
+    } else if (plan) {
+        // Cached plans are direction independent, so their own direction is ignored.
+        uint64_t waitMicros = 0;
+        completed = playSegments(plan->data(), plan->size(), direction, waitMicros);
+    }
+    finishMove();
+    counters.addMove(completed);
     return completed;
 }
 
@@ -194,59 +732,111 @@ double StepperDriver::getPositionInDegrees() const {
 }
 
 bool StepperDriver::rotateBy(const double angleInDegrees, const RotationDirection direction) {
-    const int64_t steps = (int64_t) (angleInDegrees * stepsInRotation)/360;
+    int64_t fixedAngle = UnitConverter::toFixed(angleInDegrees);
 
-    RotationDirection correctedDirection = direction;
+    switch (direction) {
+        case CLOCKWISE:
+            fixedAngle = -fixedAngle;
+            break;
+        case COUNTER_CLOCKWISE:
+            break;
+        default:
+            throw IllegalStateError("Unknown RotationDirection value");
+            break;
+    }
 
-    if (steps < 0) {
-        switch (direction) {
-            case CLOCKWISE:
-                correctedDirection = COUNTER_CLOCKWISE;
-                break;
-            case COUNTER_CLOCKWISE:
-                correctedDirection = CLOCKWISE;
-                break;
-            default:
-                throw IllegalStateError("Unknown RotationDirection value");
-                break;
+    // The fractional step is carried over to the next rotateBy(), so that small rotations add up instead of
+    // being truncated away one at a time.
+    const int64_t steps = degrees.toSteps(fixedAngle);
+    return step((uint64_t) ABS(steps), steps < 0 ? CLOCKWISE : COUNTER_CLOCKWISE);
+}
+
+TimingCalibration StepperDriver::calibrate(const size_t samples) {
+    if (samples == 0) {
+        throw invalid_argument("samples must be > 0");
+    }
+
+    // Rewriting the mask last written (nextWaveformStep is the step after it) doesn't move the motor. Chains
+    // are timed by their backend instead.
+    TimingCalibration measured = { 0, 0 };
+    if (waveformChain == nullptr) {
+        const uint8_t lastCoilMask = writtenCoilMask;
+        const uint64_t startMicros = clock->nowMicros();
+        for (size_t i = 0; i < samples; ++i) {
+            writeCoils(lastCoilMask);
         }
+        measured.writeMicros = (clock->nowMicros() - startMicros) / samples;
+    }
+
+    // The median, so that a single preempted sleep doesn't skew it
+    vector<uint64_t> oversleeps(samples);
+    for (size_t i = 0; i < samples; ++i) {
+        const uint64_t startMicros = clock->nowMicros();
+        clock->sleepForMicros(CALIBRATION_SLEEP_MICROS);
+        const uint64_t sleptMicros = clock->nowMicros() - startMicros;
+        oversleeps[i] = sleptMicros > CALIBRATION_SLEEP_MICROS ? sleptMicros - CALIBRATION_SLEEP_MICROS : 0;
     }
+    nth_element(oversleeps.begin(), oversleeps.begin() + (ptrdiff_t) (samples / 2), oversleeps.end());
+    measured.oversleepMicros = oversleeps[samples / 2];
 
-    return step((uint64_t) ABS(steps), correctedDirection);
+    calibration = measured;
+    return measured;
 }
 
-/*
-    Let the delay be x us; stepsInRotation = s
+void StepperDriver::setCalibration(const TimingCalibration &calibration) {
+    this->calibration = calibration;
+}
 
-    s steps == 360 degrees. Therefore, => 1 step == 360/s degrees ... (1)
+TimingCalibration StepperDriver::getCalibration() const {
+    return calibration;
+}
 
-    1 step takes x us. Therefore, by (1), 360/s degrees take x us.
-    Therefore, angular velocity
-        = 360/(sx) degrees/us
-        == 1/(sx) rotations/us
-        == (10^6) * 60/(sx) RPM
+RealtimeStatus StepperDriver::getRealtimeStatus() const {
+    return realtimeStatus;
+}
 
-    Therefore, rpm = 60 * 1000 * 1000/(sx)
-        => x = 60'000'000/(rpm*s)
-*/
+StepperStats StepperDriver::getStats() const {
+    return counters.getSnapshot(clock->nowMicros());
+}
 
-bool StepperDriver::adjustSpeed() {
-    if (rpm == 0) {
-        return false;
-    }
-    sleep_for(microseconds((60000000/(rpm * stepsInRotation))));
-    return true;
+int64_t StepperDriver::getPosition() const {
+    return position;
 }
 
-void StepperDriver::drive(const RotationDirection direction) {
-    {
-        unique_lock<mutex> lock(interruptMutex);
-        interrupted = false;
+bool StepperDriver::moveTo(const int64_t absoluteSteps) {
+    const int64_t steps = absoluteSteps - position;
+    return step((uint64_t) ABS(steps), steps < 0 ? CLOCKWISE : COUNTER_CLOCKWISE);
+}
+
+bool StepperDriver::moveToAngle(const double angleInDegrees) {
+    const int64_t rotation = (int64_t) stepsInRotation;
+    int64_t target = (int64_t) llround(fmod(angleInDegrees, 360.0) * (double) rotation / 360) % rotation;
+    if (target < 0) {
+        target += rotation;
     }
-    enableTerminal->write(true);
-    while (driveWaveform(1, direction)) {
+
+    // Wrapped into (-rotation / 2, rotation / 2], the shorter way around
+    int64_t steps = target - (int64_t) nextRotationStep;
+    if (steps > rotation / 2) {
+        steps -= rotation;
+    } else if (steps <= -(rotation - rotation / 2)) {
+        steps += rotation;
     }
-    enableTerminal->write(false);
+
+    return step((uint64_t) ABS(steps), steps < 0 ? CLOCKWISE : COUNTER_CLOCKWISE);
+}
+
+StepProfile StepperDriver::getProfile(const uint64_t currentRPM) const {
+    return StepProfile(stepsInRotation, currentRPM, acceleration);
+}
+
+void StepperDriver::drive(const RotationDirection direction) {
+    validateDirection(direction);
+    startMove();
+    driveWaveform(INDEFINITE_STEPS, direction);
+    finishMove();
+    // drive() only ever stops early
+    counters.addMove(false);
 }
 
 }
\ No newline at end of file
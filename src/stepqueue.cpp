@@ -0,0 +1,182 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <stepqueue.hpp>
+#include <stdexcept>
+#include <algorithm>
+
+using namespace std;
+
+namespace libstepper {
+
+StepQueue::StepQueue() : direction(CLOCKWISE), stepCount(0) {
+}
+
+StepQueue::StepQueue(const RotationDirection direction) : direction(direction), stepCount(0) {
+}
+
+void StepQueue::append(const StepSegment &segment) {
+    if (segment.count == 0 && segment.interval == 0) {
+        return;
+    }
+    segments.push_back(segment);
+    stepCount += segment.count;
+}
+
+size_t StepQueue::size() const {
+    return segments.size();
+}
+
+bool StepQueue::empty() const {
+    return segments.empty();
+}
+
+const StepSegment &StepQueue::operator[](const size_t index) const {
+    return segments[index];
+}
+
+const StepSegment *StepQueue::data() const {
+    return segments.data();
+}
+
+RotationDirection StepQueue::getDirection() const {
+    return direction;
+}
+
+uint64_t StepQueue::getStepCount() const {
+    return stepCount;
+}
+
+StepQueueEncoder::StepQueueEncoder(StepQueue &queue, const uint32_t maxErrorMicros) :
+    queue(queue),
+    maxErrorMicros(maxErrorMicros),
+    actualMicros(0),
+    segmentStartMicros(0),
+    pendingElapsedMicros(0) {
+    pending.interval = 0;
+    pending.count = 0;
+    pending.add = 0;
+}
+
+void StepQueueEncoder::start(const int64_t intervalMicros) {
+    // With a non-zero maxErrorMicros the previous segment may have ended a little after this step is due.
+    const int64_t interval = intervalMicros < 0 ? 0 : intervalMicros;
+    if (interval > (int64_t) UINT32_MAX) {
+        throw invalid_argument("Step intervals must fit in 32 bits");
+    }
+
+    pending.interval = (uint32_t) interval;
+    pending.count = 1;
+    pending.add = 0;
+    pendingElapsedMicros = interval;
+}
+
+void StepQueueEncoder::push(const uint64_t intervalMicros) {
+    if (intervalMicros > UINT32_MAX) {
+        // Too long for one segment, so the step waits out the excess in wait segments first
+        flush();
+        actualMicros += (int64_t) intervalMicros;
+        while (actualMicros - segmentStartMicros > (int64_t) UINT32_MAX) {
+            const int64_t wait = min(actualMicros - segmentStartMicros - (int64_t) UINT32_MAX, (int64_t) UINT32_MAX);
+            queue.append(StepSegment { (uint32_t) wait, 0, 0 });
+            segmentStartMicros += wait;
+        }
+        start(actualMicros - segmentStartMicros);
+        return;
+    }
+    actualMicros += (int64_t) intervalMicros;
+    const int64_t sinceSegmentStart = actualMicros - segmentStartMicros;
+
+    if (pending.count == 0) {
+        start(sinceSegmentStart);
+        return;
+    }
+
+    if (pending.count < UINT32_MAX) {
+        if (pending.count == 1) {
+            // Two steps always fit exactly, and fix the add for the rest of the segment. That is, unless the
+            // previous segment ended late enough for this step's interval to be negative, which the segment can't
+            // encode, so it's started over instead (and clamped to 0).
+            const int64_t add = (sinceSegmentStart - pendingElapsedMicros) - (int64_t) pending.interval;
+            if (add >= INT32_MIN && add <= INT32_MAX && (int64_t) pending.interval + add >= 0) {
+                pending.add = (int32_t) add;
+                pending.count = 2;
+                pendingElapsedMicros = sinceSegmentStart;
+                return;
+            }
+        } else {
+            const int64_t nextInterval = (int64_t) pending.interval + (int64_t) pending.count * (int64_t) pending.add;
+            const int64_t error = pendingElapsedMicros + nextInterval - sinceSegmentStart;
+            if (nextInterval >= 0 && nextInterval <= (int64_t) UINT32_MAX && error <= maxErrorMicros && -error <= maxErrorMicros) {
+                ++pending.count;
+                pendingElapsedMicros += nextInterval;
+                return;
+            }
+        }
+    }
+
+    flush();
+    start(actualMicros - segmentStartMicros);
+}
+
+void StepQueueEncoder::flush() {
+    if (pending.count == 0) {
+        return;
+    }
+    queue.append(pending);
+    segmentStartMicros += pendingElapsedMicros;
+    pendingElapsedMicros = 0;
+    pending.count = 0;
+}
+
+StepQueueDecoder::StepQueueDecoder(const StepSegment *segments, const size_t count, const uint64_t waitMicros) :
+    segment(segments),
+    end(segments + count),
+    remaining(0),
+    interval(0),
+    add(0),
+    waitMicros(waitMicros) {
+}
+
+bool StepQueueDecoder::next(uint64_t &intervalMicros) {
+    while (remaining == 0) {
+        if (segment == end) {
+            return false;
+        }
+        if (segment->count == 0) {
+            waitMicros += segment->interval;
+            ++segment;
+            continue;
+        }
+        add = segment->add;
+        interval = (int64_t) segment->interval - add;
+        remaining = segment->count;
+        ++segment;
+    }
+
+    interval += add;
+    --remaining;
+    intervalMicros = waitMicros + (uint64_t) interval;
+    waitMicros = 0;
+    return true;
+}
+
+uint64_t StepQueueDecoder::getWaitMicros() const {
+    return waitMicros;
+}
+
+StepQueue encode(const StepTimeline &timeline, const uint32_t maxErrorMicros) {
+    StepQueue queue(timeline.getDirection());
+    StepQueueEncoder encoder(queue, maxErrorMicros);
+    uint64_t previousTimestampMicros = 0;
+
+    for (size_t i = 0; i < timeline.size(); ++i) {
+        encoder.push(timeline[i].timestampMicros - previousTimestampMicros);
+        previousTimestampMicros = timeline[i].timestampMicros;
+    }
+    encoder.flush();
+    return queue;
+}
+
+}
@@ -0,0 +1,78 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <timeline.hpp>
+#include <stdexcept>
+
+using namespace std;
+
+namespace libstepper {
+
+StepTimeline::StepTimeline() : direction(CLOCKWISE), startWaveformStep(0) {
+}
+
+StepTimeline::StepTimeline(const RotationDirection direction, const uint8_t startWaveformStep) : direction(direction), startWaveformStep(startWaveformStep) {
+}
+
+void StepTimeline::reset(const RotationDirection direction, const uint8_t startWaveformStep) {
+    // clear() keeps the capacity, so a reused timeline doesn't reallocate once it has grown.
+    events.clear();
+    this->direction = direction;
+    this->startWaveformStep = startWaveformStep;
+}
+
+void StepTimeline::reserve(const size_t capacity) {
+    events.reserve(capacity);
+}
+
+void StepTimeline::append(const uint64_t timestampMicros, const uint8_t coilMask) {
+    if (!events.empty() && timestampMicros < events.back().timestampMicros) {
+        throw invalid_argument("StepEvent timestamps must be non-decreasing");
+    }
+    StepEvent event;
+    event.timestampMicros = timestampMicros;
+    event.coilMask = coilMask & 0x0F;
+    events.push_back(event);
+}
+
+bool StepTimeline::appendInOrder(const uint64_t timestampMicros, const uint8_t coilMask) noexcept {
+    if (events.size() == events.capacity()) {
+        return false;
+    }
+    StepEvent event;
+    event.timestampMicros = timestampMicros;
+    event.coilMask = coilMask & 0x0F;
+    events.push_back(event);
+    return true;
+}
+
+size_t StepTimeline::size() const {
+    return events.size();
+}
+
+bool StepTimeline::empty() const {
+    return events.empty();
+}
+
+const StepEvent &StepTimeline::operator[](const size_t index) const {
+    return events[index];
+}
+
+const StepEvent *StepTimeline::data() const {
+    return events.data();
+}
+
+RotationDirection StepTimeline::getDirection() const {
+    return direction;
+}
+
+uint8_t StepTimeline::getStartWaveformStep() const {
+    return startWaveformStep;
+}
+
+uint64_t StepTimeline::getDurationMicros() const {
+    return events.empty() ? 0 : events.back().timestampMicros;
+}
+
+}
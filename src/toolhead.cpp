@@ -0,0 +1,148 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <toolhead.hpp>
+#include <interpolator.hpp>
+#include <stdexcept>
+#include <cmath>
+
+using namespace std;
+
+namespace libstepper {
+
+ToolheadController::ToolheadController(MultiAxisController &controller, const Kinematics &kinematics, const double segmentsPerSecond)
+    : controller(controller),
+      kinematics(kinematics),
+      segmentsPerSecond(segmentsPerSecond),
+      motorSteps(kinematics.getMotorCount(), 0),
+      targetSteps(kinematics.getMotorCount(), 0),
+      deltas(kinematics.getMotorCount(), 0),
+      startSteps(kinematics.getMotorCount(), 0),
+      segmentCount(0) {
+    if (controller.getAxisCount() != kinematics.getMotorCount()) {
+        throw invalid_argument("The controller needs an axis for every motor");
+    }
+    if (!(segmentsPerSecond > 0)) {
+        throw invalid_argument("The segment rate must be positive");
+    }
+    setPosition(0, 0, 0);
+}
+
+void ToolheadController::setPosition(const double x, const double y, const double z) {
+    const double target[] = { x, y, z };
+    kinematics.toMotorSteps(target, motorSteps.data());
+    for (size_t i = 0; i < KINEMATICS_COORDINATES; ++i) {
+        position[i] = target[i];
+    }
+}
+
+double ToolheadController::getPosition(const size_t coordinate) const {
+    if (coordinate >= KINEMATICS_COORDINATES) {
+        throw out_of_range("No such coordinate");
+    }
+    return position[coordinate];
+}
+
+uint64_t ToolheadController::getSegmentCount() const {
+    return segmentCount;
+}
+
+bool ToolheadController::moveTo(const double x, const double y, const double z, const double speed) {
+    if (!(speed > 0)) {
+        return false;
+    }
+
+    const double target[] = { x, y, z };
+    double start[KINEMATICS_COORDINATES];
+    double lengthSquared = 0;
+    for (size_t i = 0; i < KINEMATICS_COORDINATES; ++i) {
+        start[i] = position[i];
+        lengthSquared += (target[i] - start[i]) * (target[i] - start[i]);
+    }
+
+    // Fails early if the target itself is out of reach
+    kinematics.toMotorSteps(target, targetSteps.data());
+
+    const double length = sqrt(lengthSquared);
+    if (length == 0) {
+        return true;
+    }
+    const uint64_t segments = kinematics.isLinear() ? 1 : max((uint64_t) 1, (uint64_t) ceil(length / speed * segmentsPerSecond));
+
+    // The segments run back to back on the controller's clock, without stopping in between.
+    const bool ownsSession = !controller.hasBegun();
+    if (ownsSession) {
+        controller.begin();
+    }
+
+    bool completed = true;
+    try {
+        double point[KINEMATICS_COORDINATES];
+        for (uint64_t segment = 1; completed && segment <= segments; ++segment) {
+            const double fraction = (double) segment / (double) segments;
+            for (size_t i = 0; i < KINEMATICS_COORDINATES; ++i) {
+                point[i] = segment == segments ? target[i] : start[i] + (target[i] - start[i]) * fraction;
+            }
+            completed = moveSegment(point, length / (double) segments, speed);
+        }
+    } catch (...) {
+        if (ownsSession) {
+            controller.end();
+        }
+        throw;
+    }
+
+    if (ownsSession) {
+        controller.end();
+    }
+    return completed;
+}
+
+bool ToolheadController::moveSegment(const double *target, const double length, const double speed) {
+    kinematics.toMotorSteps(target, targetSteps.data());
+
+    uint64_t tickCount = 0;
+    for (size_t i = 0; i < deltas.size(); ++i) {
+        deltas[i] = targetSteps[i] - motorSteps[i];
+        tickCount = max(tickCount, (uint64_t) (deltas[i] < 0 ? -deltas[i] : deltas[i]));
+    }
+    ++segmentCount;
+
+    // Where the motors were, to work out how far they got if the segment is interrupted
+    for (size_t i = 0; i < deltas.size(); ++i) {
+        startSteps[i] = controller.getAxis(i).getPosition();
+    }
+
+    bool completed;
+    if (tickCount == 0) {
+        // The toolhead still takes the segment's time, even if no motor steps
+        completed = controller.dwell((uint64_t) llround(length / speed * 1000000));
+    } else {
+        LinearInterpolator interpolator(deltas);
+        PathProfile profile;
+        profile.length = length;
+        profile.distancePerTick = length / (double) tickCount;
+        profile.entrySpeed = 0;
+        profile.cruiseSpeed = speed;
+        profile.exitSpeed = 0;
+        profile.acceleration = 0;
+        completed = controller.run(interpolator, profile);
+    }
+
+    if (completed) {
+        motorSteps.swap(targetSteps);
+        for (size_t i = 0; i < KINEMATICS_COORDINATES; ++i) {
+            position[i] = target[i];
+        }
+    } else {
+        // The toolhead is somewhere along the segment, wherever the motors stopped
+        for (size_t i = 0; i < deltas.size(); ++i) {
+            motorSteps[i] += controller.getAxis(i).getPosition() - startSteps[i];
+        }
+        kinematics.toPosition(motorSteps.data(), position);
+    }
+    return completed;
+}
+
+}
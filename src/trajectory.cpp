@@ -0,0 +1,226 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <trajectory.hpp>
+#include <exception.hpp>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace libstepper {
+
+static const char TRAJECTORY_MAGIC[4] = { 'L', 'S', 'T', 'J' };
+
+static uint64_t readLittleEndian(const uint8_t *bytes, const size_t width) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < width; ++i) {
+        value |= ((uint64_t) bytes[i]) << (8 * i);
+    }
+    return value;
+}
+
+static void writeLittleEndian(uint8_t *bytes, const uint64_t value, const size_t width) {
+    for (size_t i = 0; i < width; ++i) {
+        bytes[i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+TrajectoryFile::TrajectoryFile(const string &path) : data(nullptr), size(0) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw IOError("Could not open " + path + ": " + strerror(errno));
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        const int error = errno;
+        ::close(fd);
+        throw IOError("Could not stat " + path + ": " + strerror(error));
+    }
+
+    if ((size_t) info.st_size < TRAJECTORY_HEADER_SIZE) {
+        ::close(fd);
+        throw FormatError(path + " is too short to be a trajectory file");
+    }
+
+    void *mapped = mmap(nullptr, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    const int error = errno;
+    // The mapping stays valid after the descriptor is closed.
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        throw IOError("Could not map " + path + ": " + strerror(error));
+    }
+
+    data = (const uint8_t *) mapped;
+    size = (size_t) info.st_size;
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    if (memcmp(data, TRAJECTORY_MAGIC, sizeof(TRAJECTORY_MAGIC)) != 0) {
+        munmap(mapped, size);
+        throw FormatError(path + " is not a trajectory file");
+    }
+
+    const uint16_t version = getVersion();
+    if (version != TRAJECTORY_VERSION) {
+        munmap(mapped, size);
+        throw FormatError(path + " has an unsupported trajectory file version " + to_string(version));
+    }
+
+    stepsInRotation = readLittleEndian(data + 8, 8);
+    segmentCount = readLittleEndian(data + 16, 8);
+    stepCount = readLittleEndian(data + 24, 8);
+
+    if (segmentCount > (size - TRAJECTORY_HEADER_SIZE) / TRAJECTORY_SEGMENT_SIZE) {
+        munmap(mapped, size);
+        throw FormatError(path + " is truncated");
+    }
+
+    // A corrupt segment would otherwise only be found halfway through playing the job, with the motor moving.
+    uint64_t segmentSteps = 0;
+    for (uint64_t i = 0; i < segmentCount; ++i) {
+        const uint8_t *record = data + TRAJECTORY_HEADER_SIZE + i * TRAJECTORY_SEGMENT_SIZE;
+        const int64_t interval = (int64_t) readLittleEndian(record, 4);
+        const uint64_t count = readLittleEndian(record + 4, 4);
+        const int64_t add = (int32_t) (uint32_t) readLittleEndian(record + 8, 4);
+
+        // The intervals change linearly, so the last one is the smallest if any are negative
+        if (count > 0 && interval + (int64_t) (count - 1) * add < 0) {
+            munmap(mapped, size);
+            throw FormatError(path + " has negative step intervals in segment " + to_string(i));
+        }
+        segmentSteps += count;
+    }
+    if (segmentSteps != stepCount) {
+        munmap(mapped, size);
+        throw FormatError(path + " has " + to_string(segmentSteps) + " steps in its segments, but " + to_string(stepCount) + " in its header");
+    }
+}
+
+TrajectoryFile::~TrajectoryFile() {
+    munmap((void *) data, size);
+}
+
+uint16_t TrajectoryFile::getVersion() const {
+    return (uint16_t) readLittleEndian(data + 4, 2);
+}
+
+uint8_t TrajectoryFile::getWaveformMode() const {
+    return data[6];
+}
+
+uint64_t TrajectoryFile::getStepsInRotation() const {
+    return stepsInRotation;
+}
+
+uint64_t TrajectoryFile::getSegmentCount() const {
+    return segmentCount;
+}
+
+uint64_t TrajectoryFile::getStepCount() const {
+    return stepCount;
+}
+
+StepSegment TrajectoryFile::getSegment(const uint64_t index, RotationDirection &direction) const {
+    if (index >= segmentCount) {
+        throw out_of_range("Segment index out of range");
+    }
+
+    const uint8_t *record = data + TRAJECTORY_HEADER_SIZE + index * TRAJECTORY_SEGMENT_SIZE;
+    StepSegment segment;
+    segment.interval = (uint32_t) readLittleEndian(record, 4);
+    segment.count = (uint32_t) readLittleEndian(record + 4, 4);
+    segment.add = (int32_t) (uint32_t) readLittleEndian(record + 8, 4);
+
+    switch (record[12]) {
+        case CLOCKWISE:
+            direction = CLOCKWISE;
+            break;
+        case COUNTER_CLOCKWISE:
+            direction = COUNTER_CLOCKWISE;
+            break;
+        default:
+            throw FormatError("Unknown RotationDirection value in segment " + to_string(index));
+            break;
+    }
+    return segment;
+}
+
+size_t TrajectoryFile::read(const uint64_t first, StepSegment *segments, const size_t capacity, RotationDirection &direction) const {
+    size_t count = 0;
+    while (count < capacity && first + count < segmentCount) {
+        RotationDirection segmentDirection;
+        const StepSegment segment = getSegment(first + count, segmentDirection);
+        if (count > 0 && segmentDirection != direction) {
+            break;
+        }
+        direction = segmentDirection;
+        segments[count++] = segment;
+    }
+    return count;
+}
+
+TrajectoryWriter::TrajectoryWriter(const string &path, const uint64_t stepsInRotation) :
+    out(path.c_str(), ios::binary | ios::trunc),
+    stepsInRotation(stepsInRotation),
+    segmentCount(0),
+    stepCount(0) {
+    if (!out) {
+        throw IOError("Could not open " + path + " for writing");
+    }
+    writeHeader();
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+    if (out.is_open()) {
+        try {
+            close();
+        } catch (...) {
+        }
+    }
+}
+
+void TrajectoryWriter::writeHeader() {
+    uint8_t header[TRAJECTORY_HEADER_SIZE] = {};
+    memcpy(header, TRAJECTORY_MAGIC, sizeof(TRAJECTORY_MAGIC));
+    writeLittleEndian(header + 4, TRAJECTORY_VERSION, 2);
+    header[6] = TRAJECTORY_WAVEFORM_FULL_STEP;
+    writeLittleEndian(header + 8, stepsInRotation, 8);
+    writeLittleEndian(header + 16, segmentCount, 8);
+    writeLittleEndian(header + 24, stepCount, 8);
+    out.write((const char *) header, sizeof(header));
+}
+
+void TrajectoryWriter::append(const StepQueue &move) {
+    for (size_t i = 0; i < move.size(); ++i) {
+        append(move[i], move.getDirection());
+    }
+}
+
+void TrajectoryWriter::append(const StepSegment &segment, const RotationDirection direction) {
+    uint8_t record[TRAJECTORY_SEGMENT_SIZE] = {};
+    writeLittleEndian(record, segment.interval, 4);
+    writeLittleEndian(record + 4, segment.count, 4);
+    writeLittleEndian(record + 8, (uint32_t) segment.add, 4);
+    record[12] = (uint8_t) direction;
+    out.write((const char *) record, sizeof(record));
+
+    ++segmentCount;
+    stepCount += segment.count;
+}
+
+void TrajectoryWriter::close() {
+    out.seekp(0);
+    writeHeader();
+    out.close();
+    if (out.fail()) {
+        throw IOError("Could not write the trajectory file");
+    }
+}
+
+}
@@ -0,0 +1,98 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <units.hpp>
+#include <stdexcept>
+#include <limits>
+#include <cmath>
+
+using namespace std;
+
+namespace libstepper {
+
+static uint64_t getGreatestCommonDivisor(uint64_t a, uint64_t b) {
+    while (b != 0) {
+        const uint64_t next = a % b;
+        a = b;
+        b = next;
+    }
+    return a;
+}
+
+static int64_t toReducedInt64(const uint64_t value, const uint64_t divisor) {
+    const uint64_t reduced = value / divisor;
+    if (reduced > (uint64_t) numeric_limits<int64_t>::max()) {
+        throw invalid_argument("The ratio is too large");
+    }
+    return (int64_t) reduced;
+}
+
+UnitConverter::UnitConverter(const uint64_t steps, const uint64_t units) : numerator(0), denominator(1), remainder(0) {
+    if (steps == 0 || units == 0) {
+        throw invalid_argument("Both the steps and the units must be > 0");
+    }
+    if (units > UINT64_MAX / (uint64_t) UNIT_SCALE) {
+        throw invalid_argument("The ratio is too large");
+    }
+
+    const uint64_t scaledUnits = units * (uint64_t) UNIT_SCALE;
+    const uint64_t divisor = getGreatestCommonDivisor(steps, scaledUnits);
+    numerator = toReducedInt64(steps, divisor);
+    denominator = toReducedInt64(scaledUnits, divisor);
+}
+
+UnitConverter UnitConverter::withGearRatio(const uint64_t motorTurns, const uint64_t outputTurns) const {
+    if (motorTurns == 0 || outputTurns == 0) {
+        throw invalid_argument("Both the motor turns and the output turns must be > 0");
+    }
+
+    // Reduced crosswise first, so that the products overflow as late as possible
+    const uint64_t numeratorDivisor = getGreatestCommonDivisor((uint64_t) numerator, outputTurns);
+    const uint64_t denominatorDivisor = getGreatestCommonDivisor((uint64_t) denominator, motorTurns);
+    const uint64_t steps = (uint64_t) numerator / numeratorDivisor;
+    const uint64_t units = (uint64_t) denominator / denominatorDivisor;
+    const uint64_t motor = motorTurns / denominatorDivisor;
+    const uint64_t output = outputTurns / numeratorDivisor;
+    if (steps > (uint64_t) numeric_limits<int64_t>::max() / motor || units > (uint64_t) numeric_limits<int64_t>::max() / output) {
+        throw invalid_argument("The ratio is too large");
+    }
+
+    UnitConverter geared(*this);
+    geared.numerator = (int64_t) (steps * motor);
+    geared.denominator = (int64_t) (units * output);
+    geared.remainder = 0;
+    return geared;
+}
+
+int64_t UnitConverter::toFixed(const double units) {
+    return (int64_t) llround(units * (double) UNIT_SCALE);
+}
+
+int64_t UnitConverter::toSteps(const int64_t fixedUnits) {
+    const int64_t total = fixedUnits * numerator + remainder;
+    remainder = total % denominator;
+    return total / denominator;
+}
+
+int64_t UnitConverter::toFixedUnits(const int64_t steps) const {
+    return steps * denominator / numerator;
+}
+
+int64_t UnitConverter::getRemainder() const {
+    return remainder;
+}
+
+void UnitConverter::resetRemainder() {
+    remainder = 0;
+}
+
+int64_t UnitConverter::getNumerator() const {
+    return numerator;
+}
+
+int64_t UnitConverter::getDenominator() const {
+    return denominator;
+}
+
+}
@@ -0,0 +1,159 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <recorder.hpp>
+#include <stepper.hpp>
+#include <clock.hpp>
+#include <histogram.hpp>
+#include <breakdown.hpp>
+#include <plancache.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+using namespace libstepper;
+
+// Every allocation of the test binary goes through here, but only the ones made by a thread while it's
+// counting are counted.
+static thread_local bool countingAllocations = false;
+static thread_local uint64_t allocationCount = 0;
+
+void *operator new(size_t size) {
+    if (countingAllocations) {
+        ++allocationCount;
+    }
+    void *memory = malloc(size == 0 ? 1 : size);
+    if (memory == nullptr) {
+        throw bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void *memory) noexcept {
+    free(memory);
+}
+
+// Counts the calling thread's allocations while it's in scope
+class AllocationCounter {
+public:
+    AllocationCounter() {
+        allocationCount = 0;
+        countingAllocations = true;
+    }
+
+    ~AllocationCounter() {
+        countingAllocations = false;
+    }
+
+    uint64_t getCount() const {
+        return allocationCount;
+    }
+};
+
+// A terminal that only counts its writes, so that it doesn't allocate either
+class CountingSignalConsumer : public DigitalSignalConsumer {
+public:
+    CountingSignalConsumer() : writes(0) {
+    }
+
+    void write(bool) {
+        ++writes;
+    }
+
+    uint64_t writes;
+};
+
+// A driver that doesn't allocate for its writes either
+typedef BasicRecordedDriver<CountingSignalConsumer> CountingDriver;
+
+TEST_CASE("The allocation counter counts", "[allocation]") {
+    AllocationCounter counter;
+    delete new int(1);
+    REQUIRE(counter.getCount() == 1);
+}
+
+TEST_CASE("StepperDriver moves don't allocate", "[allocation]") {
+    VirtualClock clock;
+    StepperDriverBuilder builder;
+    builder.setRotationStepCount(200)
+        .setInitialRPM(60)
+        .setClock(clock)
+        .setAcceleration(600);
+
+    SECTION("step(), rotateBy(), and moveTo()") {
+        CountingDriver motor(builder);
+        AllocationCounter counter;
+        REQUIRE(motor.driver->step(1000, COUNTER_CLOCKWISE));
+        REQUIRE(motor.driver->rotateBy(90.5, CLOCKWISE));
+        REQUIRE(motor.driver->moveTo(-300));
+        REQUIRE(counter.getCount() == 0);
+        REQUIRE(motor.a1.writes > 1000);
+    }
+
+    SECTION("drive()") {
+        CountingDriver motor(builder);
+        StepperDriver *driver = motor.driver;
+        uint64_t allocations = UINT64_MAX;
+        thread driving([driver, &allocations] {
+            AllocationCounter counter;
+            driver->drive(COUNTER_CLOCKWISE);
+            allocations = counter.getCount();
+        });
+        this_thread::sleep_for(milliseconds(50));
+        driver->interrupt();
+        driving.join();
+
+        REQUIRE(allocations == 0);
+        REQUIRE(driver->getPosition() > 0);
+    }
+
+    SECTION("Playing plans") {
+        CountingDriver motor(builder);
+        const StepQueue queue = motor.driver->compile(500, CLOCKWISE);
+        AllocationCounter counter;
+        REQUIRE(motor.driver->play(queue));
+        REQUIRE(counter.getCount() == 0);
+
+        const StepTimeline timeline = motor.driver->plan(500, COUNTER_CLOCKWISE);
+        AllocationCounter timelineCounter;
+        REQUIRE(motor.driver->play(timeline));
+        REQUIRE(timelineCounter.getCount() == 0);
+    }
+
+    SECTION("With a plan cache") {
+        PlanCache cache(4);
+        builder.setPlanCache(cache);
+        CountingDriver motor(builder);
+        // The misses compile their plans before the moves start
+        REQUIRE(motor.driver->step(500, COUNTER_CLOCKWISE));
+        REQUIRE(motor.driver->rotateBy(90, CLOCKWISE));
+        REQUIRE(cache.getMissCount() == 2);
+
+        AllocationCounter counter;
+        REQUIRE(motor.driver->step(500, CLOCKWISE));
+        REQUIRE(motor.driver->rotateBy(90, COUNTER_CLOCKWISE));
+        REQUIRE(counter.getCount() == 0);
+        REQUIRE(cache.getHitCount() == 2);
+        REQUIRE(motor.driver->getPosition() == 0);
+    }
+
+    SECTION("With the diagnostics and late step policies") {
+        OversleepingClock lateClock(20000);
+        LatencyHistogram histogram;
+        StepBreakdown breakdown;
+        builder.setClock(lateClock)
+            .setJitterHistogram(histogram)
+            .setStepBreakdown(breakdown)
+            .setLateStepPolicy(DERATE);
+        CountingDriver motor(builder);
+        AllocationCounter counter;
+        REQUIRE(motor.driver->step(1000, COUNTER_CLOCKWISE));
+        REQUIRE(counter.getCount() == 0);
+        REQUIRE(motor.driver->getStats().derations > 0);
+    }
+}
@@ -0,0 +1,100 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <recorder.hpp>
+#include <breakdown.hpp>
+#include <stepper.hpp>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+using namespace libstepper;
+
+// A SignalRecorder on a slow bus, which takes at least 20 us per write
+class SlowSignalRecorder : public SignalRecorder {
+public:
+    void write(bool value) {
+        this_thread::sleep_for(microseconds(20));
+        SignalRecorder::write(value);
+    }
+};
+
+TEST_CASE("StepBreakdown aggregates the phases", "[StepBreakdown]") {
+    StepBreakdown breakdown;
+    REQUIRE(breakdown.get(STEP_PHASE_WRITE).count == 0);
+    REQUIRE(breakdown.get(STEP_PHASE_WRITE).getMeanNanos() == 0);
+
+    breakdown.add(STEP_PHASE_WRITE, 100);
+    breakdown.add(STEP_PHASE_WRITE, 300);
+    breakdown.add(STEP_PHASE_LOCK, 50);
+
+    const StepPhaseStats write = breakdown.get(STEP_PHASE_WRITE);
+    REQUIRE(write.count == 2);
+    REQUIRE(write.totalNanos == 400);
+    REQUIRE(write.maxNanos == 300);
+    REQUIRE(write.getMeanNanos() == 200);
+    REQUIRE(breakdown.get(STEP_PHASE_LOCK).totalNanos == 50);
+    REQUIRE(breakdown.get(STEP_PHASE_RENDER).count == 0);
+
+    const uint64_t since = StepBreakdown::nowNanos();
+    REQUIRE(breakdown.addSince(STEP_PHASE_RENDER, since) >= since);
+    REQUIRE(breakdown.get(STEP_PHASE_RENDER).count == 1);
+
+    ostringstream output;
+    breakdown.write(output);
+    for (size_t i = 0; i < STEP_PHASE_COUNT; ++i) {
+        REQUIRE(output.str().find(StepBreakdown::getPhaseName((StepPhase) i)) != string::npos);
+    }
+
+    breakdown.reset();
+    REQUIRE(breakdown.get(STEP_PHASE_WRITE).count == 0);
+    REQUIRE(breakdown.get(STEP_PHASE_WRITE).maxNanos == 0);
+}
+
+TEST_CASE("StepperDriver times the phases of its steps", "[StepBreakdown]") {
+    auto en = SignalRecorder();
+    auto a1 = SlowSignalRecorder();
+    auto a2 = SlowSignalRecorder();
+    auto b1 = SlowSignalRecorder();
+    auto b2 = SlowSignalRecorder();
+    OversleepingClock clock(10);
+    StepBreakdown breakdown;
+    StepperDriver *driver = StepperDriverBuilder()
+        .setCoil1Terminal1(a1)
+        .setCoil1Terminal2(a2)
+        .setCoil2Terminal1(b1)
+        .setCoil2Terminal2(b2)
+        .setEnableTerminal(en)
+        .setRotationStepCount(200)
+        .setInitialRPM(60)
+        .setClock(clock)
+        .setStepBreakdown(breakdown)
+        .build();
+
+    REQUIRE(driver->step(100, COUNTER_CLOCKWISE));
+
+    REQUIRE(breakdown.get(STEP_PHASE_LOCK).count == 100);
+    REQUIRE(breakdown.get(STEP_PHASE_WRITE).count == 100);
+    REQUIRE(breakdown.get(STEP_PHASE_SCHEDULE).count == 100);
+
+    // 4 writes of at least 20 us each
+    REQUIRE(breakdown.get(STEP_PHASE_WRITE).getMeanNanos() >= 80000);
+
+    // Every sleep is 10 us late, by the driver's clock
+    const StepPhaseStats oversleep = breakdown.get(STEP_PHASE_OVERSLEEP);
+    REQUIRE(oversleep.count == 100);
+    REQUIRE(oversleep.totalNanos == 100 * 10000);
+    REQUIRE(oversleep.maxNanos == 10000);
+
+    // 5 ms steps, rendered 20 ms at a time
+    const StepPhaseStats render = breakdown.get(STEP_PHASE_RENDER);
+    REQUIRE(render.count >= 20);
+    REQUIRE(render.count <= 25);
+
+    delete driver;
+}
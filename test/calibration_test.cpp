@@ -0,0 +1,131 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <recorder.hpp>
+#include <calibration.hpp>
+#include <stepper.hpp>
+#include <clock.hpp>
+#include <stdexcept>
+
+using namespace std;
+using namespace libstepper;
+
+// A SignalRecorder whose writes take a fixed time on a clock
+class TimedSignalRecorder : public SignalRecorder {
+public:
+    TimedSignalRecorder(Clock &clock, const uint64_t writeMicros) : clock(clock), writeMicros(writeMicros) {
+    }
+
+    void write(bool value) {
+        clock.sleepForMicros(writeMicros);
+        SignalRecorder::write(value);
+    }
+
+private:
+    Clock &clock;
+    const uint64_t writeMicros;
+};
+
+// The coil writes take time, but not the enable terminal's, so that only the coils are calibrated
+typedef BasicRecordedDriver<TimedSignalRecorder, SignalRecorder> CalibratedDriver;
+
+// 200 steps per rotation at 60 RPM, i.e. 5 ms per step
+static StepperDriverBuilder calibratedBuilder(Clock &clock, const bool calibrateOnBuild) {
+    StepperDriverBuilder builder;
+    builder.setRotationStepCount(200)
+        .setInitialRPM(60)
+        .setClock(clock)
+        .setCalibrateOnBuild(calibrateOnBuild);
+    return builder;
+}
+
+TEST_CASE("StepperDriver::calibrate measures the write cost and the oversleep", "[StepperDriver::calibrate]") {
+    OversleepingClock clock(30);
+    StepperDriverBuilder builder = calibratedBuilder(clock, false);
+    CalibratedDriver motor(builder, TimedSignalRecorder(clock, 5));
+    REQUIRE(motor.driver->getCalibration().writeMicros == 0);
+    REQUIRE(motor.driver->getCalibration().oversleepMicros == 0);
+    REQUIRE_THROWS_AS(motor.driver->calibrate(0), invalid_argument);
+
+    // The writes sleep too, so each one takes 5 + 30 us
+    const TimingCalibration calibration = motor.driver->calibrate();
+    REQUIRE(calibration.writeMicros == 4 * 35);
+    REQUIRE(calibration.oversleepMicros == 30);
+    REQUIRE(motor.driver->getCalibration().writeMicros == calibration.writeMicros);
+
+    // Before the first step, the coils are written off, and the motor isn't enabled
+    REQUIRE(motor.a1.values.size() == CALIBRATION_SAMPLES);
+    for (size_t i = 0; i < CALIBRATION_SAMPLES; ++i) {
+        REQUIRE(!motor.a1.values[i]);
+        REQUIRE(!motor.a2.values[i]);
+        REQUIRE(!motor.b1.values[i]);
+        REQUIRE(!motor.b2.values[i]);
+    }
+    REQUIRE(motor.en.values.empty());
+    REQUIRE(motor.driver->getPosition() == 0);
+}
+
+TEST_CASE("StepperDriver::calibrate rewrites the coil state of the last step", "[StepperDriver::calibrate]") {
+    VirtualClock clock;
+    StepperDriverBuilder builder = calibratedBuilder(clock, false);
+    CalibratedDriver motor(builder, TimedSignalRecorder(clock, 0));
+
+    for (int i = 0; i < 3; ++i) {
+        RotationDirection direction = i == 1 ? CLOCKWISE : COUNTER_CLOCKWISE;
+        REQUIRE(motor.driver->step(1, direction));
+        const bool a1 = motor.a1.values.back();
+        const bool a2 = motor.a2.values.back();
+        const bool b1 = motor.b1.values.back();
+        const bool b2 = motor.b2.values.back();
+        const size_t written = motor.a1.values.size();
+
+        motor.driver->calibrate();
+        REQUIRE(motor.a1.values.size() == written + CALIBRATION_SAMPLES);
+        for (size_t j = written; j < motor.a1.values.size(); ++j) {
+            REQUIRE(motor.a1.values[j] == a1);
+            REQUIRE(motor.a2.values[j] == a2);
+            REQUIRE(motor.b1.values[j] == b1);
+            REQUIRE(motor.b2.values[j] == b2);
+        }
+
+        // So the next step still moves the motor
+        REQUIRE(motor.driver->step(1, COUNTER_CLOCKWISE));
+        REQUIRE((motor.a1.values.back() != a1 || motor.a2.values.back() != a2 ||
+                 motor.b1.values.back() != b1 || motor.b2.values.back() != b2));
+    }
+}
+
+TEST_CASE("StepperDriver wakes up early by its calibration", "[StepperDriver::calibrate]") {
+    SECTION("Uncalibrated steps are late by the write cost") {
+        VirtualClock clock;
+        StepperDriverBuilder builder = calibratedBuilder(clock, false);
+        CalibratedDriver motor(builder, TimedSignalRecorder(clock, 5));
+        REQUIRE(motor.driver->step(100, COUNTER_CLOCKWISE));
+        REQUIRE(motor.driver->getStats().maxLatenessMicros == 20);
+    }
+
+    SECTION("Calibrated steps are on time") {
+        VirtualClock clock;
+        StepperDriverBuilder builder = calibratedBuilder(clock, true);
+        CalibratedDriver motor(builder, TimedSignalRecorder(clock, 5));
+        REQUIRE(motor.driver->getCalibration().writeMicros == 20);
+        REQUIRE(motor.driver->getCalibration().oversleepMicros == 0);
+        REQUIRE(motor.driver->step(100, COUNTER_CLOCKWISE));
+        REQUIRE(motor.driver->getStats().maxLatenessMicros == 0);
+        REQUIRE(motor.driver->getStats().enabledMicros == 100 * 5000);
+    }
+
+    SECTION("A calibration can be shared between drivers") {
+        OversleepingClock clock(30);
+        StepperDriverBuilder builder = calibratedBuilder(clock, true);
+        CalibratedDriver calibrated(builder, TimedSignalRecorder(clock, 0));
+        builder.setCalibrateOnBuild(false);
+        CalibratedDriver motor(builder, TimedSignalRecorder(clock, 0));
+        motor.driver->setCalibration(calibrated.driver->getCalibration());
+        REQUIRE(motor.driver->step(100, COUNTER_CLOCKWISE));
+        REQUIRE(motor.driver->getStats().maxLatenessMicros == 0);
+        REQUIRE(motor.driver->getStats().enabledMicros == 100 * 5000);
+    }
+}
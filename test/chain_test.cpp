@@ -0,0 +1,144 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <recorder.hpp>
+#include <stepper.hpp>
+#include <chain.hpp>
+#include <exception.hpp>
+#include <vector>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+using namespace libstepper;
+
+// A mock WaveformChainConsumer that remembers the batches it receives, instead of outputting them
+class ChainRecorder : public WaveformChainConsumer {
+public:
+    ChainRecorder() : begins(0), ends(0) {
+    }
+
+    void begin() {
+        ++begins;
+    }
+
+    bool write(const StepEvent *events, const size_t count) {
+        batches.push_back(vector<StepEvent>(events, events + count));
+        return true;
+    }
+
+    void end() {
+        ++ends;
+    }
+
+    int begins;
+    int ends;
+    vector<vector<StepEvent>> batches;
+};
+
+TEST_CASE("StepperDriverBuilder accepts a waveform chain instead of coil terminals", "[StepperDriverBuilder]") {
+    auto en = SignalRecorder();
+    auto a1 = SignalRecorder();
+    auto chain = ChainRecorder();
+
+    auto builder = StepperDriverBuilder();
+    builder.setEnableTerminal(en).setRotationStepCount(200);
+    REQUIRE_THROWS_AS(builder.build(), IllegalStateError);
+
+    builder.setWaveformChain(chain);
+    StepperDriver *driver = nullptr;
+    REQUIRE_NOTHROW(driver = builder.build());
+    delete driver;
+
+    builder.setCoil1Terminal1(a1);
+    REQUIRE_THROWS_AS(builder.build(), IllegalStateError);
+}
+
+TEST_CASE("StepperDriver sends the waveform to the waveform chain in batches", "[StepperDriver::step]") {
+    auto en = SignalRecorder();
+    auto chain = ChainRecorder();
+    auto driver = StepperDriverBuilder()
+        .setEnableTerminal(en)
+        .setWaveformChain(chain)
+        .setRotationStepCount(200)
+        .setInitialRPM(600)
+        .build();
+
+    SECTION("Every move is wrapped in begin() and end()") {
+        REQUIRE(driver->step(150, COUNTER_CLOCKWISE));
+        REQUIRE(chain.begins == 1);
+        REQUIRE(chain.ends == 1);
+        REQUIRE(en.values.size() == 2);
+        REQUIRE(ARE_CLOSE(driver->getPositionInDegrees(), 270.0));
+
+        size_t total = 0;
+        for (auto &batch : chain.batches) {
+            REQUIRE(batch.size() > 1);
+            total += batch.size();
+
+            // Timestamps are relative to the previous batch, so every batch starts one interval in.
+            REQUIRE(batch[0].timestampMicros == 500);
+            for (size_t i = 1; i < batch.size(); ++i) {
+                REQUIRE(batch[i].timestampMicros - batch[i - 1].timestampMicros == 500);
+            }
+        }
+        REQUIRE(total == 150);
+        REQUIRE(chain.batches[0][0].coilMask == 0x0C);
+        REQUIRE(chain.batches[0][1].coilMask == 0x06);
+    }
+
+    SECTION("Planned timelines are sent as a single batch") {
+        REQUIRE(driver->play(driver->plan(150, CLOCKWISE)));
+        REQUIRE(chain.batches.size() == 1);
+        REQUIRE(chain.batches[0].size() == 150);
+        REQUIRE(chain.batches[0][1].coilMask == 0x09);
+    }
+
+    SECTION("Destroying the driver turns the coils off through the chain") {
+        delete driver;
+        driver = nullptr;
+        REQUIRE(chain.batches.size() == 1);
+        REQUIRE(chain.batches[0].size() == 1);
+        REQUIRE(chain.batches[0][0].coilMask == 0x00);
+    }
+
+    if (driver != nullptr) {
+        delete driver;
+    }
+}
+
+TEST_CASE("LocalWaveformChain plays batches on the coil terminals", "[LocalWaveformChain]") {
+    auto a1 = SignalRecorder();
+    auto a2 = SignalRecorder();
+    auto b1 = SignalRecorder();
+    auto b2 = SignalRecorder();
+    auto en = SignalRecorder();
+    auto chain = LocalWaveformChain(a1, b1, a2, b2);
+    auto driver = StepperDriverBuilder()
+        .setEnableTerminal(en)
+        .setWaveformChain(chain)
+        .setRotationStepCount(200)
+        .setInitialRPM(600)
+        .build();
+
+    REQUIRE(driver->step(45, COUNTER_CLOCKWISE));
+    REQUIRE(chain.getEventCount() == 45);
+    REQUIRE(chain.getBatchCount() > 1);
+
+    REQUIRE(a1.values.size() == 45);
+    REQUIRE(b1.values.size() == 45);
+    REQUIRE(a2.values.size() == 45);
+    REQUIRE(b2.values.size() == 45);
+
+    for (size_t i = 0; i < 45; ++i) {
+        // Counter clockwise waveform: 1100, 0110, 0011, 1001
+        REQUIRE(a1.values[i] == (i % 4 == 0 || i % 4 == 3));
+        REQUIRE(b1.values[i] == (i % 4 == 0 || i % 4 == 1));
+        REQUIRE(a2.values[i] == (i % 4 == 1 || i % 4 == 2));
+        REQUIRE(b2.values[i] == (i % 4 == 2 || i % 4 == 3));
+    }
+
+    delete driver;
+}
@@ -0,0 +1,189 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <recorder.hpp>
+#include <follower.hpp>
+#include <multiaxis.hpp>
+#include <chain.hpp>
+#include <exception.hpp>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace libstepper;
+
+// A leader StepperDriver that feeds every step to a follower
+static StepperDriverBuilder leaderBuilder(StepFollower &follower, const uint64_t maxSafeRPM = UINT64_MAX) {
+    StepperDriverBuilder builder;
+    builder.setRotationStepCount(200)
+        .setInitialRPM(600)
+        .setMaxSafeRPM(maxSafeRPM)
+        .setFollower(follower);
+    return builder;
+}
+
+TEST_CASE("GearFollower validates its ratio", "[GearFollower]") {
+    RecordedDriver follower(200, 60);
+    REQUIRE_THROWS_AS(GearFollower(*follower.driver, 1, 0), invalid_argument);
+    // The follower would have to take more than 1 step per leader step
+    REQUIRE_THROWS_AS(GearFollower(*follower.driver, 3, 2), invalid_argument);
+    REQUIRE_THROWS_AS(GearFollower(*follower.driver, -3, 2), invalid_argument);
+    REQUIRE_NOTHROW(GearFollower(*follower.driver, -2, 2));
+}
+
+TEST_CASE("Followers are checked against the leader's max safe RPM", "[GearFollower]") {
+    // 20000 steps per second at most
+    RecordedDriver follower(200, 60, 6000);
+    GearFollower gear(*follower.driver, -3, 4);
+
+    // The leader's 12000 RPM (40000 steps per second) would need 30000 steps per second of the follower
+    StepperDriverBuilder builder = leaderBuilder(gear, 12000);
+    REQUIRE_THROWS_AS(RecordedDriver(builder), IllegalStateError);
+    // As would a leader without a max safe RPM at all
+    builder.setMaxSafeRPM(UINT64_MAX);
+    REQUIRE_THROWS_AS(RecordedDriver(builder), IllegalStateError);
+    builder.setMaxSafeRPM(7000);
+    REQUIRE_NOTHROW(RecordedDriver(builder));
+
+    // The steepest part of the profile is 1 follower step per leader step
+    CamFollower cam(*follower.driver, { 0, 4, 3 }, 4);
+    builder.setFollower(cam);
+    REQUIRE_THROWS_AS(RecordedDriver(builder), IllegalStateError);
+    builder.setMaxSafeRPM(5000);
+    REQUIRE_NOTHROW(RecordedDriver(builder));
+
+    // A flat profile never steps the follower
+    CamFollower flat(*follower.driver, { 2 }, 1);
+    builder.setFollower(flat).setMaxSafeRPM(UINT64_MAX);
+    REQUIRE_NOTHROW(RecordedDriver(builder));
+
+    // Unlimited followers can follow any leader
+    RecordedDriver unlimited(200, 60);
+    GearFollower fastGear(*unlimited.driver, 1, 1);
+    builder.setFollower(fastGear);
+    REQUIRE_NOTHROW(RecordedDriver(builder));
+}
+
+TEST_CASE("Followers can't follow a leader with a waveform chain", "[GearFollower]") {
+    RecordedDriver follower(200, 60);
+    GearFollower gear(*follower.driver, 1, 2);
+    SignalRecorder a1, a2, b1, b2, en;
+    LocalWaveformChain chain(a1, b1, a2, b2);
+    StepperDriverBuilder builder;
+    builder.setWaveformChain(chain)
+        .setEnableTerminal(en)
+        .setRotationStepCount(200)
+        .setInitialRPM(600)
+        .setFollower(gear);
+
+    // The chain plays its batches on its own timing, which the follower couldn't be phase locked to
+    REQUIRE_THROWS_AS(builder.build(), IllegalStateError);
+}
+
+TEST_CASE("GearFollower steps the follower at the gear ratio", "[GearFollower]") {
+    RecordedDriver follower(200, 60);
+    GearFollower gear(*follower.driver, 2, 3);
+    StepperDriverBuilder builder = leaderBuilder(gear);
+    RecordedDriver leader(builder);
+
+    REQUIRE(leader.driver->step(300, COUNTER_CLOCKWISE));
+    REQUIRE(gear.getFollowerSteps() == 200);
+    REQUIRE(follower.driver->getPositionInDegrees() == 0.0);
+    // A write to every coil per step, and the follower is enabled for the leader's move only
+    REQUIRE(follower.a1.values.size() == 200);
+    REQUIRE(follower.en.values.size() == 2);
+    REQUIRE(follower.en.values[0]);
+    REQUIRE(!follower.en.values[1]);
+
+    REQUIRE(leader.driver->rotateBy(-9, COUNTER_CLOCKWISE));
+    REQUIRE(gear.getFollowerSteps() == 197);
+    REQUIRE(follower.driver->getPositionInDegrees() == 354.6);
+}
+
+TEST_CASE("GearFollower doesn't drift across moves", "[GearFollower]") {
+    RecordedDriver follower(200, 60);
+    GearFollower gear(*follower.driver, -5, 7);
+    StepperDriverBuilder builder = leaderBuilder(gear);
+    RecordedDriver leader(builder);
+
+    // The fractional steps are carried over from one move to the next, instead of being rounded per move
+    for (size_t i = 0; i < 10; ++i) {
+        REQUIRE(leader.driver->step(3, COUNTER_CLOCKWISE));
+    }
+    REQUIRE(gear.getFollowerSteps() == -21);
+
+    REQUIRE(leader.driver->step(30, CLOCKWISE));
+    REQUIRE(gear.getFollowerSteps() == 0);
+    REQUIRE(follower.driver->getPositionInDegrees() == 0.0);
+}
+
+TEST_CASE("GearFollower runs on the MultiAxisController's timing loop", "[GearFollower]") {
+    RecordedDriver follower(200, 60);
+    GearFollower gear(*follower.driver, 1, 2);
+    StepperDriverBuilder builder = leaderBuilder(gear);
+    RecordedDriver leader(builder);
+    RecordedDriver y(200, 600);
+    MultiAxisController controller({ leader.driver, y.driver });
+
+    REQUIRE(controller.move({ 100, 20 }, 2000));
+    REQUIRE(gear.getFollowerSteps() == 50);
+}
+
+TEST_CASE("CamFollower validates its table", "[CamFollower]") {
+    RecordedDriver follower(200, 60);
+    REQUIRE_THROWS_AS(CamFollower(*follower.driver, vector<int64_t>(), 1), invalid_argument);
+    REQUIRE_THROWS_AS(CamFollower(*follower.driver, { 0, 1 }, 0), invalid_argument);
+    // 2 follower steps per leader step, from 0 to 4
+    REQUIRE_THROWS_AS(CamFollower(*follower.driver, { 0, 4, 3 }, 2), invalid_argument);
+    // And from the last entry back to the first
+    REQUIRE_THROWS_AS(CamFollower(*follower.driver, { 0, 1, 2 }, 1), invalid_argument);
+    REQUIRE_NOTHROW(CamFollower(*follower.driver, { 0, 1, 1 }, 1));
+}
+
+TEST_CASE("CamFollower traces the interpolated profile", "[CamFollower]") {
+    RecordedDriver follower(200, 60);
+    // Up 10 steps, back down, down 10 steps, and back up, over 40 leader steps
+    CamFollower cam(*follower.driver, { 0, 10, 0, -10 }, 10);
+    StepperDriverBuilder builder = leaderBuilder(cam);
+    RecordedDriver leader(builder);
+    REQUIRE(cam.getCycleLength() == 40);
+
+    REQUIRE(leader.driver->step(4, COUNTER_CLOCKWISE));
+    REQUIRE(cam.getFollowerPosition() == 4);
+    REQUIRE(leader.driver->step(6, COUNTER_CLOCKWISE));
+    REQUIRE(cam.getFollowerPosition() == 10);
+    REQUIRE(leader.driver->step(20, COUNTER_CLOCKWISE));
+    REQUIRE(cam.getFollowerPosition() == -10);
+    // 1 step of the follower per leader step
+    REQUIRE(follower.a1.values.size() == 30);
+
+    // The profile closes back to table[0], and repeats
+    REQUIRE(leader.driver->step(10, COUNTER_CLOCKWISE));
+    REQUIRE(cam.getLeaderPhase() == 0);
+    REQUIRE(cam.getFollowerPosition() == 0);
+    REQUIRE(follower.driver->getPositionInDegrees() == 0.0);
+
+    // And wraps around backwards too
+    REQUIRE(leader.driver->step(3, CLOCKWISE));
+    REQUIRE(cam.getLeaderPhase() == 37);
+    REQUIRE(cam.getFollowerPosition() == -3);
+}
+
+TEST_CASE("CamFollower runs on the MultiAxisController's timing loop", "[CamFollower]") {
+    RecordedDriver follower(200, 60);
+    CamFollower cam(*follower.driver, { 0, 3, 7, 12, 6 }, 6);
+    StepperDriverBuilder builder = leaderBuilder(cam);
+    RecordedDriver leader(builder);
+    RecordedDriver y(200, 600);
+    MultiAxisController controller({ leader.driver, y.driver });
+
+    // 2 whole cycles, and a sixth of an entry
+    REQUIRE(controller.move({ 61, 7 }, 2000));
+    REQUIRE(cam.getLeaderPhase() == 1);
+    REQUIRE(cam.getFollowerPosition() == 1);
+    REQUIRE(controller.move({ -5, 0 }, 2000));
+    REQUIRE(cam.getLeaderPhase() == 26);
+    REQUIRE(cam.getFollowerPosition() == 4);
+}
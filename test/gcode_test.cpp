@@ -0,0 +1,442 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <recorder.hpp>
+#include <gcode.hpp>
+#include <interpreter.hpp>
+#include <executor.hpp>
+#include <multiaxis.hpp>
+#include <interpolator.hpp>
+#include <exception.hpp>
+#include <stdexcept>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <chrono>
+
+using namespace std;
+using namespace std::chrono;
+using namespace libstepper;
+
+// Remembers every block executed, and the number of lines read when it was
+class RecordingExecutor : public BlockExecutor {
+public:
+    RecordingExecutor(const size_t axisCount = 3) : axisCount(axisCount), interpreter(nullptr), began(0), ended(0), stopAfter(SIZE_MAX) {
+    }
+
+    size_t getAxisCount() const {
+        return axisCount;
+    }
+
+    double getMaxStepRate(const size_t) const {
+        return 0;
+    }
+
+    void begin() {
+        ++began;
+    }
+
+    void end() {
+        ++ended;
+    }
+
+    bool execute(const PlannerBlock &block) {
+        blocks.push_back(block);
+        lineCounts.push_back(interpreter == nullptr ? 0 : interpreter->getLineCount());
+        return blocks.size() < stopAfter;
+    }
+
+    size_t axisCount;
+    const GcodeInterpreter *interpreter;
+    vector<PlannerBlock> blocks;
+    vector<uint64_t> lineCounts;
+    size_t began;
+    size_t ended;
+    size_t stopAfter;
+};
+
+static vector<GcodeAxis> getAxes() {
+    vector<GcodeAxis> axes;
+    axes.push_back({ 'X', 0, 100, 0 });
+    axes.push_back({ 'Y', 1, 100, 0 });
+    axes.push_back({ 'Z', 2, 400, 0 });
+    return axes;
+}
+
+static bool runJob(GcodeInterpreter &interpreter, const string &job) {
+    istringstream input(job);
+    return interpreter.run(input);
+}
+
+TEST_CASE("GcodeParser parses words", "[GcodeParser]") {
+    GcodeLine line;
+
+    SECTION("Letters, numbers, and comments") {
+        GcodeParser::parse("N10 g1 x1.5 Y -2 (a comment) F600 Z.25 ; the rest", 7, line);
+        REQUIRE(line.getLineNumber() == 7);
+        REQUIRE(line.getGCodeCount() == 1);
+        REQUIRE(line.getGCode(0) == 1);
+        REQUIRE(line.get('N') == 10);
+        REQUIRE(line.get('x') == 1.5);
+        REQUIRE(line.get('Y') == -2);
+        REQUIRE(line.get('F') == 600);
+        REQUIRE(line.get('Z') == 0.25);
+        REQUIRE(!line.has('A'));
+        REQUIRE(line.get('A', 3) == 3);
+        REQUIRE_THROWS_AS(line.get('A'), out_of_range);
+    }
+
+    SECTION("Several G words") {
+        GcodeParser::parse("G21 G90 G1 X1*57", 1, line);
+        REQUIRE(line.getGCodeCount() == 3);
+        REQUIRE(line.getGCode(0) == 21);
+        REQUIRE(line.getGCode(1) == 90);
+        REQUIRE(line.getGCode(2) == 1);
+        REQUIRE(line.get('X') == 1);
+    }
+
+    SECTION("Malformed lines") {
+        REQUIRE_THROWS_AS(GcodeParser::parse("G1 X", 1, line), FormatError);
+        REQUIRE_THROWS_AS(GcodeParser::parse("G1 X1 X2", 1, line), FormatError);
+        REQUIRE_THROWS_AS(GcodeParser::parse("G1 (unterminated", 1, line), FormatError);
+        REQUIRE_THROWS_AS(GcodeParser::parse("G1 #1", 1, line), FormatError);
+    }
+}
+
+TEST_CASE("GcodeParser streams lines", "[GcodeParser]") {
+    GcodeLine line;
+
+    SECTION("Empty lines and comments are skipped") {
+        istringstream input("\n; a comment\nG0 X1\r\n%\n\nG1 Y2");
+        GcodeParser parser(input);
+
+        REQUIRE(parser.next(line));
+        REQUIRE(line.getLineNumber() == 3);
+        REQUIRE(line.get('X') == 1);
+        REQUIRE(parser.next(line));
+        REQUIRE(line.getLineNumber() == 6);
+        REQUIRE(line.get('Y') == 2);
+        REQUIRE(!parser.next(line));
+    }
+
+    SECTION("Lines longer than the buffer are rejected") {
+        istringstream input("G1 X1\n" + string(GCODE_MAX_LINE_LENGTH + 1, ' ') + "G1 X2\n");
+        GcodeParser parser(input);
+
+        REQUIRE(parser.next(line));
+        REQUIRE_THROWS_AS(parser.next(line), FormatError);
+    }
+}
+
+TEST_CASE("GcodeInterpreter converts moves to steps", "[GcodeInterpreter]") {
+    RecordingExecutor executor;
+    GcodeInterpreter interpreter(executor, getAxes());
+
+    SECTION("Units, and absolute and relative coordinates") {
+        REQUIRE(runJob(interpreter, "G21 G90\nG1 X10 Y0 F600\nG91 X-5\nG20 G1 Y1\nG1 Z0.5\n"));
+
+        REQUIRE(executor.began == 1);
+        REQUIRE(executor.ended == 1);
+        REQUIRE(interpreter.getLineCount() == 5);
+        REQUIRE(interpreter.getBlockCount() == 4);
+        REQUIRE(executor.blocks.size() == 4);
+
+        REQUIRE(executor.blocks[0].steps[0] == 1000);
+        REQUIRE(executor.blocks[0].steps[1] == 0);
+        REQUIRE(executor.blocks[1].steps[0] == -500);
+        REQUIRE(executor.blocks[2].steps[1] == 2540);
+        // Relative, in inches
+        REQUIRE(executor.blocks[3].steps[2] == 5080);
+
+        REQUIRE(executor.blocks[0].nominalSpeed == 10);
+        REQUIRE(executor.blocks[0].length == 10);
+        REQUIRE(interpreter.getPosition('X') == 5);
+        REQUIRE(interpreter.getPosition('Y') == 25.4);
+        REQUIRE(interpreter.getPosition('Z') == 12.7);
+    }
+
+    SECTION("Motion modes are modal, and G0 moves at the rapid rate") {
+        REQUIRE(runJob(interpreter, "G0 X1\nX2\nG1 Y1 F120\nY2\n"));
+        REQUIRE(executor.blocks.size() == 4);
+        REQUIRE(executor.blocks[1].nominalSpeed == GcodeConfig().rapidFeedRate / 60);
+        REQUIRE(executor.blocks[3].nominalSpeed == 2);
+    }
+
+    SECTION("Moves that round to no steps don't make blocks") {
+        REQUIRE(runJob(interpreter, "G1 X0.001\nX0.002\nX0.01\n"));
+        REQUIRE(executor.blocks.size() == 1);
+        REQUIRE(executor.blocks[0].steps[0] == 1);
+    }
+
+    SECTION("Rounding doesn't accumulate") {
+        REQUIRE(runJob(interpreter, "G91\nG1 X0.004\nX0.004\nX0.004\nX0.004\nX0.004\n"));
+        int64_t total = 0;
+        for (size_t i = 0; i < executor.blocks.size(); ++i) {
+            total += executor.blocks[i].steps[0];
+        }
+        REQUIRE(total == 2);
+    }
+}
+
+TEST_CASE("GcodeInterpreter plans junction speeds", "[GcodeInterpreter]") {
+    RecordingExecutor executor;
+    GcodeInterpreter interpreter(executor, getAxes());
+
+    SECTION("Straight lines don't slow down between blocks") {
+        REQUIRE(runJob(interpreter, "G1 X10 F600\nX20\nX30\n"));
+        REQUIRE(executor.blocks[0].entrySpeed == 0);
+        REQUIRE(executor.blocks[0].exitSpeed == 10);
+        REQUIRE(executor.blocks[1].entrySpeed == 10);
+        REQUIRE(executor.blocks[2].exitSpeed == 0);
+    }
+
+    SECTION("Corners slow down, and reversals stop") {
+        REQUIRE(runJob(interpreter, "G1 X10 F600\nY10\nY0\n"));
+        REQUIRE(executor.blocks[0].exitSpeed > 0);
+        REQUIRE(executor.blocks[0].exitSpeed < 10);
+        REQUIRE(executor.blocks[1].entrySpeed == executor.blocks[0].exitSpeed);
+        REQUIRE(executor.blocks[1].exitSpeed == 0);
+    }
+
+    SECTION("Speeds are reachable within the acceleration") {
+        REQUIRE(runJob(interpreter, "G1 X0.1 F6000\nX0.2\nX50\nX50.1\nY0.1\n"));
+        const double acceleration = GcodeConfig().acceleration;
+        for (size_t i = 0; i < executor.blocks.size(); ++i) {
+            const PlannerBlock &block = executor.blocks[i];
+            const double limit = 2 * acceleration * block.length + 1e-9;
+            REQUIRE(block.exitSpeed * block.exitSpeed <= block.entrySpeed * block.entrySpeed + limit);
+            REQUIRE(block.entrySpeed * block.entrySpeed <= block.exitSpeed * block.exitSpeed + limit);
+            REQUIRE(block.entrySpeed <= block.nominalSpeed);
+            REQUIRE(block.exitSpeed <= block.nominalSpeed);
+            if (i > 0) {
+                REQUIRE(block.entrySpeed == executor.blocks[i - 1].exitSpeed);
+            }
+        }
+        REQUIRE(executor.blocks.back().exitSpeed == 0);
+    }
+
+    SECTION("Dwells stop the machine") {
+        REQUIRE(runJob(interpreter, "G1 X10 F600\nG4 P500\nG1 X20\nG4 S1.5\n"));
+        REQUIRE(executor.blocks.size() == 4);
+        REQUIRE(executor.blocks[0].exitSpeed == 0);
+        REQUIRE(executor.blocks[1].type == PlannerBlock::DWELL);
+        REQUIRE(executor.blocks[1].dwellMicros == 500000);
+        REQUIRE(executor.blocks[2].entrySpeed == 0);
+        REQUIRE(executor.blocks[3].dwellMicros == 1500000);
+    }
+}
+
+TEST_CASE("GcodeInterpreter plans arcs", "[GcodeInterpreter]") {
+    RecordingExecutor executor;
+    GcodeInterpreter interpreter(executor, getAxes());
+    const double pi = 3.14159265358979323846;
+
+    SECTION("With the center as offsets") {
+        REQUIRE(runJob(interpreter, "G2 X10 Y0 I5 J0\nG3 I-5\n"));
+        REQUIRE(executor.blocks.size() == 2);
+
+        const PlannerBlock &half = executor.blocks[0];
+        REQUIRE(half.type == PlannerBlock::ARC);
+        REQUIRE(half.direction == CLOCKWISE);
+        REQUIRE(half.steps[0] == 1000);
+        REQUIRE(half.centerX == 500);
+        REQUIRE(half.centerY == 0);
+        REQUIRE(abs(half.length - 5 * pi) < 1e-9);
+        // Clockwise from the left of the circle is up
+        REQUIRE(abs(half.entryDirection[1] - 1) < 1e-9);
+        REQUIRE(abs(half.exitDirection[1] + 1) < 1e-9);
+
+        const PlannerBlock &full = executor.blocks[1];
+        REQUIRE(full.direction == COUNTER_CLOCKWISE);
+        REQUIRE(full.steps[0] == 0);
+        REQUIRE(abs(full.length - 10 * pi) < 1e-9);
+        REQUIRE(interpreter.getPosition('X') == 10);
+    }
+
+    SECTION("The ticks add up to the arc's length") {
+        REQUIRE(runJob(interpreter, "G2 X10 Y0 I5 J0\nG3 I-5\nG2 X14 Y4 I0 J4\nG3 X10 Y0 I0 J-4\nG3 X12 Y4 I5 J0\n"));
+        for (size_t i = 0; i < executor.blocks.size(); ++i) {
+            const PlannerBlock &block = executor.blocks[i];
+            ArcInterpolator interpolator(block.axisCount,
+                                         block.xAxis,
+                                         block.yAxis,
+                                         block.steps[block.xAxis],
+                                         block.steps[block.yAxis],
+                                         block.centerX,
+                                         block.centerY,
+                                         block.direction);
+            vector<int8_t> steps(block.axisCount, 0);
+            uint64_t weight = 0;
+            while (interpolator.next(steps.data())) {
+                weight += interpolator.getTickWeight();
+            }
+
+            const double distance = block.distancePerTick * (double) weight / TICK_WEIGHT_UNIT;
+            REQUIRE(abs(distance - block.length) < block.length * 0.01);
+        }
+    }
+
+    SECTION("With the radius") {
+        REQUIRE(runJob(interpreter, "G2 X10 Y0 R10\nG2 X0 Y0 R-10\n"));
+        REQUIRE(executor.blocks[0].centerX == 500);
+        REQUIRE(executor.blocks[0].centerY == -866);
+        // The long way round, with the center on the other side
+        REQUIRE(executor.blocks[1].centerX == -500);
+        REQUIRE(executor.blocks[1].centerY == -866);
+        REQUIRE(executor.blocks[1].length > executor.blocks[0].length * 4);
+    }
+
+    SECTION("Invalid arcs") {
+        REQUIRE_THROWS_AS(runJob(interpreter, "G2 X10 Z1 I5\n"), FormatError);
+        REQUIRE_THROWS_AS(runJob(interpreter, "G2 X20 R5\n"), FormatError);
+        REQUIRE_THROWS_AS(runJob(interpreter, "G2 X10\n"), FormatError);
+        REQUIRE(executor.ended == executor.began);
+    }
+}
+
+TEST_CASE("GcodeInterpreter homes with G28", "[GcodeInterpreter]") {
+    RecordingExecutor executor;
+    GcodeInterpreter interpreter(executor, getAxes());
+
+    REQUIRE(runJob(interpreter, "G1 X10 Y5\nG28 X5\nG28\n"));
+    REQUIRE(executor.blocks.size() == 4);
+    REQUIRE(executor.blocks[1].steps[0] == -500);
+    REQUIRE(executor.blocks[2].steps[0] == -500);
+    REQUIRE(executor.blocks[2].steps[1] == 0);
+    REQUIRE(executor.blocks[3].steps[1] == -500);
+    REQUIRE(interpreter.getPosition('X') == 0);
+    REQUIRE(interpreter.getPosition('Y') == 0);
+}
+
+TEST_CASE("GcodeInterpreter rejects what it doesn't support", "[GcodeInterpreter]") {
+    RecordingExecutor executor;
+    GcodeInterpreter interpreter(executor, getAxes());
+
+    REQUIRE_THROWS_AS(runJob(interpreter, "G1 X1\nG38.2 X1\n"), FormatError);
+    REQUIRE_THROWS_AS(runJob(interpreter, "G92 X1\n"), FormatError);
+    REQUIRE_THROWS_AS(runJob(interpreter, "G1 A1\n"), FormatError);
+    REQUIRE_THROWS_AS(runJob(interpreter, "G1 F0\n"), FormatError);
+
+    try {
+        runJob(interpreter, "G1 X1\nG1 X2\nG5 X1\n");
+        FAIL("Expected a FormatError");
+    } catch (const FormatError &error) {
+        REQUIRE(string(error.what()).find("line 3") != string::npos);
+    }
+
+    // M codes, tool changes, etc. are ignored
+    executor.blocks.clear();
+    REQUIRE(runJob(interpreter, "M3 S1000\nT1\nG1 X5\n"));
+    REQUIRE(executor.blocks.size() == 1);
+}
+
+TEST_CASE("GcodeInterpreter validates its config", "[GcodeInterpreter]") {
+    RecordingExecutor executor;
+    vector<GcodeAxis> axes = getAxes();
+
+    REQUIRE_THROWS_AS(GcodeInterpreter(executor, vector<GcodeAxis>()), invalid_argument);
+
+    axes[1].letter = 'X';
+    REQUIRE_THROWS_AS(GcodeInterpreter(executor, axes), invalid_argument);
+
+    axes = getAxes();
+    axes[2].axis = 3;
+    REQUIRE_THROWS_AS(GcodeInterpreter(executor, axes), invalid_argument);
+
+    axes = getAxes();
+    axes[0].letter = 'E';
+    REQUIRE_THROWS_AS(GcodeInterpreter(executor, axes), invalid_argument);
+
+    GcodeConfig config;
+    config.lookahead = 1;
+    REQUIRE_THROWS_AS(GcodeInterpreter(executor, getAxes(), config), invalid_argument);
+}
+
+TEST_CASE("GcodeInterpreter streams jobs", "[GcodeInterpreter]") {
+    RecordingExecutor executor;
+    GcodeConfig config;
+    config.lookahead = 4;
+    GcodeInterpreter interpreter(executor, getAxes(), config);
+    executor.interpreter = &interpreter;
+
+    SECTION("Blocks are executed while the job is still being read") {
+        ostringstream job;
+        for (size_t i = 1; i <= 100; ++i) {
+            job << "G1 X" << i << " Y" << (i % 2) << "\n";
+        }
+
+        REQUIRE(runJob(interpreter, job.str()));
+        REQUIRE(executor.blocks.size() == 100);
+        REQUIRE(executor.lineCounts[0] == 5);
+        REQUIRE(executor.lineCounts[50] == 55);
+    }
+
+    SECTION("The executor can stop the job") {
+        executor.stopAfter = 2;
+        REQUIRE(!runJob(interpreter, "G1 X1\nX2\nX3\nX4\nX5\nX6\nX7\nX8\n"));
+        REQUIRE(executor.blocks.size() == 2);
+        REQUIRE(executor.ended == 1);
+    }
+}
+
+TEST_CASE("GcodeInterpreter drives a MultiAxisController", "[GcodeInterpreter]") {
+    RecordedDriver x(200, 60);
+    RecordedDriver y(200, 60);
+    MultiAxisController controller({ x.driver, y.driver });
+    MultiAxisExecutor executor(controller);
+
+    vector<GcodeAxis> axes;
+    axes.push_back({ 'X', 0, 10, 0 });
+    axes.push_back({ 'Y', 1, 10, 0 });
+    GcodeConfig config;
+    config.acceleration = 5000;
+    GcodeInterpreter interpreter(executor, axes, config);
+
+    REQUIRE(runJob(interpreter, "G21 G90 F6000\nG1 X10 Y-5\nG2 I-5 J0\nG4 P10\nG0 X0 Y0\n"));
+
+    // 100 + 100 steps on x, and 50 + 50 on y, plus the circle of radius 50 steps
+    REQUIRE(x.a1.values.size() >= 400);
+    REQUIRE(y.a1.values.size() >= 300);
+    REQUIRE(x.driver->getPositionInDegrees() == 0.0);
+    REQUIRE(y.driver->getPositionInDegrees() == 0.0);
+    // The axes stay enabled for the whole job
+    REQUIRE(x.en.values.size() == 2);
+    REQUIRE(y.en.values.size() == 2);
+}
+
+TEST_CASE("GcodeInterpreter keeps the timing after arcs", "[GcodeInterpreter]") {
+    RecordedDriver x(200, 60);
+    RecordedDriver y(200, 60);
+    MultiAxisController controller({ x.driver, y.driver });
+    MultiAxisExecutor executor(controller);
+
+    vector<GcodeAxis> axes;
+    axes.push_back({ 'X', 0, 10, 0 });
+    axes.push_back({ 'Y', 1, 10, 0 });
+    GcodeConfig config;
+    config.acceleration = 5000;
+
+    // The arc's ticks add up to more than its length, which mustn't run the arc past the end of its profile
+    const string arc = "G21 G90 G1 F6000\nG2 X0 Y0 I5 J0\n";
+    const steady_clock::time_point start = steady_clock::now();
+    {
+        GcodeInterpreter interpreter(executor, axes, config);
+        REQUIRE(runJob(interpreter, arc + "G1 X5\n"));
+    }
+    const steady_clock::time_point withoutDwell = steady_clock::now();
+    {
+        GcodeInterpreter interpreter(executor, axes, config);
+        REQUIRE(runJob(interpreter, arc + "G4 P500\nG1 X5\n"));
+    }
+    const steady_clock::time_point withDwell = steady_clock::now();
+
+    // So the dwell after the arc still takes its time
+    const int64_t gapMillis = duration_cast<milliseconds>((withDwell - withoutDwell) - (withoutDwell - start)).count();
+    REQUIRE(gapMillis >= 450);
+    REQUIRE(gapMillis < 800);
+    // Both jobs started from where the interpreter thought was X0
+    REQUIRE(x.driver->getPosition() == 100);
+}
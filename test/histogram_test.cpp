@@ -0,0 +1,91 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <recorder.hpp>
+#include <histogram.hpp>
+#include <stepper.hpp>
+
+using namespace std;
+using namespace libstepper;
+
+TEST_CASE("LatencyHistogram buckets are log-linear", "[LatencyHistogram]") {
+    for (uint64_t i = 0; i < 32; ++i) {
+        REQUIRE(LatencyHistogram::getBucketIndex(i) == i);
+        REQUIRE(LatencyHistogram::getBucketUpperBound(i) == i);
+    }
+
+    // 32 to 63 are in buckets 2 wide, 64 to 127 in buckets 4 wide, and so on
+    REQUIRE(LatencyHistogram::getBucketIndex(32) == 32);
+    REQUIRE(LatencyHistogram::getBucketIndex(33) == 32);
+    REQUIRE(LatencyHistogram::getBucketUpperBound(32) == 33);
+    REQUIRE(LatencyHistogram::getBucketIndex(64) == 48);
+    REQUIRE(LatencyHistogram::getBucketIndex(67) == 48);
+    REQUIRE(LatencyHistogram::getBucketIndex(68) == 49);
+    REQUIRE(LatencyHistogram::getBucketIndex(UINT64_MAX) == LATENCY_HISTOGRAM_BUCKETS - 1);
+    REQUIRE(LatencyHistogram::getBucketUpperBound(LATENCY_HISTOGRAM_BUCKETS - 1) == UINT64_MAX);
+
+    // Every value is within its bucket's bounds, and the buckets are within 1/16 of their values
+    for (uint64_t value = 1; value < UINT64_MAX / 3; value = value * 3 + 1) {
+        const size_t index = LatencyHistogram::getBucketIndex(value);
+        REQUIRE(value <= LatencyHistogram::getBucketUpperBound(index));
+        REQUIRE(value > LatencyHistogram::getBucketUpperBound(index - 1));
+        REQUIRE(LatencyHistogram::getBucketUpperBound(index) - value <= value / 16);
+    }
+}
+
+TEST_CASE("LatencyHistogram reports percentiles", "[LatencyHistogram]") {
+    LatencyHistogram histogram;
+    REQUIRE(histogram.getCount() == 0);
+    REQUIRE(histogram.getPercentile(0.5) == 0);
+
+    for (uint64_t i = 1; i <= 1000; ++i) {
+        histogram.record(i);
+    }
+    REQUIRE(histogram.getCount() == 1000);
+    REQUIRE(histogram.getMax() == 1000);
+    REQUIRE(histogram.getPercentile(0.5) >= 500);
+    REQUIRE(histogram.getPercentile(0.5) <= 500 + 500 / 16);
+    REQUIRE(histogram.getPercentile(0.99) >= 990);
+    REQUIRE(histogram.getPercentile(0.999) == 1000);
+    REQUIRE(histogram.getPercentile(1) == 1000);
+    REQUIRE(histogram.getPercentile(0) == 1);
+
+    histogram.reset();
+    REQUIRE(histogram.getCount() == 0);
+    REQUIRE(histogram.getMax() == 0);
+}
+
+TEST_CASE("StepperDriver records its step lateness", "[LatencyHistogram]") {
+    auto en = SignalRecorder();
+    auto a1 = SignalRecorder();
+    auto a2 = SignalRecorder();
+    auto b1 = SignalRecorder();
+    auto b2 = SignalRecorder();
+    OversleepingClock clock(10);
+    LatencyHistogram histogram;
+    StepperDriver *driver = StepperDriverBuilder()
+        .setCoil1Terminal1(a1)
+        .setCoil1Terminal2(a2)
+        .setCoil2Terminal1(b1)
+        .setCoil2Terminal2(b2)
+        .setEnableTerminal(en)
+        .setRotationStepCount(200)
+        .setInitialRPM(60)
+        .setClock(clock)
+        .setJitterHistogram(histogram)
+        .build();
+
+    // Every sleep overshoots by 10 us, but the next sleep makes up for it, so it doesn't build up
+    REQUIRE(driver->step(100, CLOCKWISE));
+    REQUIRE(histogram.getCount() == 100);
+    REQUIRE(histogram.getMax() == 10);
+    REQUIRE(histogram.getPercentile(0.01) == 10);
+
+    REQUIRE(driver->step(100, COUNTER_CLOCKWISE));
+    REQUIRE(histogram.getCount() == 200);
+    REQUIRE(histogram.getMax() == 10);
+
+    delete driver;
+}
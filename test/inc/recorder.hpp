@@ -0,0 +1,108 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#pragma once
+
+#include <stepper.hpp>
+#include <signal.hpp>
+#include <clock.hpp>
+#include <vector>
+#include <stdint.h>
+
+// A mock, in-memory DigitalSignalConsumer that remembers every value written to it
+class SignalRecorder : public libstepper::DigitalSignalConsumer {
+public:
+    void write(bool value) {
+        values.push_back(value);
+    }
+
+    std::vector<bool> values;
+};
+
+// A virtual clock that sleeps a fixed time longer than asked to, on every sleep or on every n-th sleep
+class OversleepingClock : public libstepper::Clock {
+public:
+    explicit OversleepingClock(const uint64_t oversleepMicros, const uint64_t every = 1) : micros(0), sleeps(0), oversleepMicros(oversleepMicros), every(every) {
+    }
+
+    uint64_t nowMicros() {
+        return micros;
+    }
+
+    void sleepForMicros(const uint64_t micros) {
+        this->micros += micros + (++sleeps % every == 0 ? oversleepMicros : 0);
+    }
+
+private:
+    uint64_t micros;
+    uint64_t sleeps;
+    const uint64_t oversleepMicros;
+    const uint64_t every;
+};
+
+// A StepperDriver with its own terminals, for tests that need more than one driver, or settings that
+// BUILD_DRIVER doesn't have. The coil terminals are copies of coilTerminal.
+template <typename CoilTerminal, typename EnableTerminal = CoilTerminal>
+struct BasicRecordedDriver {
+    BasicRecordedDriver(const uint64_t rotationStepCount,
+                        const uint64_t initialRPM,
+                        const uint64_t maxSafeRPM = UINT64_MAX,
+                        libstepper::Clock &clock = libstepper::SteadyClock::getInstance()) {
+        libstepper::StepperDriverBuilder builder;
+        builder.setRotationStepCount(rotationStepCount)
+            .setInitialRPM(initialRPM)
+            .setMaxSafeRPM(maxSafeRPM)
+            .setClock(clock);
+        build(builder);
+    }
+
+    // Builds the driver with the rest of the builder's settings, which must include the rotation step count.
+    explicit BasicRecordedDriver(libstepper::StepperDriverBuilder &builder, const CoilTerminal &coilTerminal = CoilTerminal())
+        : a1(coilTerminal), a2(coilTerminal), b1(coilTerminal), b2(coilTerminal) {
+        build(builder);
+    }
+
+    ~BasicRecordedDriver() {
+        delete driver;
+    }
+
+    BasicRecordedDriver(const BasicRecordedDriver &rhs) = delete;
+
+    CoilTerminal a1;
+    CoilTerminal a2;
+    CoilTerminal b1;
+    CoilTerminal b2;
+    EnableTerminal en;
+    libstepper::StepperDriver *driver;
+
+private:
+    void build(libstepper::StepperDriverBuilder &builder) {
+        driver = builder.setCoil1Terminal1(a1)
+            .setCoil1Terminal2(a2)
+            .setCoil2Terminal1(b1)
+            .setCoil2Terminal2(b2)
+            .setEnableTerminal(en)
+            .build();
+    }
+};
+
+typedef BasicRecordedDriver<SignalRecorder> RecordedDriver;
+
+#define BUILD_DRIVER(rotationStepCount, initialRPM)                 \
+    auto a1 = SignalRecorder();                                     \
+    auto a2 = SignalRecorder();                                     \
+    auto b1 = SignalRecorder();                                     \
+    auto b2 = SignalRecorder();                                     \
+    auto en = SignalRecorder();                                     \
+    auto driver = StepperDriverBuilder()                            \
+        .setCoil1Terminal1(a1)                                      \
+        .setCoil1Terminal2(a2)                                      \
+        .setCoil2Terminal1(b1)                                      \
+        .setCoil2Terminal2(b2)                                      \
+        .setEnableTerminal(en)                                      \
+        .setRotationStepCount(rotationStepCount)                    \
+        .setInitialRPM(initialRPM)                                  \
+        .build();                                                   \
+
+#define ARE_CLOSE(a, b) (abs((double)(a) - (double)(b)) < numeric_limits<double>::epsilon())
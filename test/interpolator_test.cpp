@@ -0,0 +1,161 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <interpolator.hpp>
+#include <vector>
+#include <cmath>
+
+using namespace std;
+using namespace libstepper;
+
+TEST_CASE("LinearInterpolator interleaves the steps of a straight line", "[LinearInterpolator]") {
+    SECTION("Every axis takes exactly its steps, in its direction") {
+        const vector<int64_t> deltas = { 1000, -370, 0, 999 };
+        LinearInterpolator interpolator(deltas);
+        REQUIRE(interpolator.getAxisCount() == 4);
+        REQUIRE(interpolator.getTickCount() == 1000);
+
+        vector<int64_t> positions(4, 0);
+        int8_t steps[4];
+        uint64_t ticks = 0;
+        while (interpolator.next(steps)) {
+            ++ticks;
+            for (size_t i = 0; i < 4; ++i) {
+                REQUIRE((steps[i] >= -1 && steps[i] <= 1));
+                positions[i] += steps[i];
+            }
+            // The longest axis steps on every tick
+            REQUIRE(steps[0] == 1);
+        }
+
+        REQUIRE(ticks == 1000);
+        REQUIRE(positions == deltas);
+        REQUIRE(!interpolator.next(steps));
+    }
+
+    SECTION("The path stays within half a step of the ideal line") {
+        const vector<int64_t> deltas = { 701, 293 };
+        LinearInterpolator interpolator(deltas);
+
+        int64_t x = 0;
+        int64_t y = 0;
+        int8_t steps[2];
+        while (interpolator.next(steps)) {
+            x += steps[0];
+            y += steps[1];
+            const double idealY = (double) x * 293.0 / 701.0;
+            REQUIRE(fabs((double) y - idealY) <= 0.5 + 1e-9);
+        }
+        REQUIRE(x == 701);
+        REQUIRE(y == 293);
+    }
+
+    SECTION("Zero length moves have no ticks") {
+        LinearInterpolator interpolator(vector<int64_t>(3, 0));
+        int8_t steps[3];
+        REQUIRE(interpolator.getTickCount() == 0);
+        REQUIRE(!interpolator.next(steps));
+    }
+}
+
+struct ArcTrace {
+    vector<int64_t> xs;
+    vector<int64_t> ys;
+    uint64_t diagonalTicks;
+};
+
+static ArcTrace traceArc(ArcInterpolator &interpolator) {
+    ArcTrace trace;
+    trace.diagonalTicks = 0;
+    int64_t x = 0;
+    int64_t y = 0;
+    int8_t steps[3];
+    while (interpolator.next(steps)) {
+        REQUIRE(steps[2] == 0);
+        REQUIRE((steps[0] >= -1 && steps[0] <= 1));
+        REQUIRE((steps[1] >= -1 && steps[1] <= 1));
+        REQUIRE((steps[0] != 0 || steps[1] != 0));
+        if (steps[0] != 0 && steps[1] != 0) {
+            REQUIRE(interpolator.getTickWeight() == 181);
+            ++trace.diagonalTicks;
+        } else {
+            REQUIRE(interpolator.getTickWeight() == TICK_WEIGHT_UNIT);
+        }
+        x += steps[0];
+        y += steps[1];
+        trace.xs.push_back(x);
+        trace.ys.push_back(y);
+    }
+    return trace;
+}
+
+TEST_CASE("ArcInterpolator traces circular arcs with integer steps", "[ArcInterpolator]") {
+    const int64_t radius = 1000;
+
+    SECTION("Validates its arguments") {
+        REQUIRE_THROWS_AS(ArcInterpolator(2, 0, 0, 1, 1, 1, 0, CLOCKWISE), invalid_argument);
+        REQUIRE_THROWS_AS(ArcInterpolator(2, 0, 2, 1, 1, 1, 0, CLOCKWISE), invalid_argument);
+        REQUIRE_THROWS_AS(ArcInterpolator(2, 0, 1, 1, 0, 1, 0, CLOCKWISE), invalid_argument);
+    }
+
+    SECTION("Counter clockwise quarter circles stay on the circle and end at the end point") {
+        // Starts at (R, 0) relative to the center, and ends at (0, R)
+        ArcInterpolator interpolator(3, 0, 1, -radius, radius, -radius, 0, COUNTER_CLOCKWISE);
+        auto trace = traceArc(interpolator);
+
+        REQUIRE(trace.xs.back() == -radius);
+        REQUIRE(trace.ys.back() == radius);
+        for (size_t i = 0; i < trace.xs.size(); ++i) {
+            const double distance = hypot((double) (trace.xs[i] + radius), (double) trace.ys[i]);
+            REQUIRE(fabs(distance - (double) radius) <= 1.0);
+        }
+
+        // Roughly an octant of each axis-aligned and diagonal ticks: R * (2 - sqrt(2)) diagonal ticks
+        REQUIRE(trace.xs.size() > 1400);
+        REQUIRE(trace.xs.size() < 1420);
+        REQUIRE(trace.diagonalTicks > 580);
+        REQUIRE(trace.diagonalTicks < 600);
+    }
+
+    SECTION("Clockwise half circles go the other way around") {
+        // Starts at (-R, 0) relative to the center, and ends at (R, 0) over the top
+        ArcInterpolator interpolator(3, 0, 1, 2 * radius, 0, radius, 0, CLOCKWISE);
+        auto trace = traceArc(interpolator);
+
+        REQUIRE(trace.xs.back() == 2 * radius);
+        REQUIRE(trace.ys.back() == 0);
+        for (size_t i = 0; i < trace.xs.size(); ++i) {
+            REQUIRE(trace.ys[i] >= 0);
+        }
+    }
+
+    SECTION("End points equal to the start are full circles") {
+        ArcInterpolator interpolator(3, 0, 1, 0, 0, 0, radius, COUNTER_CLOCKWISE);
+        auto trace = traceArc(interpolator);
+
+        REQUIRE(trace.xs.back() == 0);
+        REQUIRE(trace.ys.back() == 0);
+        REQUIRE(trace.xs.size() > 4 * 1400);
+
+        int64_t minX = 0;
+        int64_t maxX = 0;
+        int64_t maxY = 0;
+        for (size_t i = 0; i < trace.xs.size(); ++i) {
+            minX = trace.xs[i] < minX ? trace.xs[i] : minX;
+            maxX = trace.xs[i] > maxX ? trace.xs[i] : maxX;
+            maxY = trace.ys[i] > maxY ? trace.ys[i] : maxY;
+        }
+        REQUIRE(minX == -radius);
+        REQUIRE(maxX == radius);
+        REQUIRE(maxY == 2 * radius);
+    }
+
+    SECTION("End points off the circle are still reached") {
+        ArcInterpolator interpolator(3, 0, 1, -radius + 3, radius + 2, -radius, 0, COUNTER_CLOCKWISE);
+        auto trace = traceArc(interpolator);
+        REQUIRE(trace.xs.back() == -radius + 3);
+        REQUIRE(trace.ys.back() == radius + 2);
+    }
+}
@@ -0,0 +1,145 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <recorder.hpp>
+#include <kinematics.hpp>
+#include <toolhead.hpp>
+#include <multiaxis.hpp>
+#include <stdexcept>
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+using namespace libstepper;
+
+static vector<int64_t> toMotorSteps(const Kinematics &kinematics, const double x, const double y, const double z) {
+    const double position[] = { x, y, z };
+    vector<int64_t> steps(kinematics.getMotorCount(), 0);
+    kinematics.toMotorSteps(position, steps.data());
+    return steps;
+}
+
+// Whether toPosition() maps the motor positions back to (x, y, z), to within tolerance mm
+static bool isAt(const Kinematics &kinematics, const vector<int64_t> &steps, const double x, const double y, const double z, const double tolerance) {
+    double position[KINEMATICS_COORDINATES];
+    kinematics.toPosition(steps.data(), position);
+    return abs(position[0] - x) <= tolerance && abs(position[1] - y) <= tolerance && abs(position[2] - z) <= tolerance;
+}
+
+TEST_CASE("CartesianKinematics maps every coordinate to its own motor", "[Kinematics]") {
+    REQUIRE_THROWS_AS(CartesianKinematics(80, 0, 400), invalid_argument);
+
+    CartesianKinematics kinematics(80, 100, 400);
+    REQUIRE(kinematics.isLinear());
+    REQUIRE(toMotorSteps(kinematics, 1, -2, 0.5) == vector<int64_t>({ 80, -200, 200 }));
+    REQUIRE(isAt(kinematics, { 80, -200, 200 }, 1, -2, 0.5, 0));
+}
+
+TEST_CASE("CoreXYKinematics moves x and y with both belt motors", "[Kinematics]") {
+    REQUIRE_THROWS_AS(CoreXYKinematics(-80, 400), invalid_argument);
+
+    CoreXYKinematics kinematics(80, 400);
+    REQUIRE(kinematics.isLinear());
+    // Both motors turn the same way for x, and opposite ways for y
+    REQUIRE(toMotorSteps(kinematics, 1, 0, 0) == vector<int64_t>({ 80, 80, 0 }));
+    REQUIRE(toMotorSteps(kinematics, 0, 1, 0) == vector<int64_t>({ 80, -80, 0 }));
+    REQUIRE(toMotorSteps(kinematics, 2, 1, 1) == vector<int64_t>({ 240, 80, 400 }));
+    REQUIRE(isAt(kinematics, { 240, 80, 400 }, 2, 1, 1, 0));
+}
+
+TEST_CASE("LinearDeltaKinematics raises the carriages by the rods' heights", "[Kinematics]") {
+    REQUIRE_THROWS_AS(LinearDeltaKinematics(100, 100, 80), invalid_argument);
+
+    // With 250 mm rods and towers 150 mm from the center, the rods are 200 mm tall at the center
+    LinearDeltaKinematics kinematics(150, 250, 10);
+    REQUIRE(!kinematics.isLinear());
+    REQUIRE(toMotorSteps(kinematics, 0, 0, 0) == vector<int64_t>({ 2000, 2000, 2000 }));
+    REQUIRE(toMotorSteps(kinematics, 0, 0, 5) == vector<int64_t>({ 2050, 2050, 2050 }));
+
+    // Towards the tower at 90 degrees, its carriage rises, and the others drop
+    const vector<int64_t> steps = toMotorSteps(kinematics, 0, 50, 0);
+    REQUIRE(steps[2] > 2000);
+    REQUIRE(steps[0] < 2000);
+    REQUIRE(steps[0] == steps[1]);
+
+    // And back, to within the steps' resolution
+    REQUIRE(isAt(kinematics, { 2000, 2000, 2000 }, 0, 0, 0, 1e-9));
+    REQUIRE(isAt(kinematics, steps, 0, 50, 0, 0.2));
+    REQUIRE(isAt(kinematics, toMotorSteps(kinematics, -30, 20, 7), -30, 20, 7, 0.2));
+
+    REQUIRE_THROWS_AS(toMotorSteps(kinematics, 0, -500, 0), invalid_argument);
+    REQUIRE_THROWS_AS(isAt(kinematics, { 0, 0, 8000 }, 0, 0, 0, 0), invalid_argument);
+}
+
+TEST_CASE("ToolheadController drives coordinated moves through kinematics", "[ToolheadController]") {
+    RecordedDriver a(200, 60);
+    RecordedDriver b(200, 60);
+    RecordedDriver c(200, 60);
+    MultiAxisController controller({ a.driver, b.driver, c.driver });
+
+    SECTION("Validation") {
+        MultiAxisController small({ a.driver });
+        CoreXYKinematics kinematics(10, 10);
+        REQUIRE_THROWS_AS(ToolheadController(small, kinematics), invalid_argument);
+        REQUIRE_THROWS_AS(ToolheadController(controller, kinematics, 0), invalid_argument);
+    }
+
+    SECTION("Linear kinematics make one segment per move") {
+        CoreXYKinematics kinematics(10, 10);
+        ToolheadController toolhead(controller, kinematics);
+
+        REQUIRE(toolhead.moveTo(5, 0, 0, 1000));
+        REQUIRE(toolhead.getSegmentCount() == 1);
+        REQUIRE(a.a1.values.size() == 50);
+        REQUIRE(b.a1.values.size() == 50);
+        REQUIRE(c.a1.values.size() == 0);
+        REQUIRE(toolhead.getPosition(0) == 5);
+        REQUIRE(!toolhead.moveTo(0, 0, 0, 0));
+    }
+
+    SECTION("Delta moves are segmented at the segment rate") {
+        LinearDeltaKinematics kinematics(150, 250, 10);
+        ToolheadController toolhead(controller, kinematics, 100);
+
+        // 10 mm at 100 mm/s takes 0.1 s, so it's 10 segments
+        REQUIRE(toolhead.moveTo(10, 0, 0, 100));
+        REQUIRE(toolhead.getSegmentCount() == 10);
+        REQUIRE(toolhead.moveTo(0, 0, 0, 100));
+        REQUIRE(toolhead.getSegmentCount() == 20);
+
+        // Back where it started, and enabled once for each move
+        REQUIRE(a.driver->getPositionInDegrees() == 0.0);
+        REQUIRE(b.driver->getPositionInDegrees() == 0.0);
+        REQUIRE(c.driver->getPositionInDegrees() == 0.0);
+        REQUIRE(a.en.values.size() == 4);
+
+        REQUIRE_THROWS_AS(toolhead.moveTo(0, -500, 0, 100), invalid_argument);
+        REQUIRE(toolhead.getPosition(0) == 0);
+    }
+
+    SECTION("Interrupted moves leave the toolhead where the motors stopped") {
+        CartesianKinematics kinematics(10, 10, 10);
+        ToolheadController toolhead(controller, kinematics);
+
+        // 100 mm at 10 mm/s, interrupted well before the end
+        thread interrupter([&controller] {
+            this_thread::sleep_for(milliseconds(50));
+            controller.interrupt();
+        });
+        REQUIRE(!toolhead.moveTo(100, 0, 0, 10));
+        interrupter.join();
+        REQUIRE(a.driver->getPosition() > 0);
+        REQUIRE(a.driver->getPosition() < 1000);
+        REQUIRE(toolhead.getPosition(0) == (double) a.driver->getPosition() / 10);
+
+        // So the next move still lands on its target
+        REQUIRE(toolhead.moveTo(5, 0, 0, 1000));
+        REQUIRE(a.driver->getPosition() == 50);
+        REQUIRE(toolhead.getPosition(0) == 5);
+    }
+}
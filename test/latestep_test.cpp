@@ -0,0 +1,131 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <recorder.hpp>
+#include <latestep.hpp>
+#include <stepper.hpp>
+#include <vector>
+
+using namespace std;
+using namespace libstepper;
+
+// 200 steps per rotation at 60 RPM, i.e. 5 ms per step
+static StepperDriverBuilder policyBuilder(Clock &clock, const LateStepPolicy policy, const uint64_t maxSafeRPM = UINT64_MAX) {
+    StepperDriverBuilder builder;
+    builder.setRotationStepCount(200)
+        .setInitialRPM(60)
+        .setMaxSafeRPM(maxSafeRPM)
+        .setClock(clock)
+        .setLateStepPolicy(policy);
+    return builder;
+}
+
+// Records when it's written, on a clock
+class TimestampRecorder : public DigitalSignalConsumer {
+public:
+    explicit TimestampRecorder(Clock &clock) : clock(&clock) {
+    }
+
+    void write(bool) {
+        micros.push_back(clock->nowMicros());
+    }
+
+    vector<uint64_t> micros;
+
+private:
+    Clock *clock;
+};
+
+TEST_CASE("SHIFT_SCHEDULE stretches the move by the delays", "[LateStepPolicy]") {
+    // Every 100th sleep is 20 steps late
+    OversleepingClock clock(100000, 100);
+    StepperDriverBuilder builder = policyBuilder(clock, SHIFT_SCHEDULE);
+    RecordedDriver motor(builder);
+
+    REQUIRE(motor.driver->step(590, CLOCKWISE));
+    const StepperStats stats = motor.driver->getStats();
+    REQUIRE(stats.missedDeadlines == 5);
+    REQUIRE(stats.enabledMicros == 590 * 5000 + 5 * 100000);
+}
+
+TEST_CASE("CATCH_UP makes up for the delays in bounded bursts", "[LateStepPolicy]") {
+    SECTION("Short delays are made up entirely") {
+        // 4 steps late, which is made up for at 120 RPM (2.5 ms per step)
+        OversleepingClock clock(20000, 100);
+        StepperDriverBuilder builder = policyBuilder(clock, CATCH_UP, 120);
+        RecordedDriver motor(builder);
+
+        REQUIRE(motor.driver->step(590, CLOCKWISE));
+        const StepperStats stats = motor.driver->getStats();
+        REQUIRE(stats.missedDeadlines > 5);
+        REQUIRE(stats.maxLatenessMicros == 20000);
+        REQUIRE(stats.enabledMicros == 590 * 5000);
+    }
+
+    SECTION("Long delays are made up for LATE_STEP_MAX_BURST steps") {
+        OversleepingClock clock(100000, 100);
+        StepperDriverBuilder builder = policyBuilder(clock, CATCH_UP, 120);
+        RecordedDriver motor(builder);
+
+        // By the next step, the move is 19 steps behind, and only LATE_STEP_MAX_BURST of them are made up
+        REQUIRE(motor.driver->step(590, CLOCKWISE));
+        REQUIRE(motor.driver->getStats().enabledMicros == 590 * 5000 + 5 * (100000 - 5000 - LATE_STEP_MAX_BURST * 5000));
+    }
+
+    SECTION("The late steps are never taken faster than the max safe RPM") {
+        // 70 RPM is 4285.7 us per step, which rounds up to 4286 us
+        OversleepingClock clock(20000, 100);
+        StepperDriverBuilder builder = policyBuilder(clock, CATCH_UP, 70);
+        BasicRecordedDriver<TimestampRecorder, SignalRecorder> motor(builder, TimestampRecorder(clock));
+
+        REQUIRE(motor.driver->step(590, CLOCKWISE));
+        uint64_t minIntervalMicros = UINT64_MAX;
+        for (size_t i = 1; i < motor.a1.micros.size(); ++i) {
+            const uint64_t interval = motor.a1.micros[i] - motor.a1.micros[i - 1];
+            minIntervalMicros = interval < minIntervalMicros ? interval : minIntervalMicros;
+        }
+        REQUIRE(minIntervalMicros == 4286);
+    }
+
+    SECTION("Without a max safe RPM, the late steps are taken back to back") {
+        OversleepingClock clock(20000, 100);
+        StepperDriverBuilder builder = policyBuilder(clock, CATCH_UP);
+        RecordedDriver motor(builder);
+
+        REQUIRE(motor.driver->step(590, CLOCKWISE));
+        const StepperStats stats = motor.driver->getStats();
+        REQUIRE(stats.enabledMicros == 590 * 5000);
+        REQUIRE(stats.missedDeadlines > 5);
+    }
+}
+
+TEST_CASE("DERATE slows down moves that keep missing their deadlines", "[LateStepPolicy]") {
+    // Every sleep is more than a step late, until the steps are 75% longer
+    OversleepingClock clock(6000);
+
+    SECTION("DERATE") {
+        StepperDriverBuilder builder = policyBuilder(clock, DERATE);
+        RecordedDriver motor(builder);
+        REQUIRE(motor.driver->step(100, CLOCKWISE));
+        StepperStats stats = motor.driver->getStats();
+        REQUIRE(stats.missedDeadlines == LATE_STEP_DERATE_MISSES);
+        REQUIRE(stats.derations == 1);
+
+        // Every move starts at the commanded speed
+        REQUIRE(motor.driver->step(100, CLOCKWISE));
+        stats = motor.driver->getStats();
+        REQUIRE(stats.missedDeadlines == 2 * LATE_STEP_DERATE_MISSES);
+        REQUIRE(stats.derations == 2);
+        REQUIRE(motor.driver->getRPM() == 60);
+    }
+
+    SECTION("SHIFT_SCHEDULE") {
+        StepperDriverBuilder builder = policyBuilder(clock, SHIFT_SCHEDULE);
+        RecordedDriver motor(builder);
+        REQUIRE(motor.driver->step(100, CLOCKWISE));
+        REQUIRE(motor.driver->getStats().missedDeadlines == 100);
+        REQUIRE(motor.driver->getStats().derations == 0);
+    }
+}
@@ -0,0 +1,263 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <recorder.hpp>
+#include <multiaxis.hpp>
+#include <exception.hpp>
+#include <stdexcept>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <functional>
+
+using namespace std;
+using namespace std::chrono;
+using namespace libstepper;
+
+static uint64_t timeMilliseconds(function<void(void)> runnable) {
+    auto now = steady_clock::now();
+    runnable();
+    return (uint64_t) duration_cast<milliseconds>(steady_clock::now() - now).count();
+}
+
+TEST_CASE("MultiAxisController validates its axes", "[MultiAxisController]") {
+    RecordedDriver x(200, 60);
+
+    REQUIRE_THROWS_AS(MultiAxisController(vector<StepperDriver *>()), invalid_argument);
+    REQUIRE_THROWS_AS(MultiAxisController(vector<StepperDriver *>({ x.driver, nullptr })), invalid_argument);
+
+    MultiAxisController controller({ x.driver });
+    REQUIRE(controller.getAxisCount() == 1);
+    REQUIRE(&controller.getAxis(0) == x.driver);
+    REQUIRE_THROWS_AS(controller.move({ 1, 2 }, 100), invalid_argument);
+}
+
+TEST_CASE("MultiAxisController drives coordinated linear moves", "[MultiAxisController]") {
+    RecordedDriver x(200, 60);
+    RecordedDriver y(200, 60);
+    MultiAxisController controller({ x.driver, y.driver });
+
+    SECTION("Every axis takes its steps, and they start and finish together") {
+        REQUIRE(controller.move({ 100, -50 }, 2000));
+
+        REQUIRE(x.a1.values.size() == 100);
+        REQUIRE(y.a1.values.size() == 50);
+        REQUIRE(x.driver->getPositionInDegrees() == 180.0);
+        REQUIRE(y.driver->getPositionInDegrees() == 270.0);
+
+        REQUIRE(x.en.values.size() == 2);
+        REQUIRE(y.en.values.size() == 2);
+
+        // Clockwise waveform on y: 1100, 1001, 0011, 0110
+        for (size_t i = 0; i < 50; ++i) {
+            REQUIRE(y.a1.values[i] == (i % 4 == 0 || i % 4 == 1));
+            REQUIRE(y.b2.values[i] == (i % 4 == 1 || i % 4 == 2));
+        }
+    }
+
+    SECTION("The longest axis runs at the requested rate") {
+        // 200 ticks at 1000 ticks/s
+        auto duration = timeMilliseconds([&controller] {
+            controller.move({ 50, 200 }, 1000);
+        });
+        REQUIRE(duration >= 200);
+        REQUIRE(duration < 400);
+    }
+
+    SECTION("Zero rates don't move") {
+        REQUIRE(!controller.move({ 10, 10 }, 0));
+        REQUIRE(x.a1.values.size() == 0);
+    }
+
+    SECTION("interrupt stops every axis") {
+        thread movingThread([&controller] {
+            controller.move({ 2000, 1000 }, 1000);
+        });
+
+        this_thread::sleep_for(milliseconds(200));
+        controller.interrupt();
+        movingThread.join();
+
+        REQUIRE(x.a1.values.size() < 1000);
+        REQUIRE(y.a1.values.size() < 500);
+        REQUIRE(!x.en.values.back());
+        REQUIRE(!y.en.values.back());
+    }
+}
+
+TEST_CASE("MultiAxisController respects the max safe RPM of every axis", "[MultiAxisController]") {
+    RecordedDriver x(200, 60);
+    // 60 RPM == 200 steps/s
+    RecordedDriver y(200, 60, 60);
+    MultiAxisController controller({ x.driver, y.driver });
+
+    // y would need 1000 steps/s, so the whole move slows down to let y take 200 steps/s
+    auto duration = timeMilliseconds([&controller] {
+        controller.move({ 100, 100 }, 1000);
+    });
+    REQUIRE(duration >= 500);
+    REQUIRE(x.a1.values.size() == 100);
+    REQUIRE(y.a1.values.size() == 100);
+}
+
+TEST_CASE("MultiAxisController slows down below 1 step per second if it has to", "[MultiAxisController]") {
+    // 1 RPM == 5/6 steps/s
+    RecordedDriver x(50, 1, 1);
+    MultiAxisController controller({ x.driver });
+
+    // Rather than rounding the rate down to 0 steps/s, and not moving at all
+    bool completed = false;
+    auto duration = timeMilliseconds([&controller, &completed] {
+        completed = controller.move({ 1 }, 1000);
+    });
+    REQUIRE(completed);
+    REQUIRE(duration >= 1150);
+    REQUIRE(x.a1.values.size() == 1);
+}
+
+TEST_CASE("MultiAxisController drives arcs", "[MultiAxisController]") {
+    RecordedDriver x(200, 60);
+    RecordedDriver y(200, 60);
+    RecordedDriver z(200, 60);
+    MultiAxisController controller({ x.driver, y.driver, z.driver });
+
+    // A full circle of radius 50 ends where it started
+    REQUIRE(controller.arc(0, 1, 0, 0, 50, 0, CLOCKWISE, 20000));
+    REQUIRE(x.driver->getPositionInDegrees() == 0.0);
+    REQUIRE(y.driver->getPositionInDegrees() == 0.0);
+    REQUIRE(x.a1.values.size() == 200);
+    REQUIRE(y.a1.values.size() == 200);
+    REQUIRE(z.a1.values.size() == 0);
+}
+
+TEST_CASE("MultiAxisController ramps along path profiles", "[MultiAxisController]") {
+    RecordedDriver x(200, 60);
+    RecordedDriver y(200, 60);
+    MultiAxisController controller({ x.driver, y.driver });
+
+    PathProfile profile;
+    profile.length = 200;
+    profile.distancePerTick = 1;
+    profile.entrySpeed = 0;
+    profile.cruiseSpeed = 2000;
+    profile.exitSpeed = 0;
+    profile.acceleration = 0;
+
+    SECTION("Without acceleration, the path runs at the cruise speed") {
+        LinearInterpolator interpolator({ 200, 100 });
+        auto duration = timeMilliseconds([&] {
+            REQUIRE(controller.run(interpolator, profile));
+        });
+        REQUIRE(duration >= 100);
+        REQUIRE(duration < 300);
+    }
+
+    SECTION("Accelerating from rest, and back to rest, takes longer") {
+        // 4000 steps/s^2 only reaches ~894 steps/s half way, so the move takes 2 * sqrt(100 / 2000) s
+        profile.acceleration = 4000;
+        LinearInterpolator interpolator({ 200, 100 });
+        auto duration = timeMilliseconds([&] {
+            REQUIRE(controller.run(interpolator, profile));
+        });
+        REQUIRE(duration >= 420);
+        REQUIRE(x.a1.values.size() == 200);
+        REQUIRE(y.a1.values.size() == 100);
+    }
+
+    SECTION("Profiles without a cruise speed don't move") {
+        profile.cruiseSpeed = 0;
+        LinearInterpolator interpolator({ 200, 100 });
+        REQUIRE(!controller.run(interpolator, profile));
+        REQUIRE(x.a1.values.size() == 0);
+    }
+}
+
+TEST_CASE("MultiAxisController keeps the axes enabled between begin() and end()", "[MultiAxisController]") {
+    RecordedDriver x(200, 60);
+    MultiAxisController controller({ x.driver });
+
+    REQUIRE_THROWS_AS(controller.end(), IllegalStateError);
+    controller.begin();
+    REQUIRE_THROWS_AS(controller.begin(), IllegalStateError);
+
+    REQUIRE(controller.move({ 20 }, 2000));
+    auto duration = timeMilliseconds([&controller] {
+        REQUIRE(controller.dwell(100000));
+    });
+    REQUIRE(controller.move({ -20 }, 2000));
+    controller.end();
+
+    REQUIRE(duration >= 90);
+    REQUIRE(x.a1.values.size() == 40);
+    REQUIRE(x.en.values.size() == 2);
+    REQUIRE(x.en.values[0]);
+    REQUIRE(!x.en.values[1]);
+}
+
+TEST_CASE("MultiAxisController doesn't burst after a gap", "[MultiAxisController]") {
+    RecordedDriver x(200, 60);
+    MultiAxisController controller({ x.driver });
+
+    // The schedule starts when the move does, not at begin()
+    controller.begin();
+    this_thread::sleep_for(milliseconds(300));
+    auto duration = timeMilliseconds([&controller] {
+        REQUIRE(controller.move({ 50 }, 100));
+    });
+    this_thread::sleep_for(milliseconds(300));
+    auto dwellDuration = timeMilliseconds([&controller] {
+        REQUIRE(controller.dwell(100000));
+    });
+    controller.end();
+
+    REQUIRE(duration >= 480);
+    REQUIRE(dwellDuration >= 90);
+}
+
+TEST_CASE("MultiAxisController scales synchronized moves to the limiting axis", "[MultiAxisController]") {
+    // 60 RPM == 200 steps/s, and 600 RPM == 2000 steps/s
+    RecordedDriver x(200, 60, 60);
+    RecordedDriver y(200, 600);
+    RecordedDriver z(200, 0);
+    MultiAxisController controller({ x.driver, y.driver, z.driver });
+
+    SECTION("Without acceleration, the slowest axis for its distance sets the duration") {
+        // x needs 0.5 s for 100 steps, and y only 0.2 s for 400
+        SynchronizedMove move = controller.planSynchronized({ 100, -400, 0 });
+        REQUIRE(move.durationMicros == 500000);
+        REQUIRE(move.profile.length == 400);
+        REQUIRE(move.profile.cruiseSpeed == 800);
+        REQUIRE(move.profile.acceleration == 0);
+
+        auto duration = timeMilliseconds([&controller] {
+            REQUIRE(controller.moveSynchronized({ 100, -400, 0 }));
+        });
+        REQUIRE(duration >= 500);
+        REQUIRE(duration < 700);
+        REQUIRE(x.a1.values.size() == 100);
+        REQUIRE(y.a1.values.size() == 400);
+    }
+
+    SECTION("Acceleration limits scale the same way") {
+        // 60 RPM/s == 200 steps/s^2. x can't reach 200 steps/s within 100 steps and back, so the move is a
+        // triangle of 2 * sqrt(100 / 200) s.
+        x.driver->setAcceleration(60);
+        SynchronizedMove move = controller.planSynchronized({ 100, 400, 0 });
+        REQUIRE(move.profile.acceleration == 800);
+        REQUIRE(move.durationMicros == 1414214);
+
+        // y's tighter acceleration limit for its distance takes over
+        y.driver->setAcceleration(30);
+        move = controller.planSynchronized({ 100, 400, 0 });
+        REQUIRE(move.profile.acceleration == 100);
+    }
+
+    SECTION("Axes that can't move stop the move") {
+        REQUIRE(controller.planSynchronized({ 10, 0, 10 }).profile.cruiseSpeed == 0);
+        REQUIRE(!controller.moveSynchronized({ 10, 0, 10 }));
+        REQUIRE(controller.moveSynchronized({ 0, 0, 0 }));
+        REQUIRE_THROWS_AS(controller.planSynchronized({ 10 }), invalid_argument);
+    }
+}
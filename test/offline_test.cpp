@@ -0,0 +1,214 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <recorder.hpp>
+#include <offline.hpp>
+#include <interpreter.hpp>
+#include <trajectory.hpp>
+#include <stdexcept>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+
+using namespace std;
+using namespace libstepper;
+
+static const char *OFFLINE_PATH = "libstepper-offline-test.bin";
+
+static void planJob(OfflinePlanner &planner, const string &job, const size_t threadCount) {
+    vector<GcodeAxis> axes;
+    axes.push_back({ 'X', 0, 10, 0 });
+    axes.push_back({ 'Y', 1, 10, 0 });
+    GcodeInterpreter interpreter(planner, axes);
+
+    istringstream input(job);
+    REQUIRE(interpreter.run(input));
+    planner.plan(threadCount);
+}
+
+static vector<OfflineAxis> getAxes() {
+    vector<OfflineAxis> axes;
+    axes.push_back({ 200, 0 });
+    axes.push_back({ 200, 0 });
+    return axes;
+}
+
+static uint64_t getStepCount(const vector<StepQueue> &queues) {
+    uint64_t count = 0;
+    for (size_t i = 0; i < queues.size(); ++i) {
+        count += queues[i].getStepCount();
+    }
+    return count;
+}
+
+TEST_CASE("OfflinePlanner validates its config", "[OfflinePlanner]") {
+    REQUIRE_THROWS_AS(OfflinePlanner(vector<OfflineAxis>()), invalid_argument);
+    REQUIRE_THROWS_AS(OfflinePlanner(getAxes(), 0), invalid_argument);
+
+    OfflinePlanner planner(getAxes());
+    REQUIRE_THROWS_AS(planner.write({ OFFLINE_PATH }), invalid_argument);
+}
+
+TEST_CASE("OfflinePlanner renders every axis's steps", "[OfflinePlanner]") {
+    OfflinePlanner planner(getAxes());
+    planJob(planner, "G1 X10 Y5 F600\nG1 X0\n", 1);
+
+    const vector<StepQueue> &x = planner.getQueues(0);
+    REQUIRE(x.size() == 2);
+    REQUIRE(x[0].getDirection() == COUNTER_CLOCKWISE);
+    REQUIRE(x[0].getStepCount() == 100);
+    REQUIRE(x[1].getDirection() == CLOCKWISE);
+    REQUIRE(x[1].getStepCount() == 100);
+
+    const vector<StepQueue> &y = planner.getQueues(1);
+    REQUIRE(y.size() == 1);
+    REQUIRE(y[0].getStepCount() == 50);
+}
+
+TEST_CASE("OfflinePlanner times the trapezoidal ramps", "[OfflinePlanner]") {
+    OfflinePlanner planner(getAxes());
+
+    // 10 mm/s, reached in 0.02 s over 0.1 mm at 500 mm/s^2, on both ends, and 9.8 mm of cruising
+    planJob(planner, "G1 X10 F600\n", 1);
+    REQUIRE(planner.getDurationMicros() == 1020000);
+
+    const StepQueue &queue = planner.getQueues(0)[0];
+    StepQueueDecoder decoder(queue.data(), queue.size());
+    vector<uint64_t> intervals;
+    uint64_t interval;
+    while (decoder.next(interval)) {
+        intervals.push_back(interval);
+    }
+
+    // 10 mm/s at 10 steps/mm is 1 step every 10 ms, and the first step (0.1 mm in) is at the end of the ramp
+    REQUIRE(intervals.size() == 100);
+    REQUIRE(intervals[0] == 20000);
+    REQUIRE(intervals[50] == 10000);
+}
+
+TEST_CASE("OfflinePlanner doesn't depend on the chunking", "[OfflinePlanner]") {
+    ostringstream job;
+    job << "F3000\n";
+    for (size_t i = 0; i < 200; ++i) {
+        if (i % 37 == 0) {
+            job << "G2 I1 J0\n";
+        } else if (i % 53 == 0) {
+            job << "G4 P10\n";
+        } else {
+            job << "G1 X" << (i % 20) * 0.5 << " Y" << (i % 7) * 0.3 << "\n";
+        }
+    }
+    job << "G1 X30\nX40\nX50\nX60\nX70\n";
+
+    OfflinePlanner whole(getAxes(), 100000);
+    planJob(whole, job.str(), 1);
+    OfflinePlanner chunked(getAxes(), 3);
+    planJob(chunked, job.str(), 4);
+
+    REQUIRE(whole.getBlocks().size() == chunked.getBlocks().size());
+    for (size_t i = 0; i < whole.getBlocks().size(); ++i) {
+        REQUIRE(whole.getBlocks()[i].entrySpeed == chunked.getBlocks()[i].entrySpeed);
+        REQUIRE(whole.getBlocks()[i].exitSpeed == chunked.getBlocks()[i].exitSpeed);
+        if (i > 0) {
+            REQUIRE(whole.getBlocks()[i].entrySpeed == whole.getBlocks()[i - 1].exitSpeed);
+        }
+    }
+    REQUIRE(whole.getDurationMicros() == chunked.getDurationMicros());
+
+    for (size_t axis = 0; axis < 2; ++axis) {
+        const vector<StepQueue> &expected = whole.getQueues(axis);
+        const vector<StepQueue> &actual = chunked.getQueues(axis);
+        REQUIRE(getStepCount(expected) == getStepCount(actual));
+        REQUIRE(expected.size() == actual.size());
+
+        for (size_t i = 0; i < expected.size(); ++i) {
+            REQUIRE(expected[i].getDirection() == actual[i].getDirection());
+            StepQueueDecoder expectedDecoder(expected[i].data(), expected[i].size());
+            StepQueueDecoder actualDecoder(actual[i].data(), actual[i].size());
+            uint64_t expectedInterval;
+            uint64_t actualInterval;
+            while (expectedDecoder.next(expectedInterval)) {
+                REQUIRE(actualDecoder.next(actualInterval));
+                REQUIRE(expectedInterval == actualInterval);
+            }
+            REQUIRE(!actualDecoder.next(actualInterval));
+        }
+    }
+
+    // The collinear moves at the end don't slow down at the chunk boundaries between them
+    const vector<PlannerBlock> &blocks = chunked.getBlocks();
+    for (size_t i = blocks.size() - 4; i < blocks.size(); ++i) {
+        REQUIRE(blocks[i].entrySpeed == blocks[i].nominalSpeed);
+    }
+    REQUIRE(blocks.back().exitSpeed == 0);
+}
+
+static vector<uint64_t> decodeAll(const vector<StepQueue> &queues) {
+    vector<uint64_t> intervals;
+    for (size_t i = 0; i < queues.size(); ++i) {
+        StepQueueDecoder decoder(queues[i].data(), queues[i].size());
+        uint64_t interval;
+        while (decoder.next(interval)) {
+            intervals.push_back(interval);
+        }
+    }
+    return intervals;
+}
+
+TEST_CASE("OfflinePlanner times every step after the one before it", "[OfflinePlanner]") {
+    // The arc's last ticks used to be timed at its end, all at once
+    OfflinePlanner planner(getAxes());
+    planJob(planner, "G1 F600\nG2 X0 Y0 I5 J0\nG4 P500\nG1 X5\n", 1);
+
+    for (size_t axis = 0; axis < 2; ++axis) {
+        const vector<uint64_t> intervals = decodeAll(planner.getQueues(axis));
+        REQUIRE(!intervals.empty());
+        for (size_t i = 0; i < intervals.size(); ++i) {
+            REQUIRE(intervals[i] > 0);
+        }
+    }
+}
+
+TEST_CASE("OfflinePlanner keeps dwells longer than a segment's interval", "[OfflinePlanner]") {
+    // 4300 s is past the 2^32 us that fit in a segment, on either side of a chunk boundary
+    const string job = "G1 X10 F600\nG4 S4300\nG1 X20\n";
+    OfflinePlanner whole(getAxes(), 100000);
+    planJob(whole, job, 1);
+    OfflinePlanner chunked(getAxes(), 1);
+    planJob(chunked, job, 2);
+
+    const vector<uint64_t> intervals = decodeAll(whole.getQueues(0));
+    REQUIRE(intervals.size() == 200);
+    REQUIRE(intervals[100] > 4300000000);
+    REQUIRE(intervals[100] < 4301000000);
+    REQUIRE(decodeAll(chunked.getQueues(0)) == intervals);
+}
+
+TEST_CASE("OfflinePlanner writes trajectory files for StepperDriver::play", "[OfflinePlanner]") {
+    OfflinePlanner planner(getAxes());
+    planJob(planner, "G1 X2 Y-1 F6000\nG1 X1\n", 2);
+
+    const string xPath = string("x-") + OFFLINE_PATH;
+    const string yPath = string("y-") + OFFLINE_PATH;
+    planner.write({ xPath, yPath });
+
+    RecordedDriver x(200, 60);
+    TrajectoryFile xTrajectory(xPath);
+    REQUIRE(xTrajectory.getStepCount() == 30);
+    REQUIRE(xTrajectory.getStepsInRotation() == 200);
+    REQUIRE(x.driver->play(xTrajectory));
+    // 20 steps counter clockwise, and 10 back
+    REQUIRE(x.driver->getPositionInDegrees() == 18.0);
+
+    RecordedDriver y(200, 60);
+    TrajectoryFile yTrajectory(yPath);
+    REQUIRE(yTrajectory.getStepCount() == 10);
+    REQUIRE(y.driver->play(yTrajectory));
+    REQUIRE(y.driver->getPositionInDegrees() == 342.0);
+
+    remove(xPath.c_str());
+    remove(yPath.c_str());
+}
@@ -0,0 +1,109 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <recorder.hpp>
+#include <stepper.hpp>
+#include <plancache.hpp>
+#include <memory>
+#include <stdexcept>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+using namespace libstepper;
+
+static shared_ptr<const StepQueue> makePlan(const uint32_t interval) {
+    auto plan = make_shared<StepQueue>();
+    plan->append(StepSegment { interval, 1, 0 });
+    return plan;
+}
+
+TEST_CASE("PlanCache is a least recently used cache", "[PlanCache]") {
+    REQUIRE_THROWS_AS(PlanCache(0), invalid_argument);
+
+    PlanCache cache(2);
+    const PlanKey first = { 100, 60, 0, 200 };
+    const PlanKey second = { 100, 120, 0, 200 };
+    const PlanKey third = { 100, 60, 0, 400 };
+
+    REQUIRE(!cache.find(first));
+    REQUIRE(cache.getMissCount() == 1);
+    REQUIRE(cache.getHitCount() == 0);
+
+    cache.insert(first, makePlan(1));
+    cache.insert(second, makePlan(2));
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.getCapacity() == 2);
+
+    // Uses first, so that second becomes the least recently used
+    REQUIRE(cache.find(first)->data()[0].interval == 1);
+    REQUIRE(cache.getHitCount() == 1);
+
+    cache.insert(third, makePlan(3));
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.find(first));
+    REQUIRE(cache.find(third));
+    REQUIRE(!cache.find(second));
+    REQUIRE(cache.getHitCount() == 3);
+    REQUIRE(cache.getMissCount() == 2);
+
+    cache.insert(third, makePlan(4));
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.find(third)->data()[0].interval == 4);
+
+    cache.clear();
+    REQUIRE(cache.size() == 0);
+    REQUIRE(!cache.find(third));
+}
+
+TEST_CASE("StepperDriver reuses cached plans for repeated moves", "[PlanCache]") {
+    PlanCache cache(8);
+    auto a1 = SignalRecorder();
+    auto a2 = SignalRecorder();
+    auto b1 = SignalRecorder();
+    auto b2 = SignalRecorder();
+    auto en = SignalRecorder();
+    auto driver = StepperDriverBuilder()
+        .setCoil1Terminal1(a1)
+        .setCoil1Terminal2(a2)
+        .setCoil2Terminal1(b1)
+        .setCoil2Terminal2(b2)
+        .setEnableTerminal(en)
+        .setRotationStepCount(200)
+        .setInitialRPM(600)
+        .setAcceleration(6000)
+        .setPlanCache(cache)
+        .build();
+
+    REQUIRE(driver->step(50, COUNTER_CLOCKWISE));
+    REQUIRE(cache.getMissCount() == 1);
+    REQUIRE(cache.getHitCount() == 0);
+
+    // The same move in the other direction reuses the plan
+    REQUIRE(driver->step(50, CLOCKWISE));
+    REQUIRE(driver->rotateBy(90.0, COUNTER_CLOCKWISE));
+    REQUIRE(cache.getMissCount() == 1);
+    REQUIRE(cache.getHitCount() == 2);
+    REQUIRE(ARE_CLOSE(driver->getPositionInDegrees(), 90.0));
+
+    REQUIRE(a1.values.size() == 150);
+    for (size_t i = 0; i < 50; ++i) {
+        // Counter clockwise waveform: 1100, 0110, 0011, 1001
+        REQUIRE(a1.values[i] == (i % 4 == 0 || i % 4 == 3));
+        REQUIRE(b1.values[i] == (i % 4 == 0 || i % 4 == 1));
+    }
+
+    // Any change to the profile is a different plan
+    driver->setRPM(300);
+    REQUIRE(driver->step(50, CLOCKWISE));
+    REQUIRE(cache.getMissCount() == 2);
+    REQUIRE(cache.size() == 2);
+
+    driver->setRPM(0);
+    REQUIRE(!driver->step(50, CLOCKWISE));
+    REQUIRE(cache.getMissCount() == 2);
+
+    delete driver;
+}
@@ -0,0 +1,62 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <recorder.hpp>
+#include <probe.hpp>
+#include <clock.hpp>
+#include <stdexcept>
+
+using namespace std;
+using namespace libstepper;
+
+TEST_CASE("LatencyProbe validates its arguments", "[LatencyProbe]") {
+    VirtualClock clock;
+    LatencyProbe probe(clock);
+    REQUIRE_THROWS_AS(probe.run(0, 1000), invalid_argument);
+    REQUIRE_THROWS_AS(probe.run(1000, 0), invalid_argument);
+    REQUIRE_THROWS_AS(probe.getSafeStepsPerSecond(0), invalid_argument);
+    REQUIRE_THROWS_AS(probe.getSafeStepsPerSecond(1.5), invalid_argument);
+    REQUIRE_THROWS_AS(probe.getSafeRPM(0, 0.1), invalid_argument);
+}
+
+TEST_CASE("LatencyProbe suggests a safe step rate from the p99.9 lateness", "[LatencyProbe]") {
+    SECTION("A host that never wakes up late is unbounded") {
+        VirtualClock clock;
+        LatencyProbe probe(clock);
+        probe.run(1000, 1000);
+        REQUIRE(probe.getHistogram().getCount() == 1000);
+        REQUIRE(probe.getHistogram().getMax() == 0);
+        REQUIRE(probe.getSafeStepsPerSecond(0.1) == UINT64_MAX);
+        REQUIRE(probe.getSafeRPM(200, 0.1) == UINT64_MAX);
+        // A wakeup every 1 ms, on schedule
+        REQUIRE(clock.nowMicros() == 1000 * 1000);
+    }
+
+    SECTION("Rare late wakeups set the rate") {
+        // 1 in 100 wakeups is 200 us late, so the p99 is on time, but the p99.9 isn't
+        OversleepingClock clock(200, 100);
+        LatencyProbe probe(clock);
+        probe.run(1000, 1000);
+        REQUIRE(probe.getHistogram().getPercentile(0.99) == 0);
+        REQUIRE(probe.getHistogram().getPercentile(0.999) == 200);
+
+        // Late by at most a tenth of the period, i.e. 2 ms, or 500 steps per second
+        REQUIRE(probe.getSafeStepsPerSecond(0.1) == 500);
+        REQUIRE(probe.getSafeRPM(200, 0.1) == 150);
+        REQUIRE(probe.getSafeStepsPerSecond(1) == 5000);
+
+        probe.reset();
+        REQUIRE(probe.getHistogram().getCount() == 0);
+    }
+
+    SECTION("A calibrated probe wakes up early like the drivers") {
+        OversleepingClock clock(200);
+        const TimingCalibration calibration = { 0, 200 };
+        LatencyProbe probe(clock, calibration);
+        probe.run(1000, 1000);
+        REQUIRE(probe.getHistogram().getMax() == 0);
+        REQUIRE(probe.getSafeStepsPerSecond(0.1) == UINT64_MAX);
+    }
+}
@@ -0,0 +1,83 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <recorder.hpp>
+#include <stepper.hpp>
+#include <profile.hpp>
+#include <stdexcept>
+
+using namespace std;
+using namespace libstepper;
+
+TEST_CASE("StepProfile computes trapezoidal step intervals", "[StepProfile]") {
+    SECTION("Rejects a zero RPM") {
+        REQUIRE_THROWS_AS(StepProfile(200, 0, 0), invalid_argument);
+    }
+
+    SECTION("Without acceleration, every step is at the cruise interval") {
+        StepProfile profile(200, 600, 0);
+        REQUIRE(profile.getCruiseIntervalMicros() == 500);
+        for (uint64_t i = 1; i <= 100; ++i) {
+            REQUIRE(profile.getIntervalMicros(i, 100) == 500);
+        }
+    }
+
+    SECTION("With acceleration, moves ramp up and down symmetrically") {
+        // 600 RPM/s at 200 steps/rotation == 2000 steps/s^2, so the first step takes sqrt(2/2000) s ~= 31623 us
+        StepProfile profile(200, 600, 600);
+        REQUIRE(profile.getIntervalMicros(1, 1000) == 31623);
+
+        uint64_t previous = UINT64_MAX - 1;
+        uint64_t totalMicros = 0;
+        for (uint64_t i = 1; i <= 500; ++i) {
+            const uint64_t interval = profile.getIntervalMicros(i, 1000);
+            // Rounding each step time to the microsecond may make neighbouring intervals differ by 1 the wrong way
+            REQUIRE(interval <= previous + 1);
+            REQUIRE(interval >= 500);
+            REQUIRE(interval == profile.getIntervalMicros(1000 - i + 1, 1000));
+            previous = interval;
+            totalMicros += interval;
+        }
+
+        // Reaching 2000 steps/s at 2000 steps/s^2 takes 1 s and 1000 steps, so a 1000 step move never cruises.
+        REQUIRE(profile.getIntervalMicros(500, 1000) > 500);
+        // Half of a triangle of 1000 steps takes sqrt(2 * 500/2000) s
+        REQUIRE(totalMicros > 707000);
+        REQUIRE(totalMicros < 708000);
+    }
+
+    SECTION("Long moves cruise at the RPM between the ramps") {
+        StepProfile profile(200, 600, 600);
+        REQUIRE(profile.getIntervalMicros(5000, 10000) == 500);
+        REQUIRE(profile.getIntervalMicros(10000, 10000) == 31623);
+    }
+}
+
+TEST_CASE("StepperDriver applies the acceleration to its moves", "[StepperDriver::setAcceleration]") {
+    BUILD_DRIVER(200, 600);
+
+    REQUIRE(driver->getAcceleration() == 0);
+    REQUIRE(driver->plan(10, CLOCKWISE)[0].timestampMicros == 500);
+
+    driver->setAcceleration(600);
+    REQUIRE(driver->getAcceleration() == 600);
+    auto timeline = driver->plan(10, CLOCKWISE);
+    REQUIRE(timeline[0].timestampMicros == 31623);
+    REQUIRE(timeline[9].timestampMicros - timeline[8].timestampMicros == 31623);
+
+    delete driver;
+
+    auto builtWithAcceleration = StepperDriverBuilder()
+        .setCoil1Terminal1(a1)
+        .setCoil1Terminal2(a2)
+        .setCoil2Terminal1(b1)
+        .setCoil2Terminal2(b2)
+        .setEnableTerminal(en)
+        .setRotationStepCount(200)
+        .setAcceleration(1200)
+        .build();
+    REQUIRE(builtWithAcceleration->getAcceleration() == 1200);
+    delete builtWithAcceleration;
+}
@@ -0,0 +1,105 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <recorder.hpp>
+#include <realtime.hpp>
+#include <stepper.hpp>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+using namespace libstepper;
+
+TEST_CASE("RealtimeConfig validates its settings", "[RealtimeConfig]") {
+    RealtimeConfig config;
+    REQUIRE_NOTHROW(config.validate());
+
+    config.policy = REALTIME_POLICY_FIFO;
+    REQUIRE_THROWS_AS(config.validate(), invalid_argument);
+    config.priority = 100;
+    REQUIRE_THROWS_AS(config.validate(), invalid_argument);
+    config.priority = 80;
+    REQUIRE_NOTHROW(config.validate());
+
+    config.policy = REALTIME_POLICY_DEADLINE;
+    config.runtimeMicros = 200;
+    config.deadlineMicros = 100;
+    config.periodMicros = 1000;
+    REQUIRE_THROWS_AS(config.validate(), invalid_argument);
+    config.deadlineMicros = 2000;
+    REQUIRE_THROWS_AS(config.validate(), invalid_argument);
+    config.deadlineMicros = 500;
+    REQUIRE_NOTHROW(config.validate());
+
+    config.cpu = -2;
+    REQUIRE_THROWS_AS(config.validate(), invalid_argument);
+    REQUIRE_THROWS_AS(applyRealtimeConfig(config), invalid_argument);
+    REQUIRE_THROWS_AS(StepperDriverBuilder().setRealtimeConfig(config), invalid_argument);
+}
+
+TEST_CASE("applyRealtimeConfig reports what it couldn't set up", "[RealtimeConfig]") {
+    // On its own thread, since the settings stick to the thread
+    RealtimeStatus empty;
+    RealtimeStatus status;
+    thread configured([&empty, &status] {
+        empty = applyRealtimeConfig(RealtimeConfig());
+
+        RealtimeConfig config;
+        config.policy = REALTIME_POLICY_FIFO;
+        config.priority = 10;
+        config.cpu = 0;
+        config.minimizeTimerSlack = true;
+        config.prefaultStackBytes = 64 * 1024;
+        status = applyRealtimeConfig(config);
+    });
+    configured.join();
+
+    REQUIRE(empty.applied);
+    REQUIRE(empty.failures.empty());
+
+    // Whether SCHED_FIFO is allowed depends on the privileges of the tests, but either way it doesn't throw
+    REQUIRE(status.applied == status.failures.empty());
+    for (size_t i = 0; i < status.failures.size(); ++i) {
+        REQUIRE(!status.failures[i].empty());
+    }
+}
+
+TEST_CASE("StepperDriver sets up the threads of its moves", "[RealtimeConfig]") {
+    RealtimeConfig config;
+    config.minimizeTimerSlack = true;
+    config.prefaultStackBytes = 64 * 1024;
+
+    SignalRecorder a1, a2, b1, b2, en;
+    StepperDriver *driver = StepperDriverBuilder()
+        .setCoil1Terminal1(a1)
+        .setCoil1Terminal2(a2)
+        .setCoil2Terminal1(b1)
+        .setCoil2Terminal2(b2)
+        .setEnableTerminal(en)
+        .setRotationStepCount(200)
+        .setInitialRPM(6000)
+        .setRealtimeConfig(config)
+        .build();
+
+    REQUIRE(driver->getRealtimeStatus().applied);
+
+    bool completed = false;
+    RealtimeStatus status;
+    thread stepping([driver, &completed, &status] {
+        completed = driver->step(10, COUNTER_CLOCKWISE);
+        status = driver->getRealtimeStatus();
+    });
+    stepping.join();
+
+    REQUIRE(completed);
+    REQUIRE(driver->getPosition() == 10);
+#ifdef __linux__
+    REQUIRE(status.applied);
+#else
+    REQUIRE(!status.applied);
+#endif
+
+    delete driver;
+}
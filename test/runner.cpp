@@ -5,4 +5,6 @@
 // This file is needed by the Catch testing library to configure the test runner.
 // Don't add new tests here.
 #define CATCH_CONFIG_MAIN
+// glibc >= 2.34 no longer makes SIGSTKSZ a constant, which the bundled Catch relies on.
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
 #include <catch.hpp>
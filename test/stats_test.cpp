@@ -0,0 +1,128 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <recorder.hpp>
+#include <stats.hpp>
+#include <multiaxis.hpp>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <chrono>
+
+using namespace std;
+using namespace std::chrono;
+using namespace libstepper;
+
+TEST_CASE("StepperDriver::getStats counts steps and moves", "[StepperDriver::getStats]") {
+    VirtualClock clock;
+    RecordedDriver motor(200, 60, UINT64_MAX, clock);
+    StepperDriver *driver = motor.driver;
+
+    StepperStats stats = driver->getStats();
+    REQUIRE(stats.clockwiseSteps == 0);
+    REQUIRE(stats.completedMoves == 0);
+    REQUIRE(stats.enabledMicros == 0);
+
+    REQUIRE(driver->step(100, CLOCKWISE));
+    REQUIRE(driver->rotateBy(18, COUNTER_CLOCKWISE));
+    REQUIRE(driver->play(driver->compile(30, COUNTER_CLOCKWISE)));
+
+    stats = driver->getStats();
+    REQUIRE(stats.clockwiseSteps == 100);
+    REQUIRE(stats.counterClockwiseSteps == 40);
+    REQUIRE(stats.completedMoves == 3);
+    REQUIRE(stats.interruptedMoves == 0);
+    // 5 ms per step, on time
+    REQUIRE(stats.enabledMicros == 140 * 5000);
+    REQUIRE(stats.missedDeadlines == 0);
+    REQUIRE(stats.maxLatenessMicros == 0);
+    REQUIRE(stats.stepsPerSecond == 0.0);
+
+    thread driving([driver] {
+        driver->drive(CLOCKWISE);
+    });
+    while (driver->getStats().clockwiseSteps < 1000) {
+        this_thread::yield();
+    }
+    // Readable mid-move, from another thread
+    stats = driver->getStats();
+    REQUIRE(stats.stepsPerSecond == 200.0);
+    REQUIRE(stats.enabledMicros >= 140 * 5000 + 900 * 5000);
+    driver->interrupt();
+    driving.join();
+
+    stats = driver->getStats();
+    REQUIRE(stats.completedMoves == 3);
+    REQUIRE(stats.interruptedMoves == 1);
+    REQUIRE(stats.enabledMicros == (stats.clockwiseSteps + stats.counterClockwiseSteps) * 5000);
+}
+
+TEST_CASE("StepperDriver::getStats counts missed deadlines", "[StepperDriver::getStats]") {
+    // Every 100th sleep oversleeps by 4 steps
+    OversleepingClock clock(20000, 100);
+    RecordedDriver motor(200, 60, UINT64_MAX, clock);
+
+    REQUIRE(motor.driver->step(600, CLOCKWISE));
+    const StepperStats stats = motor.driver->getStats();
+    REQUIRE(stats.missedDeadlines == 6);
+    REQUIRE(stats.maxLatenessMicros == 20000);
+    REQUIRE(stats.enabledMicros == 600 * 5000 + 6 * 20000);
+}
+
+TEST_CASE("StepperDriver::getStats counts pulsed steps", "[StepperDriver::getStats]") {
+    RecordedDriver x(200, 60);
+    RecordedDriver y(200, 60);
+    MultiAxisController controller({ x.driver, y.driver });
+
+    REQUIRE(controller.move({ 40, -20 }, 4000));
+    REQUIRE(x.driver->getStats().counterClockwiseSteps == 40);
+    REQUIRE(y.driver->getStats().clockwiseSteps == 20);
+    // Not the drivers' own moves
+    REQUIRE(x.driver->getStats().completedMoves == 0);
+    REQUIRE(x.driver->getStats().enabledMicros >= 9000);
+}
+
+TEST_CASE("writePrometheus writes the exposition format", "[writePrometheus]") {
+    StepperStats stats;
+    stats.clockwiseSteps = 12;
+    stats.counterClockwiseSteps = 34;
+    stats.completedMoves = 5;
+    stats.interruptedMoves = 1;
+    stats.enabledMicros = 2500000;
+    stats.missedDeadlines = 7;
+    stats.maxLatenessMicros = 1500;
+    stats.derations = 2;
+    stats.stepsPerSecond = 200;
+
+    ostringstream output;
+    writePrometheus(output, { make_pair(string("x"), stats), make_pair(string("the \"y\""), stats) });
+    const string text = output.str();
+
+    REQUIRE(text.find("# TYPE libstepper_steps_total counter\n") != string::npos);
+    REQUIRE(text.find("libstepper_steps_total{motor=\"x\",direction=\"clockwise\"} 12\n") != string::npos);
+    REQUIRE(text.find("libstepper_steps_total{motor=\"x\",direction=\"counter_clockwise\"} 34\n") != string::npos);
+    REQUIRE(text.find("libstepper_moves_total{motor=\"x\",result=\"interrupted\"} 1\n") != string::npos);
+    REQUIRE(text.find("libstepper_enabled_seconds_total{motor=\"x\"} 2.5\n") != string::npos);
+    REQUIRE(text.find("libstepper_missed_deadlines_total{motor=\"x\"} 7\n") != string::npos);
+    REQUIRE(text.find("libstepper_max_lateness_seconds{motor=\"x\"} 0.0015\n") != string::npos);
+    REQUIRE(text.find("libstepper_derations_total{motor=\"x\"} 2\n") != string::npos);
+    REQUIRE(text.find("libstepper_step_rate{motor=\"the \\\"y\\\"\"} 200\n") != string::npos);
+
+    // Long enabled times keep their microseconds, and the caller's formatting doesn't matter
+    stats.enabledMicros = 86400123456;
+    stats.maxLatenessMicros = 20;
+    stats.stepsPerSecond = 1234.5;
+    ostringstream longOutput;
+    longOutput << fixed << setprecision(1);
+    writePrometheus(longOutput, "z", stats);
+    const string longText = longOutput.str();
+    REQUIRE(longText.find("libstepper_enabled_seconds_total{motor=\"z\"} 86400.123456\n") != string::npos);
+    REQUIRE(longText.find("libstepper_max_lateness_seconds{motor=\"z\"} 0.00002\n") != string::npos);
+    REQUIRE(longText.find("libstepper_step_rate{motor=\"z\"} 1234.5\n") != string::npos);
+
+    // Each family is described once, however many motors there are
+    REQUIRE(text.find("# HELP libstepper_steps_total") == text.rfind("# HELP libstepper_steps_total"));
+}
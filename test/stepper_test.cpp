@@ -3,6 +3,7 @@
 */
 
 #include <catch.hpp>
+#include <recorder.hpp>
 #include <stepper.hpp>
 #include <exception.hpp>
 #include <vector>
@@ -12,38 +13,12 @@
 #include <cmath>
 #include <limits>
 #include <functional>
+#include <stdexcept>
 
 using namespace std;
 using namespace libstepper;
 using namespace std::chrono;
 
-class SignalRecorder : public DigitalSignalConsumer {
-public:
-    void write(bool value) {
-        values.push_back(value);
-    }
-
-    vector<bool> values;
-};
-
-#define BUILD_DRIVER(rotationStepCount, initialRPM)                 \
-    auto a1 = SignalRecorder();                                     \
-    auto a2 = SignalRecorder();                                     \
-    auto b1 = SignalRecorder();                                     \
-    auto b2 = SignalRecorder();                                     \
-    auto en = SignalRecorder();                                     \
-    auto driver = StepperDriverBuilder()                            \
-        .setCoil1Terminal1(a1)                                      \
-        .setCoil1Terminal2(a2)                                      \
-        .setCoil2Terminal1(b1)                                      \
-        .setCoil2Terminal2(b2)                                      \
-        .setEnableTerminal(en)                                      \
-        .setRotationStepCount(rotationStepCount)                    \
-        .setInitialRPM(initialRPM)                                  \
-        .build();                                                   \
-
-#define ARE_CLOSE(a, b) (abs((double)(a) - (double)(b)) < numeric_limits<double>::epsilon())
-
 TEST_CASE("StepperDriverBuilder configures the StepperDriver correctly", "[StepperDriverBuilder]") {
     auto builder = StepperDriverBuilder();
 
@@ -533,7 +508,8 @@ TEST_CASE("StepperDriver::interrupt works", "[StepperDriver::interrupt]") {
             driver->step(1200, COUNTER_CLOCKWISE);
         });
 
-        this_thread::sleep_for(seconds(1));
+        // Steps are taken on schedule, so the 200th is due at exactly 1 second. Interrupt a little before that.
+        this_thread::sleep_for(milliseconds(950));
         driver->interrupt();
         drivingThread.join();
 
@@ -547,8 +523,8 @@ TEST_CASE("StepperDriver::interrupt works", "[StepperDriver::interrupt]") {
         REQUIRE(a2.values.size() < 200);
         REQUIRE(b2.values.size() < 200);
 
-        // 1200 steps = 6 rotations. velocity = 1 rotation per second. In 1 second, around 1 rotation = 200 steps.
-        // Accounting for scheduling timing issues, should not have exceeded 200 steps.
+        // 1200 steps = 6 rotations. velocity = 1 rotation per second. In 0.95 seconds, around 190 steps.
+        // Accounting for scheduling timing issues, should not have reached 200 steps.
     }
 
     SECTION("interrupt works for rotateBy") {
@@ -556,7 +532,8 @@ TEST_CASE("StepperDriver::interrupt works", "[StepperDriver::interrupt]") {
             driver->rotateBy(6*360, COUNTER_CLOCKWISE);
         });
 
-        this_thread::sleep_for(seconds(1));
+        // Steps are taken on schedule, so the 200th is due at exactly 1 second. Interrupt a little before that.
+        this_thread::sleep_for(milliseconds(950));
         driver->interrupt();
         drivingThread.join();
 
@@ -570,8 +547,8 @@ TEST_CASE("StepperDriver::interrupt works", "[StepperDriver::interrupt]") {
         REQUIRE(a2.values.size() < 200);
         REQUIRE(b2.values.size() < 200);
 
-        // 6 rotations. velocity = 1 rotation per second. In 1 second, around 1 rotation = 200 steps.
-        // Accounting for scheduling timing issues, should not have exceeded 200 steps.
+        // 6 rotations. velocity = 1 rotation per second. In 0.95 seconds, around 190 steps.
+        // Accounting for scheduling timing issues, should not have reached 200 steps.
     }
 
     delete driver;
@@ -698,7 +675,8 @@ TEST_CASE("StepperDriver::getPositionInDegrees works", "[StepperDriver::getPosit
             driver->drive(COUNTER_CLOCKWISE);
         });
 
-        this_thread::sleep_for(milliseconds(250));
+        // Stop short of the 50th step (90 degrees), which is due at exactly 250 ms
+        this_thread::sleep_for(milliseconds(240));
         driver->interrupt();
         drivingThread.join();
 
@@ -711,7 +689,8 @@ TEST_CASE("StepperDriver::getPositionInDegrees works", "[StepperDriver::getPosit
             driver->drive(CLOCKWISE);
         });
 
-        this_thread::sleep_for(milliseconds(500));
+        // Stop short of the 100th step (180 degrees back), which is due at exactly 500 ms
+        this_thread::sleep_for(milliseconds(480));
         driver->interrupt();
         drivingThread.join();
 
@@ -720,4 +699,122 @@ TEST_CASE("StepperDriver::getPositionInDegrees works", "[StepperDriver::getPosit
     }
 
     delete driver;
-}
\ No newline at end of file
+}
+
+TEST_CASE("StepperDriver::getPosition counts whole turns", "[StepperDriver::getPosition]") {
+    BUILD_DRIVER(200, 6000);
+
+    REQUIRE(driver->getPosition() == 0);
+    driver->step(450, COUNTER_CLOCKWISE);
+    REQUIRE(driver->getPosition() == 450);
+    REQUIRE(ARE_CLOSE(driver->getPositionInDegrees(), 90.0));
+    driver->step(700, CLOCKWISE);
+    REQUIRE(driver->getPosition() == -250);
+    driver->rotateBy(-720, COUNTER_CLOCKWISE);
+    REQUIRE(driver->getPosition() == -650);
+
+    delete driver;
+}
+
+TEST_CASE("StepperDriver::moveTo works", "[StepperDriver::moveTo]") {
+    BUILD_DRIVER(200, 6000);
+
+    REQUIRE(driver->moveTo(530));
+    REQUIRE(driver->getPosition() == 530);
+    REQUIRE(driver->moveTo(-70));
+    REQUIRE(driver->getPosition() == -70);
+    REQUIRE(a1.values.size() == 1130);
+
+    // Already there
+    REQUIRE(driver->moveTo(-70));
+    REQUIRE(a1.values.size() == 1130);
+
+    delete driver;
+}
+
+TEST_CASE("StepperDriver::moveToAngle takes the shorter way", "[StepperDriver::moveToAngle]") {
+    BUILD_DRIVER(200, 6000);
+
+    REQUIRE(driver->moveToAngle(90));
+    REQUIRE(driver->getPosition() == 50);
+
+    // 351 degrees is 99 degrees clockwise, rather than 261 counter clockwise
+    REQUIRE(driver->moveToAngle(351));
+    REQUIRE(driver->getPosition() == -5);
+    REQUIRE(ARE_CLOSE(driver->getPositionInDegrees(), 351.0));
+
+    // Angles outside [0, 360) wrap around
+    REQUIRE(driver->moveToAngle(-720 + 9));
+    REQUIRE(driver->getPosition() == 5);
+    REQUIRE(driver->moveToAngle(1080 + 180 + 9));
+    REQUIRE(driver->getPosition() == 105);
+
+    // Never more than half a turn, even across many turns
+    driver->step(1000, COUNTER_CLOCKWISE);
+    REQUIRE(driver->moveToAngle(0));
+    REQUIRE(driver->getPosition() == 1200);
+    REQUIRE(a1.values.size() == 50 + 55 + 10 + 100 + 1000 + 95);
+
+    delete driver;
+}
+
+TEST_CASE("StepperDriver::rotateBy doesn't drift on small rotations", "[StepperDriver::rotateBy]") {
+    BUILD_DRIVER(200, 6000);
+
+    // 0.9 degrees is half a step, which used to be truncated away on every call
+    for (size_t i = 0; i < 40; ++i) {
+        REQUIRE(driver->rotateBy(0.9, COUNTER_CLOCKWISE));
+    }
+    REQUIRE(driver->getPosition() == 20);
+    REQUIRE(a1.values.size() == 20);
+
+    for (size_t i = 0; i < 40; ++i) {
+        REQUIRE(driver->rotateBy(-0.9, COUNTER_CLOCKWISE));
+    }
+    REQUIRE(driver->getPosition() == 0);
+
+    delete driver;
+}
+
+TEST_CASE("StepperDriver waits on its clock", "[StepperDriver::setClock]") {
+    auto en = SignalRecorder();
+    auto a1 = SignalRecorder();
+    auto a2 = SignalRecorder();
+    auto b1 = SignalRecorder();
+    auto b2 = SignalRecorder();
+    VirtualClock clock;
+    StepperDriver *driver = StepperDriverBuilder()
+        .setCoil1Terminal1(a1)
+        .setCoil1Terminal2(a2)
+        .setCoil2Terminal1(b1)
+        .setCoil2Terminal2(b2)
+        .setEnableTerminal(en)
+        .setRotationStepCount(200)
+        .setInitialRPM(6)
+        .setClock(clock)
+        .build();
+
+    // 100 s at 50 ms per step, on the virtual clock only
+    const steady_clock::time_point start = steady_clock::now();
+    REQUIRE(driver->step(2000, CLOCKWISE));
+    REQUIRE(clock.nowMicros() == 100000000);
+    REQUIRE(steady_clock::now() - start < seconds(10));
+    REQUIRE(a1.values.size() == 2000);
+
+    delete driver;
+}
+
+TEST_CASE("StepperDriver validates the direction before a move", "[StepperDriver]") {
+    BUILD_DRIVER(200, 60);
+    const RotationDirection unknown = (RotationDirection) 7;
+    REQUIRE_THROWS_AS(driver->step(10, unknown), IllegalStateError);
+    REQUIRE_THROWS_AS(driver->plan(10, unknown), IllegalStateError);
+    REQUIRE_THROWS_AS(driver->compile(10, unknown), IllegalStateError);
+    REQUIRE_THROWS_AS(StepperDriverBuilder().setLateStepPolicy((LateStepPolicy) 7), invalid_argument);
+
+    // Nothing was written, not even the enable terminal
+    REQUIRE(en.values.empty());
+    REQUIRE(a1.values.empty());
+    REQUIRE(driver->getPosition() == 0);
+    delete driver;
+}
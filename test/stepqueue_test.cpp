@@ -0,0 +1,228 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <recorder.hpp>
+#include <stepper.hpp>
+#include <stepqueue.hpp>
+#include <exception.hpp>
+#include <vector>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+using namespace libstepper;
+
+static vector<uint64_t> decodeAll(const StepQueue &queue) {
+    vector<uint64_t> intervals;
+    StepQueueDecoder decoder(queue.data(), queue.size());
+    uint64_t interval;
+    while (decoder.next(interval)) {
+        intervals.push_back(interval);
+    }
+    return intervals;
+}
+
+TEST_CASE("StepQueueEncoder compresses step intervals into segments", "[StepQueueEncoder]") {
+    SECTION("Constant intervals take one segment") {
+        StepQueue queue(CLOCKWISE);
+        StepQueueEncoder encoder(queue);
+        for (int i = 0; i < 100000; ++i) {
+            encoder.push(500);
+        }
+        encoder.flush();
+
+        REQUIRE(queue.size() == 1);
+        REQUIRE(queue[0].interval == 500);
+        REQUIRE(queue[0].count == 100000);
+        REQUIRE(queue[0].add == 0);
+        REQUIRE(queue.getStepCount() == 100000);
+    }
+
+    SECTION("Linearly changing intervals take one segment") {
+        StepQueue queue(CLOCKWISE);
+        StepQueueEncoder encoder(queue);
+        for (int i = 0; i < 50; ++i) {
+            encoder.push((uint64_t) (1000 - 7 * i));
+        }
+        encoder.flush();
+
+        REQUIRE(queue.size() == 1);
+        REQUIRE(queue[0].interval == 1000);
+        REQUIRE(queue[0].add == -7);
+        REQUIRE(queue[0].count == 50);
+    }
+
+    SECTION("Lossless encoding regenerates the exact intervals") {
+        const uint64_t input[] = { 900, 30, 30, 30, 1000, 4, 2, 0, 0, 17, 17, 17, 17, 5000 };
+        const size_t count = sizeof(input)/sizeof(input[0]);
+
+        StepQueue queue(COUNTER_CLOCKWISE);
+        StepQueueEncoder encoder(queue);
+        for (size_t i = 0; i < count; ++i) {
+            encoder.push(input[i]);
+        }
+        encoder.flush();
+
+        REQUIRE(queue.getDirection() == COUNTER_CLOCKWISE);
+        REQUIRE(queue.getStepCount() == count);
+        REQUIRE(decodeAll(queue) == vector<uint64_t>(input, input + count));
+    }
+
+    SECTION("Lossy encoding keeps every step within the error bound") {
+        StepQueue exact(CLOCKWISE);
+        StepQueue lossy(CLOCKWISE);
+        StepQueueEncoder exactEncoder(exact);
+        StepQueueEncoder lossyEncoder(lossy, 2);
+        vector<uint64_t> input;
+        for (int i = 1; i <= 2000; ++i) {
+            // A curve that isn't linear in the intervals, like an acceleration ramp
+            const uint64_t interval = (uint64_t) llround(100000.0 * (sqrt((double) i) - sqrt((double) (i - 1))));
+            input.push_back(interval);
+            exactEncoder.push(interval);
+            lossyEncoder.push(interval);
+        }
+        exactEncoder.flush();
+        lossyEncoder.flush();
+
+        REQUIRE(decodeAll(exact) == input);
+        REQUIRE(lossy.size() < exact.size());
+        REQUIRE(lossy.getStepCount() == 2000);
+
+        const vector<uint64_t> output = decodeAll(lossy);
+        REQUIRE(output.size() == input.size());
+        int64_t expectedTime = 0;
+        int64_t actualTime = 0;
+        for (size_t i = 0; i < input.size(); ++i) {
+            expectedTime += (int64_t) input[i];
+            actualTime += (int64_t) output[i];
+            REQUIRE(abs(expectedTime - actualTime) <= 2);
+        }
+    }
+
+    SECTION("Lossy encoding of quickly shrinking intervals never goes negative") {
+        const uint64_t input[] = { 1000, 50, 35, 25, 5, 10, 7, 12, 4, 1, 0, 0 };
+        const size_t count = sizeof(input)/sizeof(input[0]);
+
+        StepQueue queue(CLOCKWISE);
+        StepQueueEncoder encoder(queue, 50);
+        for (size_t i = 0; i < count; ++i) {
+            encoder.push(input[i]);
+        }
+        encoder.flush();
+
+        // Negative intervals would have been decoded as huge unsigned ones
+        const vector<uint64_t> output = decodeAll(queue);
+        REQUIRE(output.size() == count);
+        int64_t expectedTime = 0;
+        int64_t actualTime = 0;
+        for (size_t i = 0; i < count; ++i) {
+            REQUIRE(output[i] <= 1000);
+            expectedTime += (int64_t) input[i];
+            actualTime += (int64_t) output[i];
+            REQUIRE(abs(expectedTime - actualTime) <= 50);
+        }
+    }
+
+    SECTION("Intervals too long for a segment wait out the excess") {
+        const uint64_t longInterval = 3 * (uint64_t) UINT32_MAX + 12345;
+        const uint64_t input[] = { 100, 100, longInterval, 100, (uint64_t) UINT32_MAX + 1 };
+        const size_t count = sizeof(input)/sizeof(input[0]);
+
+        StepQueue queue(CLOCKWISE);
+        StepQueueEncoder encoder(queue);
+        for (size_t i = 0; i < count; ++i) {
+            encoder.push(input[i]);
+        }
+        encoder.flush();
+
+        REQUIRE(queue.getStepCount() == count);
+        REQUIRE(queue[1].count == 0);
+        REQUIRE(decodeAll(queue) == vector<uint64_t>(input, input + count));
+
+        // Waits at the end of some segments are carried into the next ones
+        size_t split = 0;
+        while (queue[split].count != 0) {
+            ++split;
+        }
+        StepQueueDecoder first(queue.data(), split + 1);
+        uint64_t interval;
+        REQUIRE(first.next(interval));
+        REQUIRE(first.next(interval));
+        REQUIRE(!first.next(interval));
+        REQUIRE(first.getWaitMicros() == queue[split].interval);
+        StepQueueDecoder second(queue.data() + split + 1, queue.size() - split - 1, first.getWaitMicros());
+        REQUIRE(second.next(interval));
+        REQUIRE(interval == longInterval);
+    }
+
+    SECTION("Timelines can be encoded") {
+        StepTimeline timeline(COUNTER_CLOCKWISE, 0);
+        timeline.append(100, 0x0C);
+        timeline.append(200, 0x06);
+        timeline.append(300, 0x03);
+
+        auto queue = encode(timeline);
+        REQUIRE(queue.getDirection() == COUNTER_CLOCKWISE);
+        REQUIRE(queue.size() == 1);
+        REQUIRE(queue[0].interval == 100);
+        REQUIRE(queue[0].count == 3);
+    }
+}
+
+TEST_CASE("StepperDriver::compile compresses the driver's profile", "[StepperDriver::compile]") {
+    BUILD_DRIVER(200, 600);
+
+    SECTION("Constant speed moves compile to one segment") {
+        auto queue = driver->compile(1000000, CLOCKWISE);
+        REQUIRE(queue.size() == 1);
+        REQUIRE(queue.getStepCount() == 1000000);
+        REQUIRE(queue[0].interval == 500);
+    }
+
+    SECTION("Accelerated moves regenerate the same step times as plan()") {
+        driver->setAcceleration(600);
+        auto timeline = driver->plan(3000, COUNTER_CLOCKWISE);
+        auto queue = driver->compile(3000, COUNTER_CLOCKWISE);
+        REQUIRE(queue.size() < 3000);
+
+        auto intervals = decodeAll(queue);
+        REQUIRE(intervals.size() == 3000);
+        uint64_t timestamp = 0;
+        for (size_t i = 0; i < intervals.size(); ++i) {
+            timestamp += intervals[i];
+            REQUIRE(timestamp == timeline[i].timestampMicros);
+        }
+    }
+
+    SECTION("Compiling at 0 RPM is not allowed") {
+        driver->setRPM(0);
+        REQUIRE_THROWS_AS(driver->compile(10, CLOCKWISE), IllegalStateError);
+    }
+
+    delete driver;
+}
+
+TEST_CASE("StepperDriver::play drives StepQueues", "[StepperDriver::play]") {
+    BUILD_DRIVER(200, 600);
+
+    auto queue = driver->compile(150, COUNTER_CLOCKWISE);
+    REQUIRE(driver->play(queue));
+    REQUIRE(ARE_CLOSE(driver->getPositionInDegrees(), 270.0));
+
+    REQUIRE(en.values.size() == 2);
+    REQUIRE(a1.values.size() == 150);
+    for (size_t i = 0; i < 150; ++i) {
+        // Counter clockwise waveform: 1100, 0110, 0011, 1001
+        REQUIRE(a1.values[i] == (i % 4 == 0 || i % 4 == 3));
+        REQUIRE(b1.values[i] == (i % 4 == 0 || i % 4 == 1));
+        REQUIRE(a2.values[i] == (i % 4 == 1 || i % 4 == 2));
+        REQUIRE(b2.values[i] == (i % 4 == 2 || i % 4 == 3));
+    }
+
+    REQUIRE(driver->play(driver->compile(100, CLOCKWISE)));
+    REQUIRE(ARE_CLOSE(driver->getPositionInDegrees(), 90.0));
+
+    delete driver;
+}
@@ -0,0 +1,119 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <recorder.hpp>
+#include <stepper.hpp>
+#include <timeline.hpp>
+#include <exception.hpp>
+#include <stdexcept>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+using namespace libstepper;
+
+TEST_CASE("StepTimeline stores events in order", "[StepTimeline]") {
+    StepTimeline timeline(COUNTER_CLOCKWISE, 2);
+
+    REQUIRE(timeline.empty());
+    REQUIRE(timeline.getDurationMicros() == 0);
+    REQUIRE(timeline.getDirection() == COUNTER_CLOCKWISE);
+    REQUIRE(timeline.getStartWaveformStep() == 2);
+
+    timeline.append(100, 0x0C);
+    timeline.append(200, 0xF6);
+
+    REQUIRE(timeline.size() == 2);
+    REQUIRE(timeline[0].timestampMicros == 100);
+    REQUIRE(timeline[0].coilMask == 0x0C);
+    REQUIRE(timeline[1].coilMask == 0x06);
+    REQUIRE(timeline.getDurationMicros() == 200);
+
+    REQUIRE_THROWS_AS(timeline.append(150, 0x03), invalid_argument);
+
+    timeline.reset(CLOCKWISE, 0);
+    REQUIRE(timeline.empty());
+    REQUIRE(timeline.getDirection() == CLOCKWISE);
+    REQUIRE(timeline.getStartWaveformStep() == 0);
+}
+
+TEST_CASE("StepperDriver::plan renders moves without driving the motor", "[StepperDriver::plan]") {
+    BUILD_DRIVER(200, 600);
+
+    SECTION("Counter clockwise moves render the counter clockwise waveform") {
+        auto timeline = driver->plan(6, COUNTER_CLOCKWISE);
+        const uint8_t expected[] = { 0x0C, 0x06, 0x03, 0x09, 0x0C, 0x06 };
+
+        REQUIRE(timeline.size() == 6);
+        for (size_t i = 0; i < 6; ++i) {
+            // 600 RPM at 200 steps per rotation == 500us per step
+            REQUIRE(timeline[i].timestampMicros == (i + 1) * 500);
+            REQUIRE(timeline[i].coilMask == expected[i]);
+        }
+    }
+
+    SECTION("Clockwise moves render the clockwise waveform") {
+        auto timeline = driver->plan(6, CLOCKWISE);
+        const uint8_t expected[] = { 0x0C, 0x09, 0x03, 0x06, 0x0C, 0x09 };
+
+        REQUIRE(timeline.size() == 6);
+        for (size_t i = 0; i < 6; ++i) {
+            REQUIRE(timeline[i].coilMask == expected[i]);
+        }
+    }
+
+    SECTION("Planning doesn't write to any terminal or move the motor") {
+        driver->plan(50, COUNTER_CLOCKWISE);
+        REQUIRE(en.values.size() == 0);
+        REQUIRE(a1.values.size() == 0);
+        REQUIRE(ARE_CLOSE(driver->getPositionInDegrees(), 0.0));
+    }
+
+    SECTION("Planning at 0 RPM is not allowed") {
+        driver->setRPM(0);
+        REQUIRE_THROWS_AS(driver->plan(50, COUNTER_CLOCKWISE), IllegalStateError);
+    }
+
+    delete driver;
+}
+
+TEST_CASE("StepperDriver::play drives planned timelines", "[StepperDriver::play]") {
+    BUILD_DRIVER(200, 600);
+
+    SECTION("Playing a timeline drives the same waveform as step") {
+        auto timeline = driver->plan(50, COUNTER_CLOCKWISE);
+        REQUIRE(driver->play(timeline));
+        REQUIRE(ARE_CLOSE(driver->getPositionInDegrees(), 90.0));
+
+        REQUIRE(en.values.size() == 2);
+        REQUIRE(en.values[0]);
+        REQUIRE(!en.values[1]);
+
+        REQUIRE(a1.values.size() == 50);
+        for (size_t i = 0; i < 50; ++i) {
+            REQUIRE(a1.values[i] == (bool)(timeline[i].coilMask & 0x08));
+            REQUIRE(b1.values[i] == (bool)(timeline[i].coilMask & 0x04));
+            REQUIRE(a2.values[i] == (bool)(timeline[i].coilMask & 0x02));
+            REQUIRE(b2.values[i] == (bool)(timeline[i].coilMask & 0x01));
+        }
+
+        auto back = driver->plan(25, CLOCKWISE);
+        REQUIRE(driver->play(back));
+        REQUIRE(ARE_CLOSE(driver->getPositionInDegrees(), 45.0));
+    }
+
+    SECTION("Timelines can only be played from the position they were planned at") {
+        auto timeline = driver->plan(10, COUNTER_CLOCKWISE);
+        driver->step(1, COUNTER_CLOCKWISE);
+        REQUIRE_THROWS_AS(driver->play(timeline), IllegalStateError);
+    }
+
+    SECTION("Empty timelines complete immediately") {
+        REQUIRE(driver->play(driver->plan(0, CLOCKWISE)));
+        REQUIRE(a1.values.size() == 0);
+    }
+
+    delete driver;
+}
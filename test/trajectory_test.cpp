@@ -0,0 +1,176 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <recorder.hpp>
+#include <stepper.hpp>
+#include <trajectory.hpp>
+#include <exception.hpp>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+using namespace libstepper;
+
+static const char *TRAJECTORY_PATH = "libstepper-trajectory-test.bin";
+
+static void writeBytes(const string &bytes) {
+    ofstream out(TRAJECTORY_PATH, ios::binary | ios::trunc);
+    out.write(bytes.data(), (streamsize) bytes.size());
+}
+
+TEST_CASE("Trajectory files round trip through TrajectoryWriter and TrajectoryFile", "[TrajectoryFile]") {
+    StepQueue forward(COUNTER_CLOCKWISE);
+    forward.append(StepSegment { 31623, 1, 0 });
+    forward.append(StepSegment { 13099, 2, -3047 });
+    forward.append(StepSegment { 500, 1000000, 0 });
+    StepQueue back(CLOCKWISE);
+    back.append(StepSegment { 700, 20, 5 });
+
+    {
+        TrajectoryWriter writer(TRAJECTORY_PATH, 200);
+        writer.append(forward);
+        writer.append(back);
+    }
+
+    TrajectoryFile trajectory(TRAJECTORY_PATH);
+    REQUIRE(trajectory.getVersion() == TRAJECTORY_VERSION);
+    REQUIRE(trajectory.getWaveformMode() == TRAJECTORY_WAVEFORM_FULL_STEP);
+    REQUIRE(trajectory.getStepsInRotation() == 200);
+    REQUIRE(trajectory.getSegmentCount() == 4);
+    REQUIRE(trajectory.getStepCount() == 1000023);
+
+    RotationDirection direction;
+    StepSegment segment = trajectory.getSegment(1, direction);
+    REQUIRE(direction == COUNTER_CLOCKWISE);
+    REQUIRE(segment.interval == 13099);
+    REQUIRE(segment.count == 2);
+    REQUIRE(segment.add == -3047);
+
+    segment = trajectory.getSegment(3, direction);
+    REQUIRE(direction == CLOCKWISE);
+    REQUIRE(segment.add == 5);
+    REQUIRE_THROWS_AS(trajectory.getSegment(4, direction), out_of_range);
+
+    SECTION("read() stops at a change of direction") {
+        StepSegment segments[8];
+        REQUIRE(trajectory.read(0, segments, 8, direction) == 3);
+        REQUIRE(direction == COUNTER_CLOCKWISE);
+        REQUIRE(segments[2].count == 1000000);
+        REQUIRE(trajectory.read(3, segments, 8, direction) == 1);
+        REQUIRE(direction == CLOCKWISE);
+        REQUIRE(trajectory.read(4, segments, 8, direction) == 0);
+    }
+
+    remove(TRAJECTORY_PATH);
+}
+
+TEST_CASE("TrajectoryFile rejects invalid files", "[TrajectoryFile]") {
+    SECTION("Missing files") {
+        remove(TRAJECTORY_PATH);
+        REQUIRE_THROWS_AS(TrajectoryFile(TRAJECTORY_PATH), IOError);
+    }
+
+    SECTION("Files without the header") {
+        writeBytes("LSTJ");
+        REQUIRE_THROWS_AS(TrajectoryFile(TRAJECTORY_PATH), FormatError);
+    }
+
+    SECTION("Files with the wrong magic") {
+        writeBytes(string("LSTX\x01\x00\x01\x00", 8) + string(24, '\0'));
+        REQUIRE_THROWS_AS(TrajectoryFile(TRAJECTORY_PATH), FormatError);
+    }
+
+    SECTION("Files with an unknown version") {
+        writeBytes(string("LSTJ\x02\x00\x01\x00", 8) + string(24, '\0'));
+        REQUIRE_THROWS_AS(TrajectoryFile(TRAJECTORY_PATH), FormatError);
+    }
+
+    SECTION("Truncated files") {
+        // Claims 1 segment, but has none
+        writeBytes(string("LSTJ\x01\x00\x01\x00", 8) + string("\xC8\0\0\0\0\0\0\0\x01", 9) + string(15, '\0'));
+        REQUIRE_THROWS_AS(TrajectoryFile(TRAJECTORY_PATH), FormatError);
+    }
+
+    SECTION("Files whose segments don't add up to the header's step count") {
+        // Claims 1 segment of 5 steps, which has 4
+        writeBytes(string("LSTJ\x01\x00\x01\x00", 8) + string("\xC8\0\0\0\0\0\0\0\x01\0\0\0\0\0\0\0\x05", 17) + string(7, '\0')
+            + string("\xF4\x01\0\0\x04\0\0\0\0\0\0\0\x01\0\0\0", 16));
+        REQUIRE_THROWS_AS(TrajectoryFile(TRAJECTORY_PATH), FormatError);
+    }
+
+    SECTION("Files with negative step intervals") {
+        {
+            TrajectoryWriter writer(TRAJECTORY_PATH, 200);
+            writer.append(StepSegment { 500, 3, -100 }, COUNTER_CLOCKWISE);
+            // 300, 100, and then -100
+            writer.append(StepSegment { 300, 3, -200 }, COUNTER_CLOCKWISE);
+        }
+        REQUIRE_THROWS_AS(TrajectoryFile(TRAJECTORY_PATH), FormatError);
+
+        {
+            TrajectoryWriter writer(TRAJECTORY_PATH, 200);
+            writer.append(StepSegment { 300, 2, -200 }, COUNTER_CLOCKWISE);
+            // Waits have no intervals to go negative
+            writer.append(StepSegment { 300, 0, -200 }, COUNTER_CLOCKWISE);
+        }
+        REQUIRE_NOTHROW(TrajectoryFile(TRAJECTORY_PATH));
+    }
+
+    remove(TRAJECTORY_PATH);
+}
+
+TEST_CASE("StepperDriver::play streams trajectory files", "[StepperDriver::play]") {
+    BUILD_DRIVER(200, 600);
+
+    SECTION("Plays every move in the file") {
+        {
+            TrajectoryWriter writer(TRAJECTORY_PATH, 200);
+            writer.append(driver->compile(150, COUNTER_CLOCKWISE));
+            writer.append(driver->compile(100, CLOCKWISE));
+        }
+
+        TrajectoryFile trajectory(TRAJECTORY_PATH);
+        REQUIRE(driver->play(trajectory));
+        REQUIRE(ARE_CLOSE(driver->getPositionInDegrees(), 90.0));
+        REQUIRE(en.values.size() == 2);
+        REQUIRE(a1.values.size() == 250);
+    }
+
+    SECTION("Rejects files planned for a different motor before moving") {
+        {
+            TrajectoryWriter writer(TRAJECTORY_PATH, 400);
+            writer.append(driver->compile(150, COUNTER_CLOCKWISE));
+        }
+
+        TrajectoryFile trajectory(TRAJECTORY_PATH);
+        REQUIRE_THROWS_AS(driver->play(trajectory), IllegalStateError);
+        REQUIRE(en.values.size() == 0);
+        REQUIRE(a1.values.size() == 0);
+    }
+
+    SECTION("Releases the motor if a later window is corrupt") {
+        {
+            TrajectoryWriter writer(TRAJECTORY_PATH, 200);
+            for (int i = 0; i < 70; ++i) {
+                writer.append(StepSegment { 500, 1, 0 }, COUNTER_CLOCKWISE);
+            }
+            writer.append(StepSegment { 500, 1, 0 }, (RotationDirection) 7);
+        }
+
+        TrajectoryFile trajectory(TRAJECTORY_PATH);
+        REQUIRE_THROWS_AS(driver->play(trajectory), FormatError);
+        // The first window was played, and the enable terminal was released
+        REQUIRE(driver->getPosition() == 64);
+        REQUIRE(en.values.size() == 2);
+        REQUIRE(!en.values.back());
+        REQUIRE(driver->getStats().interruptedMoves == 1);
+    }
+
+    remove(TRAJECTORY_PATH);
+    delete driver;
+}
@@ -0,0 +1,73 @@
+/**
+ Copyright (c) 2018 Udey Rishi. All rights reserved.
+*/
+
+#include <catch.hpp>
+#include <units.hpp>
+#include <stdexcept>
+
+using namespace std;
+using namespace libstepper;
+
+TEST_CASE("UnitConverter validates its ratio", "[UnitConverter]") {
+    REQUIRE_THROWS_AS(UnitConverter(0, 360), invalid_argument);
+    REQUIRE_THROWS_AS(UnitConverter(200, 0), invalid_argument);
+    REQUIRE_THROWS_AS(UnitConverter(200, 360).withGearRatio(0, 1), invalid_argument);
+    REQUIRE_THROWS_AS(UnitConverter(200, 360).withGearRatio(1, 0), invalid_argument);
+}
+
+TEST_CASE("UnitConverter reduces its ratio up front", "[UnitConverter]") {
+    const UnitConverter degrees(200, 360);
+    REQUIRE(degrees.getNumerator() == 1);
+    REQUIRE(degrees.getDenominator() == 1800000);
+
+    // 5:1 gearbox, so 1000 steps per output turn
+    const UnitConverter geared = degrees.withGearRatio(5, 1);
+    REQUIRE(geared.getNumerator() == 1);
+    REQUIRE(geared.getDenominator() == 360000);
+}
+
+TEST_CASE("UnitConverter carries the fractional steps", "[UnitConverter]") {
+    SECTION("Degrees") {
+        UnitConverter degrees(200, 360);
+        int64_t steps = 0;
+        for (size_t i = 0; i < 360; ++i) {
+            steps += degrees.toSteps(UnitConverter::toFixed(1));
+        }
+        REQUIRE(steps == 200);
+        REQUIRE(degrees.getRemainder() == 0);
+
+        // Rounded towards 0 both ways, so going back cancels out
+        REQUIRE(degrees.toSteps(UnitConverter::toFixed(-1)) == 0);
+        REQUIRE(degrees.toSteps(UnitConverter::toFixed(1)) == 0);
+        REQUIRE(degrees.getRemainder() == 0);
+    }
+
+    SECTION("Millimeters") {
+        // An 8 mm lead at 3200 steps per turn, in 0.001 mm moves
+        UnitConverter millimeters(3200, 8);
+        int64_t steps = 0;
+        for (size_t i = 0; i < 1001; ++i) {
+            steps += millimeters.toSteps(UnitConverter::toFixed(0.001));
+        }
+        REQUIRE(steps == 400);
+        // 0.4 of a step, in 1/2500 steps
+        REQUIRE(millimeters.getDenominator() == 2500);
+        REQUIRE(millimeters.getRemainder() == 1000);
+        REQUIRE(millimeters.toFixedUnits(400) == UNIT_SCALE);
+
+        millimeters.resetRemainder();
+        REQUIRE(millimeters.getRemainder() == 0);
+    }
+
+    SECTION("Gear ratios") {
+        // 3 turns of the motor for 7 turns of the output
+        UnitConverter geared = UnitConverter(200, 360).withGearRatio(3, 7);
+        int64_t steps = 0;
+        for (size_t i = 0; i < 7 * 360; ++i) {
+            steps += geared.toSteps(UnitConverter::toFixed(1));
+        }
+        REQUIRE(steps == 600);
+        REQUIRE(geared.getRemainder() == 0);
+    }
+}